@@ -0,0 +1,128 @@
+#include "defines.h"
+#include "gltf.h"
+#include "job.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCENE_COUNT 64
+#define ASSETS_PER_SCENE 16
+#define ROUND_COUNT 5
+
+// NOTE: Mirrors how a level load fans out: every scene job loads its assets as child jobs and
+// waits on them before post-processing, so half of the jobs spend time blocked in job_wait.
+
+typedef struct {
+    const char *file_name;
+    gltf_root gltf;
+} AssetLoad;
+
+typedef struct {
+    const char *file_name;
+    AssetLoad assets[ASSETS_PER_SCENE];
+    u64 vertex_count;
+} SceneLoad;
+
+static void asset_load(void *data) {
+    AssetLoad *asset = data;
+    asset->gltf = (gltf_root){0};
+    load_gltf_from_file(asset->file_name, &asset->gltf);
+}
+
+static void scene_load(void *data) {
+    SceneLoad *scene = data;
+
+    job jobs[ASSETS_PER_SCENE];
+    for (u32 i = 0; i < ASSETS_PER_SCENE; i++) {
+        scene->assets[i].file_name = scene->file_name;
+        jobs[i] = (job){
+            .function = asset_load,
+            .data = &scene->assets[i],
+        };
+    }
+
+    job_counter counter = {0};
+    job_run(jobs, ASSETS_PER_SCENE, &counter);
+    job_wait(&counter);
+
+    scene->vertex_count = 0;
+    for (u32 i = 0; i < ASSETS_PER_SCENE; i++) {
+        gltf_root *gltf = &scene->assets[i].gltf;
+        for (u32 j = 0; j < gltf->accessor_count; j++) {
+            if (gltf->accessors[j].type == GLTF_ACCESSOR_TYPE_VEC3) {
+                scene->vertex_count += gltf->accessors[j].count;
+            }
+        }
+        gltf_destroy(gltf);
+    }
+}
+
+/**
+ * @returns the best round's time in milliseconds.
+ */
+static f64 run_benchmark(const char *file_name, u32 worker_count, u32 fiber_count) {
+    job_system_init(worker_count, fiber_count);
+
+    SceneLoad *scenes = calloc(SCENE_COUNT, sizeof(SceneLoad));
+    job jobs[SCENE_COUNT];
+    for (u32 i = 0; i < SCENE_COUNT; i++) {
+        scenes[i].file_name = file_name;
+        jobs[i] = (job){
+            .function = scene_load,
+            .data = &scenes[i],
+        };
+    }
+
+    f64 best_ms = 0.0;
+    for (u32 round = 0; round < ROUND_COUNT; round++) {
+        u64 start = timer_now_ns();
+
+        job_counter counter = {0};
+        job_run(jobs, SCENE_COUNT, &counter);
+        job_wait(&counter);
+
+        f64 elapsed_ms = timer_elapsed_ms(start);
+        if (round == 0 || elapsed_ms < best_ms) {
+            best_ms = elapsed_ms;
+        }
+    }
+
+    if (scenes[0].vertex_count == 0) {
+        fprintf(stderr, "%s did not load, the results are meaningless!\n", file_name);
+    }
+
+    free(scenes);
+    job_system_shutdown();
+
+    return best_ms;
+}
+
+int main(int argc, char **argv) {
+    const char *file_name = "models/tire.glb";
+    u32 worker_count = job_default_worker_count();
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--workers=", 10) == 0) {
+            worker_count = (u32)strtoul(argv[i] + 10, NULL, 10);
+        } else {
+            file_name = argv[i];
+        }
+    }
+
+    f64 blocking_ms = run_benchmark(file_name, worker_count, 0);
+    f64 fiber_ms = run_benchmark(file_name, worker_count, JOB_DEFAULT_FIBER_COUNT);
+
+    u32 asset_count = SCENE_COUNT * ASSETS_PER_SCENE;
+    printf("\n%u scenes x %u assets of %s on %u threads, best of %u rounds:\n",
+           SCENE_COUNT,
+           ASSETS_PER_SCENE,
+           file_name,
+           worker_count + 1,
+           ROUND_COUNT);
+    printf("  blocking: %8.2f ms  %8.0f assets/s\n",
+           blocking_ms,
+           asset_count / (blocking_ms / 1000.0));
+    printf("  fibers:   %8.2f ms  %8.0f assets/s\n", fiber_ms, asset_count / (fiber_ms / 1000.0));
+}
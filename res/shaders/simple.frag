@@ -1,8 +1,10 @@
 #version 450
 
+layout(location = 0) in vec4 inColor;
+
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(0.8, 0.8, 0.8, 1.0);
+    outColor = inColor;
 }
 
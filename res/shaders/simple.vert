@@ -1,13 +1,30 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
-layout(binding = 0) uniform UniformBufferObject {
+layout(set = 1, binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 view;
     mat4 proj;
 } ubo;
 
+struct DrawData {
+    vec4 color;
+};
+
+// per-draw data, indexed by the draw's firstInstance
+layout(std430, set = 0, binding = 1) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+} draw_data_buffers[];
+
+layout(push_constant) uniform PlanetIndices {
+    uint draw_data;
+} indices;
+
 layout(location = 0) in vec3 inPosition;
 
+layout(location = 0) out vec4 outColor;
+
 void main() {
     gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    outColor = draw_data_buffers[indices.draw_data].draws[gl_InstanceIndex].color;
 }
@@ -0,0 +1,260 @@
+#include "bindless.h"
+
+#include "context.h"
+#include "darray.h"
+#include "types.h"
+
+#include <stdio.h>
+
+static const VkDescriptorType descriptor_types[BINDLESS_RESOURCE_TYPE_COUNT] = {
+    [BINDLESS_SAMPLED_IMAGE] = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+    [BINDLESS_STORAGE_BUFFER] = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    [BINDLESS_SAMPLER] = VK_DESCRIPTOR_TYPE_SAMPLER,
+};
+
+static const u32 descriptor_counts[BINDLESS_RESOURCE_TYPE_COUNT] = {
+    [BINDLESS_SAMPLED_IMAGE] = BINDLESS_MAX_SAMPLED_IMAGES,
+    [BINDLESS_STORAGE_BUFFER] = BINDLESS_MAX_STORAGE_BUFFERS,
+    [BINDLESS_SAMPLER] = BINDLESS_MAX_SAMPLERS,
+};
+
+static u32 acquire_slot(bindless_set *set, bindless_resource_type type);
+static void write_descriptor(const bindless_set *set,
+                             const context *context,
+                             bindless_resource_type type,
+                             u32 slot,
+                             const VkDescriptorImageInfo *image_info,
+                             const VkDescriptorBufferInfo *buffer_info);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+void bindless_set_create(context *context) {
+    bindless_set *set = &context->bindless;
+    *set = (bindless_set){0};
+
+    VkDescriptorSetLayoutBinding bindings[BINDLESS_RESOURCE_TYPE_COUNT];
+    VkDescriptorBindingFlags binding_flags[BINDLESS_RESOURCE_TYPE_COUNT];
+    VkDescriptorPoolSize pool_sizes[BINDLESS_RESOURCE_TYPE_COUNT];
+
+    for (u32 i = 0; i < BINDLESS_RESOURCE_TYPE_COUNT; i++) {
+        bindings[i] = (VkDescriptorSetLayoutBinding){
+            .binding = i,
+            .descriptorType = descriptor_types[i],
+            .descriptorCount = descriptor_counts[i],
+            .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS,
+        };
+
+        binding_flags[i] = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                           VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+        if (context->device.features_12.descriptorBindingUpdateUnusedWhilePending) {
+            binding_flags[i] |= VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+        }
+
+        pool_sizes[i] = (VkDescriptorPoolSize){
+            .type = descriptor_types[i],
+            .descriptorCount = descriptor_counts[i],
+        };
+
+        set->free_slots[i] = darray_create(u32);
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = BINDLESS_RESOURCE_TYPE_COUNT,
+        .pBindingFlags = binding_flags,
+    };
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &binding_flags_info,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .bindingCount = BINDLESS_RESOURCE_TYPE_COUNT,
+        .pBindings = bindings,
+    };
+
+    VK_CHECK(vkCreateDescriptorSetLayout(context->device.logical_device,
+                                         &layout_info,
+                                         NULL,
+                                         &set->layout));
+
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .poolSizeCount = BINDLESS_RESOURCE_TYPE_COUNT,
+        .pPoolSizes = pool_sizes,
+        .maxSets = 1,
+    };
+
+    VK_CHECK(
+        vkCreateDescriptorPool(context->device.logical_device, &pool_info, NULL, &set->pool));
+
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = set->pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &set->layout,
+    };
+
+    VK_CHECK(vkAllocateDescriptorSets(context->device.logical_device, &alloc_info, &set->set));
+
+    // NOTE: Only used to bind the set and push constants; it is compatible with the layout of
+    // every pipeline built with pipeline_builder_use_bindless.
+    VkPushConstantRange push_constant_range = {
+        .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS,
+        .offset = 0,
+        .size = BINDLESS_PUSH_CONSTANT_SIZE,
+    };
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &set->layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range,
+    };
+
+    VK_CHECK(vkCreatePipelineLayout(context->device.logical_device,
+                                    &pipeline_layout_info,
+                                    NULL,
+                                    &set->pipeline_layout));
+
+    printf("Bindless descriptor set created.\n");
+}
+
+void bindless_set_destroy(context *context) {
+    bindless_set *set = &context->bindless;
+
+    vkDestroyPipelineLayout(context->device.logical_device, set->pipeline_layout, NULL);
+    vkDestroyDescriptorPool(context->device.logical_device, set->pool, NULL);
+    vkDestroyDescriptorSetLayout(context->device.logical_device, set->layout, NULL);
+
+    for (u32 i = 0; i < BINDLESS_RESOURCE_TYPE_COUNT; i++) {
+        darray_destroy(set->free_slots[i]);
+    }
+
+    *set = (bindless_set){0};
+}
+
+u32 bindless_add_sampled_image(bindless_set *set,
+                               const context *context,
+                               VkImageView image_view,
+                               VkImageLayout image_layout) {
+    u32 slot = acquire_slot(set, BINDLESS_SAMPLED_IMAGE);
+    if (slot == BINDLESS_INVALID_SLOT) {
+        return slot;
+    }
+
+    VkDescriptorImageInfo image_info = {
+        .imageView = image_view,
+        .imageLayout = image_layout,
+    };
+    write_descriptor(set, context, BINDLESS_SAMPLED_IMAGE, slot, &image_info, NULL);
+
+    return slot;
+}
+
+u32 bindless_add_storage_buffer(bindless_set *set,
+                                const context *context,
+                                VkBuffer buffer,
+                                VkDeviceSize offset,
+                                VkDeviceSize range) {
+    u32 slot = acquire_slot(set, BINDLESS_STORAGE_BUFFER);
+    if (slot == BINDLESS_INVALID_SLOT) {
+        return slot;
+    }
+
+    VkDescriptorBufferInfo buffer_info = {
+        .buffer = buffer,
+        .offset = offset,
+        .range = range,
+    };
+    write_descriptor(set, context, BINDLESS_STORAGE_BUFFER, slot, NULL, &buffer_info);
+
+    return slot;
+}
+
+u32 bindless_add_sampler(bindless_set *set, const context *context, VkSampler sampler) {
+    u32 slot = acquire_slot(set, BINDLESS_SAMPLER);
+    if (slot == BINDLESS_INVALID_SLOT) {
+        return slot;
+    }
+
+    VkDescriptorImageInfo image_info = {
+        .sampler = sampler,
+    };
+    write_descriptor(set, context, BINDLESS_SAMPLER, slot, &image_info, NULL);
+
+    return slot;
+}
+
+void bindless_release(bindless_set *set, bindless_resource_type type, u32 slot) {
+    if (slot == BINDLESS_INVALID_SLOT) {
+        return;
+    }
+
+    darray_push(set->free_slots[type], slot);
+}
+
+void bindless_bind(const bindless_set *set, VkCommandBuffer command_buffer) {
+    vkCmdBindDescriptorSets(command_buffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            set->pipeline_layout,
+                            0,
+                            1,
+                            &set->set,
+                            0,
+                            NULL);
+}
+
+void bindless_push_constants(const bindless_set *set,
+                             VkCommandBuffer command_buffer,
+                             const void *data,
+                             u32 size) {
+    vkCmdPushConstants(command_buffer,
+                       set->pipeline_layout,
+                       VK_SHADER_STAGE_ALL_GRAPHICS,
+                       0,
+                       size,
+                       data);
+}
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+static u32 acquire_slot(bindless_set *set, bindless_resource_type type) {
+    if (darray_length(set->free_slots[type]) != 0) {
+        u32 slot;
+        darray_pop(set->free_slots[type], &slot);
+        return slot;
+    }
+
+    if (set->next_slot[type] >= descriptor_counts[type]) {
+        fprintf(stderr, "Bindless descriptor set is full (%u slots)\n", descriptor_counts[type]);
+        return BINDLESS_INVALID_SLOT;
+    }
+
+    return set->next_slot[type]++;
+}
+
+static void write_descriptor(const bindless_set *set,
+                             const context *context,
+                             bindless_resource_type type,
+                             u32 slot,
+                             const VkDescriptorImageInfo *image_info,
+                             const VkDescriptorBufferInfo *buffer_info) {
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = set->set,
+        .dstBinding = type,
+        .dstArrayElement = slot,
+        .descriptorType = descriptor_types[type],
+        .descriptorCount = 1,
+        .pImageInfo = image_info,
+        .pBufferInfo = buffer_info,
+    };
+
+    vkUpdateDescriptorSets(context->device.logical_device, 1, &write, 0, NULL);
+}
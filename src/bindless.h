@@ -0,0 +1,43 @@
+#ifndef BINDLESS_H
+#define BINDLESS_H
+
+#include "types.h"
+
+#include <stdint.h>
+
+#define BINDLESS_MAX_SAMPLED_IMAGES (1 << 14)
+#define BINDLESS_MAX_STORAGE_BUFFERS (1 << 14)
+#define BINDLESS_MAX_SAMPLERS 64
+
+// NOTE: Every bindless pipeline gets this one push constant range, which keeps their layouts
+// compatible so the set bound once per frame stays bound across pipeline switches.
+#define BINDLESS_PUSH_CONSTANT_SIZE 64
+
+#define BINDLESS_INVALID_SLOT UINT32_MAX
+
+void bindless_set_create(context *context);
+void bindless_set_destroy(context *context);
+
+/**
+ * Slots are written immediately with update-after-bind, so only slots that no frame in flight
+ * still reads may be released and reused.
+ */
+u32 bindless_add_sampled_image(bindless_set *set,
+                               const context *context,
+                               VkImageView image_view,
+                               VkImageLayout image_layout);
+u32 bindless_add_storage_buffer(bindless_set *set,
+                                const context *context,
+                                VkBuffer buffer,
+                                VkDeviceSize offset,
+                                VkDeviceSize range);
+u32 bindless_add_sampler(bindless_set *set, const context *context, VkSampler sampler);
+void bindless_release(bindless_set *set, bindless_resource_type type, u32 slot);
+
+void bindless_bind(const bindless_set *set, VkCommandBuffer command_buffer);
+void bindless_push_constants(const bindless_set *set,
+                             VkCommandBuffer command_buffer,
+                             const void *data,
+                             u32 size);
+
+#endif // BINDLESS_H
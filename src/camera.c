@@ -1,32 +1,55 @@
 #include "camera.h"
 
+// NOTE: Degrees turned per pixel the cursor moves.
+#define MOUSE_SENSITIVITY 0.01f
+
 Camera camera_create(vec3s position) {
     Camera camera = {
-        position,
-        {{0.0, 0.0, -1.0}},
-        {{0.0, 1.0, 0.0}},
+        .position = position,
+        .front = {{0.0, 0.0, -1.0}},
+        .up = {{0.0, 1.0, 0.0}},
+        .yaw = -90.0f,
+        .pitch = 0.0f,
     };
 
     return camera;
 }
 
-void camera_process_input(GLFWwindow *window, Camera *camera, f32 delta_time) {
+/**
+ * @returns the unit vector a camera with the given yaw and pitch in degrees looks along.
+ */
+vec3s camera_direction(f32 yaw, f32 pitch) {
+    vec3s direction = {{
+        cos(glm_rad(yaw)) * cos(glm_rad(pitch)),
+        sin(glm_rad(pitch)),
+        sin(glm_rad(yaw)) * cos(glm_rad(pitch)),
+    }};
+
+    return glms_vec3_normalize(direction);
+}
+
+void camera_process_input(Camera *camera, const input_state *input, f32 delta_time) {
+    camera->yaw += input->cursor_delta_x * MOUSE_SENSITIVITY;
+    camera->pitch -= input->cursor_delta_y * MOUSE_SENSITIVITY;
+    camera->pitch = CLAMP(camera->pitch, -89.0f, 89.0f);
+    camera->front = camera_direction(camera->yaw, camera->pitch);
+
     const float camera_speed = delta_time * 2.5f;
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+    if (input->keys_down[GLFW_KEY_W]) {
         camera->position =
             glms_vec3_add(camera->position, glms_vec3_scale(camera->front, camera_speed));
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    if (input->keys_down[GLFW_KEY_S]) {
         camera->position =
             glms_vec3_sub(camera->position, glms_vec3_scale(camera->front, camera_speed));
     }
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    if (input->keys_down[GLFW_KEY_A]) {
         camera->position = glms_vec3_sub(
             camera->position,
             glms_vec3_scale(glms_vec3_normalize(glms_vec3_cross(camera->front, camera->up)),
                             camera_speed));
     }
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    if (input->keys_down[GLFW_KEY_D]) {
         camera->position = glms_vec3_add(
             camera->position,
             glms_vec3_scale(glms_vec3_normalize(glms_vec3_cross(camera->front, camera->up)),
@@ -34,35 +57,7 @@ void camera_process_input(GLFWwindow *window, Camera *camera, f32 delta_time) {
     }
 }
 
-// TODO: make this per-camera
-f32 pitch = 0, yaw = -90.0f;
-f32 last_x = 400, last_y = 300;
-void camera_mouse_callback(GLFWwindow *window, double x_position, double y_position) {
-    (void)window;
-
-    f32 x_offset = x_position - last_x;
-    f32 y_offset = last_y - y_position;
-    last_x = x_position;
-    last_y = y_position;
-
-    const f32 sensitivity = 0.01f;
-    x_offset *= sensitivity;
-    y_offset *= sensitivity;
-
-    yaw += x_offset;
-    pitch += y_offset;
-
-    pitch = CLAMP(pitch, -89.0f, 89.0f);
-}
-
 UniformBufferObject camera_create_ubo(const context *render_context, Camera camera) {
-    vec3s direction = {{
-        cos(glm_rad(yaw)) * cos(glm_rad(pitch)),
-        sin(glm_rad(pitch)),
-        sin(glm_rad(yaw)) * cos(glm_rad(pitch)),
-    }};
-    camera.front = glms_vec3_normalize(direction);
-
     UniformBufferObject ubo = {
         .model = glms_mat4_identity(),
         // https://learnopengl.com/Getting-started/Camera
@@ -2,6 +2,7 @@
 #define CAMERA_H
 
 #include "defines.h"
+#include "input.h"
 #include "types.h"
 
 typedef struct {
@@ -14,11 +15,14 @@ typedef struct {
     vec3s position;
     vec3s front;
     vec3s up;
+    // NOTE: In degrees; front is derived from them.
+    f32 yaw;
+    f32 pitch;
 } Camera;
 
 Camera camera_create(vec3s position);
-void camera_mouse_callback(GLFWwindow *window, double x_position, double y_position);
-void camera_process_input(GLFWwindow *window, Camera *camera, f32 delta_time);
+vec3s camera_direction(f32 yaw, f32 pitch);
+void camera_process_input(Camera *camera, const input_state *input, f32 delta_time);
 UniformBufferObject camera_create_ubo(const context *render_context, Camera camera);
 
 #endif // CAMERA_H
@@ -0,0 +1,206 @@
+#include "camera_path.h"
+
+#include "darray.h"
+#include "json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static b8 parse_keyframe(json_value *value, camera_keyframe *out_keyframe);
+static b8 parse_number(json_value *value, f64 *out_number);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+camera_path camera_path_create(void) {
+    return (camera_path){
+        .keyframes = darray_create(camera_keyframe),
+    };
+}
+
+b8 camera_path_load(const char *file_name, camera_path *out_path) {
+    FILE *fp = fopen(file_name, "rb");
+    if (!fp) {
+        fprintf(stderr, "Unable to open camera path: %s\n", file_name);
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    u64 file_size = ftell(fp);
+    rewind(fp);
+
+    char *buffer = malloc(file_size);
+    if (fread(buffer, 1, file_size, fp) != file_size) {
+        fprintf(stderr, "Unable to read camera path: %s\n", file_name);
+        free(buffer);
+        fclose(fp);
+        return false;
+    }
+    fclose(fp);
+
+    json_value *root = json_parse(buffer, file_size);
+    free(buffer);
+
+    if (root == NULL || root->type != JSON_VALUE_ARRAY || root->u.array.length == 0) {
+        fprintf(stderr, "%s is not a non-empty JSON list of keyframes\n", file_name);
+        if (root != NULL) {
+            json_value_free(root);
+        }
+        return false;
+    }
+
+    camera_path path = camera_path_create();
+    for (u32 i = 0; i < root->u.array.length; i++) {
+        camera_keyframe keyframe;
+        if (!parse_keyframe(root->u.array.values[i], &keyframe)) {
+            fprintf(stderr, "%s: keyframe %u is invalid\n", file_name, i);
+            camera_path_destroy(&path);
+            json_value_free(root);
+            return false;
+        }
+
+        u64 count = darray_length(path.keyframes);
+        if (count > 0 && keyframe.time < path.keyframes[count - 1].time) {
+            fprintf(stderr, "%s: keyframe %u is earlier than the one before it\n", file_name, i);
+            camera_path_destroy(&path);
+            json_value_free(root);
+            return false;
+        }
+
+        darray_push(path.keyframes, keyframe);
+    }
+
+    json_value_free(root);
+
+    *out_path = path;
+    return true;
+}
+
+void camera_path_destroy(camera_path *path) {
+    darray_destroy(path->keyframes);
+    path->keyframes = NULL;
+}
+
+f64 camera_path_duration(const camera_path *path) {
+    u64 count = darray_length(path->keyframes);
+    return count > 0 ? path->keyframes[count - 1].time : 0.0;
+}
+
+Camera camera_path_sample(const camera_path *path, f64 time) {
+    u64 count = darray_length(path->keyframes);
+
+    u64 next = 0;
+    while (next < count && path->keyframes[next].time <= time) {
+        next++;
+    }
+
+    const camera_keyframe *from = &path->keyframes[next > 0 ? next - 1 : 0];
+    const camera_keyframe *to = &path->keyframes[next < count ? next : count - 1];
+
+    f32 t = 0.0f;
+    if (to->time > from->time) {
+        t = (f32)((time - from->time) / (to->time - from->time));
+    }
+
+    Camera camera = camera_create(glms_vec3_lerp(from->position, to->position, t));
+    camera.yaw = glm_lerp(from->yaw, to->yaw, t);
+    camera.pitch = glm_lerp(from->pitch, to->pitch, t);
+    camera.front = camera_direction(camera.yaw, camera.pitch);
+
+    return camera;
+}
+
+void camera_path_append(camera_path *path, f64 time, Camera camera) {
+    camera_keyframe keyframe = {
+        .time = time,
+        .position = camera.position,
+        .yaw = camera.yaw,
+        .pitch = camera.pitch,
+    };
+    darray_push(path->keyframes, keyframe);
+}
+
+b8 camera_path_write(const camera_path *path, const char *file_name) {
+    FILE *fp = fopen(file_name, "w");
+    if (!fp) {
+        fprintf(stderr, "Unable to open %s\n", file_name);
+        return false;
+    }
+
+    u64 count = darray_length(path->keyframes);
+
+    fprintf(fp, "[");
+    for (u64 i = 0; i < count; i++) {
+        const camera_keyframe *keyframe = &path->keyframes[i];
+        fprintf(fp,
+                "%s\n  {\"time\": %.6f, \"position\": [%.6f, %.6f, %.6f], \"yaw\": %.4f, "
+                "\"pitch\": %.4f}",
+                i == 0 ? "" : ",",
+                keyframe->time,
+                keyframe->position.x,
+                keyframe->position.y,
+                keyframe->position.z,
+                keyframe->yaw,
+                keyframe->pitch);
+    }
+    fprintf(fp, "\n]\n");
+    fclose(fp);
+
+    printf("Wrote %llu camera keyframes to %s\n", count, file_name);
+    return true;
+}
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+static b8 parse_keyframe(json_value *value, camera_keyframe *out_keyframe) {
+    if (value->type != JSON_VALUE_OBJECT) {
+        return false;
+    }
+
+    json_value *position = json_object_get_value(value, "position");
+    if (position == NULL || position->type != JSON_VALUE_ARRAY || position->u.array.length != 3) {
+        return false;
+    }
+
+    f64 coordinates[3];
+    for (u32 i = 0; i < 3; i++) {
+        if (!parse_number(position->u.array.values[i], &coordinates[i])) {
+            return false;
+        }
+    }
+
+    f64 time, yaw, pitch;
+    if (!parse_number(json_object_get_value(value, "time"), &time) ||
+        !parse_number(json_object_get_value(value, "yaw"), &yaw) ||
+        !parse_number(json_object_get_value(value, "pitch"), &pitch)) {
+        return false;
+    }
+
+    *out_keyframe = (camera_keyframe){
+        .time = time,
+        .position = {{coordinates[0], coordinates[1], coordinates[2]}},
+        .yaw = yaw,
+        .pitch = pitch,
+    };
+    return true;
+}
+
+static b8 parse_number(json_value *value, f64 *out_number) {
+    if (value == NULL) {
+        return false;
+    }
+
+    switch (value->type) {
+    case JSON_VALUE_INTEGER:
+        *out_number = (f64)value->u.integer;
+        return true;
+    case JSON_VALUE_NUMBER:
+        *out_number = value->u.number;
+        return true;
+    default:
+        return false;
+    }
+}
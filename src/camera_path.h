@@ -0,0 +1,35 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include "camera.h"
+#include "defines.h"
+
+typedef struct {
+    f64 time;
+    vec3s position;
+    // NOTE: In degrees, as in Camera.
+    f32 yaw;
+    f32 pitch;
+} camera_keyframe;
+
+/**
+ * A camera flight path stored as a JSON list of keyframes sorted by time in seconds:
+ * [{"time": 0, "position": [0, 0, 5], "yaw": -90, "pitch": 0}, ...]. Sampling interpolates
+ * linearly between the surrounding keyframes and holds the first and last keyframe outside them.
+ */
+typedef struct {
+    camera_keyframe *keyframes; // darray
+} camera_path;
+
+camera_path camera_path_create(void);
+b8 camera_path_load(const char *file_name, camera_path *out_path);
+void camera_path_destroy(camera_path *path);
+
+f64 camera_path_duration(const camera_path *path);
+Camera camera_path_sample(const camera_path *path, f64 time);
+
+// NOTE: For recording a path to replay later; keyframes must be appended in time order.
+void camera_path_append(camera_path *path, f64 time, Camera camera);
+b8 camera_path_write(const camera_path *path, const char *file_name);
+
+#endif // CAMERA_PATH_H
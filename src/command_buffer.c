@@ -1,5 +1,9 @@
 #include "command_buffer.h"
 
+#include "timeline.h"
+
+static void free_command_buffer(context *context, void *command_buffer);
+
 VkCommandBuffer begin_single_time_commands(const context *context) {
     VkCommandBufferAllocateInfo alloc_info = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
@@ -21,7 +25,11 @@ VkCommandBuffer begin_single_time_commands(const context *context) {
     return command_buffer;
 }
 
-void end_single_time_commands(const context *context, VkCommandBuffer command_buffer) {
+/**
+ * Submits without waiting. The command buffer is freed once the returned graphics timeline value
+ * has been reached.
+ */
+u64 submit_single_time_commands(const context *context, VkCommandBuffer command_buffer) {
     vkEndCommandBuffer(command_buffer);
 
     VkSubmitInfo submit_info = {
@@ -30,11 +38,20 @@ void end_single_time_commands(const context *context, VkCommandBuffer command_bu
         .pCommandBuffers = &command_buffer,
     };
 
-    vkQueueSubmit(context->device.graphics_queue, 1, &submit_info, NULL);
-    vkQueueWaitIdle(context->device.graphics_queue);
+    u64 value = timeline_submit(context->timeline, TIMELINE_QUEUE_GRAPHICS, &submit_info);
+    timeline_defer(context->timeline,
+                   TIMELINE_QUEUE_GRAPHICS,
+                   value,
+                   free_command_buffer,
+                   &command_buffer,
+                   sizeof(command_buffer));
+
+    return value;
+}
 
+static void free_command_buffer(context *context, void *command_buffer) {
     vkFreeCommandBuffers(context->device.logical_device,
                          context->device.graphics_command_pool,
                          1,
-                         &command_buffer);
+                         (VkCommandBuffer *)command_buffer);
 }
@@ -4,6 +4,6 @@
 #include "types.h"
 
 VkCommandBuffer begin_single_time_commands(const context *context);
-void end_single_time_commands(const context *context, VkCommandBuffer command_buffer);
+u64 submit_single_time_commands(const context *context, VkCommandBuffer command_buffer);
 
 #endif // COMMAND_BUFFER_H
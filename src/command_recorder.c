@@ -0,0 +1,212 @@
+#include "command_recorder.h"
+
+#include "darray.h"
+#include "gpu_profiler.h"
+#include "job.h"
+#include "profiler.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    VkCommandPool command_pools[MAX_FRAMES_IN_FLIGHT];
+    VkCommandBuffer *command_buffers[MAX_FRAMES_IN_FLIGHT]; // darray
+    u32 used_command_buffers[MAX_FRAMES_IN_FLIGHT];
+} recorder_thread;
+
+struct command_recorder {
+    recorder_thread *threads;
+    u32 thread_count;
+    u32 frame_count;
+};
+
+typedef struct {
+    struct command_recorder *recorder;
+    const context *context;
+    const VkCommandBufferInheritanceInfo *inheritance_info;
+    VkExtent2D extent;
+    const command_recording *recordings;
+    VkCommandBuffer *secondary_command_buffers;
+} record_work;
+
+static void record_batch(u32 start, u32 end, void *work);
+static VkCommandBuffer acquire_secondary_command_buffer(recorder_thread *thread,
+                                                        VkDevice device,
+                                                        u32 frame_index);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+struct command_recorder *command_recorder_create(const context *context) {
+    struct command_recorder *recorder = calloc(1, sizeof(struct command_recorder));
+
+    // NOTE: The last slot belongs to whichever thread outside the job system is recording, such
+    // as the render thread, which runs recording jobs itself while it waits on them.
+    recorder->thread_count = job_system_thread_count() + 1;
+    recorder->threads = calloc(recorder->thread_count, sizeof(recorder_thread));
+    recorder->frame_count = context->max_frames_in_flight;
+
+    VkCommandPoolCreateInfo pool_create_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .queueFamilyIndex = context->device.graphics_queue_index,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+    };
+
+    for (u32 i = 0; i < recorder->thread_count; i++) {
+        recorder_thread *thread = &recorder->threads[i];
+
+        for (u32 j = 0; j < recorder->frame_count; j++) {
+            VK_CHECK(vkCreateCommandPool(context->device.logical_device,
+                                         &pool_create_info,
+                                         NULL,
+                                         &thread->command_pools[j]));
+            thread->command_buffers[j] = darray_create(VkCommandBuffer);
+        }
+    }
+
+    return recorder;
+}
+
+void command_recorder_destroy(struct command_recorder *recorder, device *device) {
+    for (u32 i = 0; i < recorder->thread_count; i++) {
+        for (u32 j = 0; j < recorder->frame_count; j++) {
+            vkDestroyCommandPool(device->logical_device,
+                                 recorder->threads[i].command_pools[j],
+                                 NULL);
+            darray_destroy(recorder->threads[i].command_buffers[j]);
+        }
+    }
+
+    free(recorder->threads);
+    free(recorder);
+}
+
+/**
+ * Resets every thread's pool for the frame in one call each, so the secondary command buffers
+ * never have to be reset individually. The frame's timeline value must have been reached.
+ */
+void command_recorder_begin_frame(struct command_recorder *recorder,
+                                  device *device,
+                                  u32 frame_index) {
+    for (u32 i = 0; i < recorder->thread_count; i++) {
+        recorder_thread *thread = &recorder->threads[i];
+        VK_CHECK(vkResetCommandPool(device->logical_device, thread->command_pools[frame_index], 0));
+        thread->used_command_buffers[frame_index] = 0;
+    }
+}
+
+void command_recorder_record(struct command_recorder *recorder,
+                             const context *context,
+                             VkCommandBuffer primary_command_buffer,
+                             const VkCommandBufferInheritanceInfo *inheritance_info,
+                             VkExtent2D extent,
+                             const command_recording *recordings,
+                             u32 count) {
+    if (count == 0) {
+        return;
+    }
+
+    VkCommandBuffer secondary_command_buffers[count];
+
+    record_work work = {
+        .recorder = recorder,
+        .context = context,
+        .inheritance_info = inheritance_info,
+        .extent = extent,
+        .recordings = recordings,
+        .secondary_command_buffers = secondary_command_buffers,
+    };
+
+    // NOTE: One recording per job, so each is written on whichever thread picks it up.
+    job_parallel_for(count, 1, record_batch, &work);
+
+    vkCmdExecuteCommands(primary_command_buffer, count, secondary_command_buffers);
+}
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+static void record_batch(u32 start, u32 end, void *work) {
+    record_work *batch_work = work;
+    const context *context = batch_work->context;
+    u32 thread_index = job_thread_index();
+    if (thread_index == JOB_NO_THREAD) {
+        thread_index = batch_work->recorder->thread_count - 1;
+    }
+    recorder_thread *thread = &batch_work->recorder->threads[thread_index];
+
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                 VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = batch_work->inheritance_info,
+    };
+
+    // NOTE: Dynamic state is not inherited from the primary command buffer.
+    VkViewport viewport = {
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = (float)batch_work->extent.width,
+        .height = (float)batch_work->extent.height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+    };
+
+    VkRect2D scissor = {
+        .offset = {0, 0},
+        .extent = batch_work->extent,
+    };
+
+    for (u32 i = start; i < end; i++) {
+        const command_recording *recording = &batch_work->recordings[i];
+        PROFILE_SCOPE(recording->name ? recording->name : "record");
+
+        VkCommandBuffer command_buffer =
+            acquire_secondary_command_buffer(thread,
+                                             context->device.logical_device,
+                                             context->current_frame);
+
+        VK_CHECK(vkBeginCommandBuffer(command_buffer, &begin_info));
+        vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+        vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+        u32 scope = GPU_PROFILER_NO_SCOPE;
+        if (recording->name) {
+            scope =
+                gpu_profiler_begin_scope(context->gpu_profiler, command_buffer, recording->name);
+        }
+
+        recording->record(command_buffer, recording->user_data);
+
+        gpu_profiler_end_scope(context->gpu_profiler, command_buffer, scope);
+
+        VK_CHECK(vkEndCommandBuffer(command_buffer));
+
+        batch_work->secondary_command_buffers[i] = command_buffer;
+    }
+}
+
+static VkCommandBuffer acquire_secondary_command_buffer(recorder_thread *thread,
+                                                        VkDevice device,
+                                                        u32 frame_index) {
+    u32 used = thread->used_command_buffers[frame_index]++;
+    if (used < darray_length(thread->command_buffers[frame_index])) {
+        return thread->command_buffers[frame_index][used];
+    }
+
+    VkCommandBufferAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = thread->command_pools[frame_index],
+        .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+        .commandBufferCount = 1,
+    };
+
+    VkCommandBuffer command_buffer;
+    VK_CHECK(vkAllocateCommandBuffers(device, &alloc_info, &command_buffer));
+    darray_push(thread->command_buffers[frame_index], command_buffer);
+
+    return command_buffer;
+}
@@ -0,0 +1,35 @@
+#ifndef COMMAND_RECORDER_H
+#define COMMAND_RECORDER_H
+
+#include "types.h"
+
+typedef void (*record_commands_fn)(VkCommandBuffer command_buffer, void *user_data);
+
+typedef struct command_recording {
+    record_commands_fn record;
+    void *user_data;
+    // NOTE: Names a GPU profiler scope around the recording, NULL leaves it untimed.
+    const char *name;
+} command_recording;
+
+/**
+ * One command pool per job system thread and frame in flight. Recordings are written as jobs into
+ * secondary command buffers continuing the rendering scope described by the inheritance info, and
+ * executed by the primary in submission order. The job system must be initialized before the
+ * recorder is created, and only one thread outside the job system may record at a time.
+ */
+struct command_recorder *command_recorder_create(const context *context);
+void command_recorder_destroy(struct command_recorder *recorder, device *device);
+
+void command_recorder_begin_frame(struct command_recorder *recorder,
+                                  device *device,
+                                  u32 frame_index);
+void command_recorder_record(struct command_recorder *recorder,
+                             const context *context,
+                             VkCommandBuffer primary_command_buffer,
+                             const VkCommandBufferInheritanceInfo *inheritance_info,
+                             VkExtent2D extent,
+                             const command_recording *recordings,
+                             u32 count);
+
+#endif // COMMAND_RECORDER_H
@@ -0,0 +1,267 @@
+#include "config.h"
+
+#include "job.h"
+#include "json.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    CONFIG_OPTION_U32,
+    CONFIG_OPTION_BOOL,
+    CONFIG_OPTION_PRESENT_POLICY,
+    CONFIG_OPTION_PATH,
+} config_option_type;
+
+typedef struct {
+    const char *key;
+    config_option_type type;
+    u64 offset;
+} config_option;
+
+static const config_option options[] = {
+    {"workers", CONFIG_OPTION_U32, offsetof(config, worker_count)},
+    {"present-policy", CONFIG_OPTION_PRESENT_POLICY, offsetof(config, presentation.policy)},
+    {"frames-in-flight", CONFIG_OPTION_U32, offsetof(config, presentation.frames_in_flight)},
+    {"vsync", CONFIG_OPTION_BOOL, offsetof(config, presentation.vsync)},
+    {"width", CONFIG_OPTION_U32, offsetof(config, width)},
+    {"height", CONFIG_OPTION_U32, offsetof(config, height)},
+    {"headless", CONFIG_OPTION_BOOL, offsetof(config, headless)},
+    {"frames", CONFIG_OPTION_U32, offsetof(config, frame_count)},
+    {"capture", CONFIG_OPTION_PATH, offsetof(config, capture_path)},
+    {"gpu-trace", CONFIG_OPTION_PATH, offsetof(config, gpu_trace_path)},
+    {"cpu-trace", CONFIG_OPTION_PATH, offsetof(config, cpu_trace_path)},
+    {"frame-report", CONFIG_OPTION_PATH, offsetof(config, frame_report_path)},
+    {"hitch-ms", CONFIG_OPTION_U32, offsetof(config, hitch_threshold_ms)},
+    {"camera-path", CONFIG_OPTION_PATH, offsetof(config, camera_path)},
+    {"camera-record", CONFIG_OPTION_PATH, offsetof(config, camera_record_path)},
+    {"tick-rate", CONFIG_OPTION_U32, offsetof(config, tick_rate)},
+    {"summary", CONFIG_OPTION_BOOL, offsetof(config, summary)},
+    {"input-record", CONFIG_OPTION_PATH, offsetof(config, input_record_path)},
+    {"input-replay", CONFIG_OPTION_PATH, offsetof(config, input_replay_path)},
+    {"late-latch", CONFIG_OPTION_BOOL, offsetof(config, late_latch)},
+};
+
+#define option_count (sizeof(options) / sizeof(config_option))
+
+static const char *present_policy_names[] = {
+    [PRESENT_POLICY_LOW_LATENCY] = "low-latency",
+    [PRESENT_POLICY_THROUGHPUT] = "throughput",
+    [PRESENT_POLICY_ADAPTIVE] = "adaptive",
+};
+
+static void load_file(config *config, const char *file_name, b8 required);
+static b8 set_option(config *config,
+                     const char *key,
+                     u32 key_length,
+                     const char *value,
+                     u32 value_length);
+static b8 parse_value(const config_option *option, const char *value, void *out_value);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+config config_load(int argc, char **argv) {
+    // NOTE: Matches what the renderer did before presentation was configurable.
+    config config = {
+        .worker_count = job_default_worker_count(),
+        .presentation =
+            {
+                .policy = PRESENT_POLICY_THROUGHPUT,
+                .frames_in_flight = 0,
+                .vsync = false,
+            },
+        .width = 1280,
+        .height = 720,
+        // NOTE: Two refreshes at 60 Hz.
+        .hitch_threshold_ms = 33,
+        .late_latch = true,
+    };
+
+#ifdef GAME_BENCH
+    // NOTE: game_bench replays the same flight at a fixed step, so runs of different builds
+    // render the same frames.
+    snprintf(config.camera_path, CONFIG_PATH_LENGTH, "%s", GAME_BENCH_CAMERA_PATH);
+    config.tick_rate = 60;
+    config.summary = true;
+#endif
+
+    const char *file_name = CONFIG_FILE_NAME;
+    b8 file_required = false;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--config=", 9) == 0) {
+            file_name = argv[i] + 9;
+            file_required = true;
+        }
+    }
+
+    load_file(&config, file_name, file_required);
+
+    for (int i = 1; i < argc; i++) {
+        const char *argument = argv[i];
+        const char *separator = strchr(argument, '=');
+
+        if (strncmp(argument, "--", 2) != 0 || separator == NULL) {
+            fprintf(stderr, "Ignoring argument %s, expected --key=value\n", argument);
+            continue;
+        }
+
+        if (strncmp(argument, "--config=", 9) == 0) {
+            continue;
+        }
+
+        set_option(&config,
+                   argument + 2,
+                   separator - argument - 2,
+                   separator + 1,
+                   strlen(separator + 1));
+    }
+
+    return config;
+}
+
+const char *config_present_policy_name(present_policy policy) {
+    return present_policy_names[policy];
+}
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+static void load_file(config *config, const char *file_name, b8 required) {
+    FILE *fp = fopen(file_name, "rb");
+    if (!fp) {
+        if (required) {
+            fprintf(stderr, "Unable to open config file: %s\n", file_name);
+        }
+        return;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    u64 file_size = ftell(fp);
+    rewind(fp);
+
+    char *buffer = malloc(file_size);
+    if (fread(buffer, 1, file_size, fp) != file_size) {
+        fprintf(stderr, "Unable to read config file: %s\n", file_name);
+        free(buffer);
+        fclose(fp);
+        return;
+    }
+    fclose(fp);
+
+    json_value *root = json_parse(buffer, file_size);
+    free(buffer);
+
+    if (root == NULL || root->type != JSON_VALUE_OBJECT) {
+        fprintf(stderr, "%s is not a JSON object\n", file_name);
+        if (root != NULL) {
+            json_value_free(root);
+        }
+        return;
+    }
+
+    for (u32 i = 0; i < root->u.object.length; i++) {
+        json_object_member *member = &root->u.object.values[i];
+
+        // NOTE: Values go through the same string parsing as command line arguments.
+        char value[32];
+        const char *value_string = value;
+        u32 value_length;
+        switch (member->value->type) {
+        case JSON_VALUE_STRING:
+            value_string = member->value->u.string.ptr;
+            value_length = member->value->u.string.length;
+            break;
+        case JSON_VALUE_INTEGER:
+            value_length =
+                snprintf(value, sizeof(value), "%lld", (long long)member->value->u.integer);
+            break;
+        case JSON_VALUE_BOOLEAN:
+            value_length =
+                snprintf(value, sizeof(value), "%s", member->value->u.boolean ? "true" : "false");
+            break;
+        default:
+            fprintf(stderr,
+                    "%s: \"%.*s\" has an unsupported type\n",
+                    file_name,
+                    member->key_length,
+                    member->key);
+            continue;
+        }
+
+        set_option(config, member->key, member->key_length, value_string, value_length);
+    }
+
+    json_value_free(root);
+}
+
+static b8 set_option(config *config,
+                     const char *key,
+                     u32 key_length,
+                     const char *value,
+                     u32 value_length) {
+    for (u32 i = 0; i < option_count; i++) {
+        const config_option *option = &options[i];
+        if (strlen(option->key) != key_length || strncmp(option->key, key, key_length) != 0) {
+            continue;
+        }
+
+        char terminated_value[value_length + 1];
+        memcpy(terminated_value, value, value_length);
+        terminated_value[value_length] = '\0';
+
+        if (!parse_value(option, terminated_value, (u8 *)config + option->offset)) {
+            fprintf(stderr, "Invalid value for %s: %s\n", option->key, terminated_value);
+            return false;
+        }
+
+        return true;
+    }
+
+    fprintf(stderr, "Unknown config key: %.*s\n", key_length, key);
+    return false;
+}
+
+static b8 parse_value(const config_option *option, const char *value, void *out_value) {
+    switch (option->type) {
+    case CONFIG_OPTION_U32: {
+        char *end;
+        u64 number = strtoul(value, &end, 10);
+        if (*value == '\0' || *end != '\0' || number > UINT32_MAX) {
+            return false;
+        }
+        *(u32 *)out_value = number;
+        return true;
+    }
+    case CONFIG_OPTION_BOOL:
+        if (strcmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+            *(b8 *)out_value = true;
+            return true;
+        }
+        if (strcmp(value, "false") == 0 || strcmp(value, "0") == 0) {
+            *(b8 *)out_value = false;
+            return true;
+        }
+        return false;
+    case CONFIG_OPTION_PRESENT_POLICY:
+        for (u32 i = 0; i < sizeof(present_policy_names) / sizeof(const char *); i++) {
+            if (strcmp(value, present_policy_names[i]) == 0) {
+                *(present_policy *)out_value = i;
+                return true;
+            }
+        }
+        return false;
+    case CONFIG_OPTION_PATH:
+        if (strlen(value) >= CONFIG_PATH_LENGTH) {
+            return false;
+        }
+        strcpy(out_value, value);
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,64 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "defines.h"
+#include "types.h"
+
+#define CONFIG_FILE_NAME "config.json"
+#define CONFIG_PATH_LENGTH 256
+#define GAME_BENCH_CAMERA_PATH "camera_paths/orbit.json"
+
+typedef struct {
+    u32 worker_count;
+    presentation_settings presentation;
+
+    u32 width;
+    u32 height;
+    b8 headless;
+    // NOTE: 0 runs until the window is closed.
+    u32 frame_count;
+    // NOTE: Empty unless the last frame should be written to this file.
+    char capture_path[CONFIG_PATH_LENGTH];
+    // NOTE: Empty unless GPU scope timings should be written to this file as a Chrome trace.
+    char gpu_trace_path[CONFIG_PATH_LENGTH];
+    // NOTE: Empty unless CPU profiling zones should be written to this file on exit.
+    char cpu_trace_path[CONFIG_PATH_LENGTH];
+    // NOTE: Empty unless frame statistics should be written to this file on exit, as CSV when it
+    // ends in .csv and as JSON otherwise.
+    char frame_report_path[CONFIG_PATH_LENGTH];
+    // NOTE: Frames longer than this many milliseconds count as hitches.
+    u32 hitch_threshold_ms;
+
+    // NOTE: Empty unless the camera should follow this path instead of the input.
+    char camera_path[CONFIG_PATH_LENGTH];
+    // NOTE: Empty unless the camera should be recorded to this file as a path on exit.
+    char camera_record_path[CONFIG_PATH_LENGTH];
+    // NOTE: Simulation ticks per second, each advancing time by the same step. 0 advances by the
+    // wall clock time between ticks.
+    u32 tick_rate;
+    // NOTE: Prints a single JSON line of frame statistics on exit.
+    b8 summary;
+
+    // NOTE: Empty unless every key and cursor event should be logged to this file.
+    char input_record_path[CONFIG_PATH_LENGTH];
+    // NOTE: Empty unless the input should come from this log instead of the window.
+    char input_replay_path[CONFIG_PATH_LENGTH];
+    // NOTE: Builds the camera matrices from the newest input right before each frame is
+    // submitted instead of from the input of the frame's tick. Ignored while replaying.
+    b8 late_latch;
+} config;
+
+/**
+ * Starts from the defaults, applies the JSON object in CONFIG_FILE_NAME (or the file given with
+ * --config=path) and then every --key=value argument. Both use the same keys: workers,
+ * present-policy (low-latency, throughput or adaptive), frames-in-flight, vsync, width, height,
+ * headless, frames, capture, gpu-trace, cpu-trace, frame-report,
+ * hitch-ms, camera-path, camera-record, tick-rate, summary, input-record, input-replay and
+ * late-latch.
+ */
+config config_load(int argc, char **argv);
+
+// NOTE: The name present-policy takes for the policy.
+const char *config_present_policy_name(present_policy policy);
+
+#endif // CONFIG_H
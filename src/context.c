@@ -1,12 +1,37 @@
 #include "context.h"
 
+#include "bindless.h"
 #include "command_buffer.h"
+#include "command_recorder.h"
+#include "config.h"
 #include "darray.h"
+#include "deletion_queue.h"
 #include "device.h"
+#include "gpu_profiler.h"
+#include "pipeline.h"
+#include "pipeline_cache.h"
+#include "profiler.h"
+#include "render_graph.h"
+#include "resource_registry.h"
 #include "swapchain.h"
+#include "timeline.h"
+#include "timer.h"
 #include "types.h"
 #include "vulkan/vulkan_core.h"
 
+#include <string.h>
+
+#define PIPELINE_CACHE_FILE_NAME "pipeline_cache.bin"
+
+#define FRAME_TIME_SMOOTHING 0.05
+// NOTE: The GPU counts as the bottleneck once it is busy for this much of the frame interval.
+#define ADAPTIVE_GPU_BOUND_RATIO 0.85
+// NOTE: Frames a new frame count has to stay preferred before the adaptive policy switches.
+#define ADAPTIVE_SWITCH_FRAMES 120
+// NOTE: How long the requested framebuffer size has to stay the same before the swapchain is
+// recreated for it.
+#define RESIZE_DEBOUNCE_MS 50.0
+
 const char *validation_layers[] = {"VK_LAYER_KHRONOS_validation"};
 #define validation_layer_count sizeof(validation_layers) / sizeof(const char *)
 
@@ -19,205 +44,184 @@ static void destroy_debug_utils_messenger_ext(VkInstance instance,
                                               VkDebugUtilsMessengerEXT debugMessenger,
                                               const VkAllocationCallbacks *pAllocator);
 static void populate_debug_messenger_create_info(VkDebugUtilsMessengerCreateInfoEXT *create_info);
-static const char **get_required_extensions();
+static const char **get_required_extensions(b8 headless);
 static i32 find_memory_index(const context *context, u32 type_filter, u32 property_flags);
+static context create(GLFWwindow *window,
+                      u32 width,
+                      u32 height,
+                      b8 readback,
+                      const presentation_settings *presentation);
 static void create_render_pass(context *context);
-
-context context_new(GLFWwindow *window) {
+static void declare_frame_targets(context *context);
+static void record_main_pass(VkCommandBuffer command_buffer, void *user_data);
+static void record_readback(VkCommandBuffer command_buffer, void *user_data);
+static void choose_frames_in_flight(context *context, const presentation_settings *presentation);
+static void update_frame_timing(context *context);
+static void adapt_frames_in_flight(context *context);
+static void finish_frame_timing(context *context);
+static void recreate_swapchain_if_stale(context *context, u64 now_ns);
+static void recreate_swapchain(context *context);
+static b8 requested_size_is_empty(const context *context);
+static VkResult acquire_image(context *context);
+
+context context_new(GLFWwindow *window, const presentation_settings *presentation) {
     int width, height;
-    glfwGetWindowSize(window, &width, &height);
-
-    context context = {
-        .find_memory_index = find_memory_index,
-        .framebuffer_width = width,
-        .framebuffer_height = height,
-    };
-
-    VkApplicationInfo app_info = {
-        .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
-        .pApplicationName = "Vulkan Game",
-        .applicationVersion = VK_MAKE_VERSION(0, 1, 0),
-        .pEngineName = "Vulkan Game",
-        .engineVersion = VK_MAKE_VERSION(0, 1, 0),
-        .apiVersion = VK_API_VERSION_1_3,
-    };
-
-    const char **required_extensions = get_required_extensions();
-
-#ifndef NDEBUG
-    VkDebugUtilsMessengerCreateInfoEXT debug_create_info;
-    populate_debug_messenger_create_info(&debug_create_info);
-#endif
-
-    VkInstanceCreateInfo instance_create_info = {
-        .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
-        .pApplicationInfo = &app_info,
-        .enabledExtensionCount = darray_length(required_extensions),
-        .ppEnabledExtensionNames = required_extensions,
-#ifndef NDEBUG
-        .enabledLayerCount = validation_layer_count,
-        .ppEnabledLayerNames = validation_layers,
-        .pNext = &debug_create_info,
-#endif
-    };
-
-    VK_CHECK(vkCreateInstance(&instance_create_info, NULL, &context.instance));
-    darray_destroy(required_extensions);
-
-#ifndef NDEBUG
-    VK_CHECK(create_debug_utils_messenger_ext(context.instance,
-                                              &debug_create_info,
-                                              NULL,
-                                              &context.debug_messenger));
-#endif
+    glfwGetFramebufferSize(window, &width, &height);
 
-    VK_CHECK(glfwCreateWindowSurface(context.instance, window, NULL, &context.surface));
-
-    device_new(&context);
-
-    if (!device_detect_depth_format(&context.device)) {
-        context.device.depth_format = VK_FORMAT_UNDEFINED;
-        fprintf(stderr, "Failed to find a supported format!\n");
-        exit(EXIT_FAILURE);
-    }
-
-    create_render_pass(&context);
-
-    swapchain_create(&context,
-                     context.framebuffer_width,
-                     context.framebuffer_height,
-                     &context.swapchain);
-
-    VkCommandBufferAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = context.device.graphics_command_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = MAX_FRAMES_IN_FLIGHT,
-    };
-
-    VK_CHECK(vkAllocateCommandBuffers(context.device.logical_device,
-                                      &alloc_info,
-                                      context.graphics_command_buffers));
+    return create(window, width, height, false, presentation);
+}
 
-    VkSemaphoreCreateInfo semaphore_info = {
-        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-    };
+/**
+ * Creates a context without a window, surface or swapchain: frames are rendered into offscreen
+ * images and the device does not need present support, so it runs on machines without a display
+ * or GPU (e.g. lavapipe). With readback every frame is copied to host memory, see
+ * context_read_frame.
+ */
+context context_new_headless(u32 width,
+                             u32 height,
+                             b8 readback,
+                             const presentation_settings *presentation) {
+    return create(NULL, width, height, readback, presentation);
+}
 
-    VkFenceCreateInfo fence_info = {
-        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-        .flags = VK_FENCE_CREATE_SIGNALED_BIT,
-    };
+/**
+ * Requests a swapchain of the given size, from any thread. The render thread recreates the
+ * swapchain at the start of a frame once the size has settled, see recreate_swapchain_if_stale.
+ */
+void context_on_resized(context *context, u32 width, u32 height) {
+    u64 size = (u64)width << 32 | height;
 
-    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        VK_CHECK(vkCreateSemaphore(context.device.logical_device,
-                                   &semaphore_info,
-                                   NULL,
-                                   &context.image_available_semaphores[i]))
-        VK_CHECK(vkCreateSemaphore(context.device.logical_device,
-                                   &semaphore_info,
-                                   NULL,
-                                   &context.render_finished_semaphores[i]))
-        VK_CHECK(vkCreateFence(context.device.logical_device,
-                               &fence_info,
-                               NULL,
-                               &context.in_flight_fences[i]))
+    // NOTE: Cheap to call every time the window is polled, only changes start a new generation.
+    if (atomic_load(&context->requested_framebuffer_size) == size) {
+        return;
     }
 
-    return context;
-}
-
-void context_on_resized(context *context, u32 width, u32 height) {
-    context->framebuffer_width = width;
-    context->framebuffer_height = height;
-    context->framebuffer_size_generation++;
+    atomic_store(&context->requested_framebuffer_size, size);
+    atomic_fetch_add(&context->framebuffer_size_generation, 1);
 }
 
 void context_begin_main_loop(context *context) { (void)context; }
 
+/**
+ * Waits for the frame slot and acquires the next image.
+ * @returns the frame's command buffer, or VK_NULL_HANDLE when the window is minimized and the
+ * frame has to be skipped, in which case context_end_frame must not be called for it.
+ */
 VkCommandBuffer context_begin_frame(context *context) {
-context_begin_frame_start:
-
-    vkWaitForFences(context->device.logical_device,
-                    1,
-                    &context->in_flight_fences[context->current_frame],
-                    VK_TRUE,
-                    UINT64_MAX);
-
-    VkResult result =
-        vkAcquireNextImageKHR(context->device.logical_device,
-                              context->swapchain.handle,
-                              UINT64_MAX,
-                              context->image_available_semaphores[context->current_frame],
-                              VK_NULL_HANDLE,
-                              &context->image_index);
-
-    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-        swapchain_recreate(context,
-                           context->framebuffer_width,
-                           context->framebuffer_height,
-                           &context->swapchain);
-        goto context_begin_frame_start;
-    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+    u64 begin_ns = timer_now_ns();
+    context->frame_interval_ms = context->frame_begin_ns != 0
+                                     ? (f64)(begin_ns - context->frame_begin_ns) / 1000000.0
+                                     : FRAME_STATS_NO_SAMPLE;
+    context->frame_begin_ns = begin_ns;
+
+    PROFILE_BEGIN(frame_wait_zone, "wait for frame");
+    timeline_wait(context->timeline,
+                  TIMELINE_QUEUE_GRAPHICS,
+                  context->frame_timeline_values[context->current_frame]);
+    PROFILE_END(frame_wait_zone);
+
+    timeline_run_deferred(context->timeline, context);
+
+    // NOTE: Headless contexts own one offscreen image per frame in flight.
+    VkResult result = VK_SUCCESS;
+    if (context->headless) {
+        context->image_index = context->current_frame;
+    } else {
+        recreate_swapchain_if_stale(context, begin_ns);
+
+        PROFILE_SCOPE("acquire");
+        // NOTE: An out of date swapchain cannot be acquired from at all, so it is recreated
+        // without waiting for the size to settle. A minimized window may report it out of date
+        // too, but has no size to create one at until it is restored.
+        while ((result = acquire_image(context)) == VK_ERROR_OUT_OF_DATE_KHR) {
+            if (requested_size_is_empty(context)) {
+                return VK_NULL_HANDLE;
+            }
+            recreate_swapchain(context);
+        }
+    }
+
+    if (result == VK_SUBOPTIMAL_KHR) {
+        context->swapchain_suboptimal = true;
+    } else if (result != VK_SUCCESS) {
         fprintf(stderr, "Failed to acquire swapchain image!\n");
         exit(EXIT_FAILURE);
     }
 
-    vkResetFences(context->device.logical_device,
-                  1,
-                  &context->in_flight_fences[context->current_frame]);
+    // NOTE: Includes the wait for the frame slot, which is as unavailable as the image.
+    context->acquire_time_ms = timer_elapsed_ms(begin_ns);
+
+    VK_CHECK(vkResetCommandPool(context->device.logical_device,
+                                context->frame_command_pools[context->current_frame],
+                                0));
+    command_recorder_begin_frame(context->command_recorder,
+                                 &context->device,
+                                 context->current_frame);
 
     VkCommandBuffer command_buffer = context->graphics_command_buffers[context->current_frame];
-    vkResetCommandBuffer(command_buffer, 0);
 
     VkCommandBufferBeginInfo begin_info = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
     };
 
     VK_CHECK(vkBeginCommandBuffer(command_buffer, &begin_info));
 
-    VkClearValue clear_values[] = {
-        (VkClearValue){.color = {{0.2f, 0.2f, 0.2f, 1.0f}}},
-        (VkClearValue){.depthStencil = {1.0f, 0}},
-    };
+    gpu_profiler_begin_frame(context->gpu_profiler,
+                             &context->device,
+                             command_buffer,
+                             context->current_frame);
+    context->gpu_frame_scope = gpu_profiler_begin_scope(context->gpu_profiler,
+                                                        command_buffer,
+                                                        "frame");
 
-    VkRenderPassBeginInfo render_pass_info = {
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-        .renderPass = context->render_pass,
-        .framebuffer = context->swapchain.framebuffers[context->image_index],
-        .renderArea =
-            {
-                .offset = {0, 0},
-                .extent = {context->framebuffer_width, context->framebuffer_height},
-            },
-        .clearValueCount = sizeof(clear_values) / sizeof(VkClearValue),
-        .pClearValues = clear_values,
-    };
-
-    vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+    update_frame_timing(context);
 
-    VkViewport viewport = {
-        .x = 0.0f,
-        .y = 0.0f,
-        .width = (float)context->framebuffer_width,
-        .height = (float)context->framebuffer_height,
-        .minDepth = 0.0f,
-        .maxDepth = 1.0f,
-    };
-    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
-
-    VkRect2D scissor = {
-        .offset = {0, 0},
-        .extent = {context->framebuffer_width, context->framebuffer_height},
-    };
-    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    declare_frame_targets(context);
 
     return context->graphics_command_buffers[context->current_frame];
 }
 
+/**
+ * Queues the given recordings for the frame's main pass, which records them into secondary
+ * command buffers spread over the command recorder's threads once the frame's render graph
+ * executes, and runs them in order. May be called several times between context_begin_frame and
+ * context_end_frame; the recordings' user data has to stay valid until context_end_frame.
+ */
+void context_record(context *context, const command_recording *recordings, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        darray_push(context->frame_recordings, recordings[i]);
+    }
+}
+
 void context_end_frame(context *context) {
     VkCommandBuffer command_buffer = context->graphics_command_buffers[context->current_frame];
 
-    vkCmdEndRenderPass(command_buffer);
+    if (context->swapchain.readback_buffers) {
+        u32 readback_buffer =
+            render_graph_import_buffer(context->render_graph,
+                                       "readback",
+                                       context->swapchain.readback_buffers[context->image_index],
+                                       true);
+        u32 readback_pass = render_graph_add_pass(context->render_graph,
+                                                  "readback",
+                                                  RENDER_GRAPH_PASS_TRANSFER,
+                                                  record_readback,
+                                                  context);
+        render_graph_use(context->render_graph,
+                         readback_pass,
+                         context->frame_color_target,
+                         RENDER_GRAPH_TRANSFER_READ);
+        render_graph_use(context->render_graph,
+                         readback_pass,
+                         readback_buffer,
+                         RENDER_GRAPH_TRANSFER_WRITE);
+    }
+
+    render_graph_execute(context->render_graph, context, command_buffer);
+    darray_clear(context->frame_recordings);
+
+    gpu_profiler_end_scope(context->gpu_profiler, command_buffer, context->gpu_frame_scope);
 
     VK_CHECK(vkEndCommandBuffer(command_buffer));
 
@@ -226,21 +230,44 @@ void context_end_frame(context *context) {
 
     VkSemaphore signal_semaphores[] = {context->render_finished_semaphores[context->current_frame]};
 
+    // NOTE: Without a swapchain there is nothing to wait for or to present.
     VkSubmitInfo submit_info = {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .waitSemaphoreCount = 1,
+        .waitSemaphoreCount = context->headless ? 0 : 1,
         .pWaitSemaphores = wait_semaphores,
         .pWaitDstStageMask = wait_stages,
         .commandBufferCount = 1,
         .pCommandBuffers = &context->graphics_command_buffers[context->current_frame],
-        .signalSemaphoreCount = 1,
+        .signalSemaphoreCount = context->headless ? 0 : 1,
         .pSignalSemaphores = signal_semaphores,
     };
 
-    VK_CHECK(vkQueueSubmit(context->device.graphics_queue,
-                           1,
-                           &submit_info,
-                           context->in_flight_fences[context->current_frame]));
+    context->input_latency_ms = FRAME_STATS_NO_SAMPLE;
+    if (context->late_latch) {
+        PROFILE_BEGIN(latch_zone, "late latch");
+        u64 input_ns = context->late_latch(context, context->late_latch_user_data);
+        context->input_latency_ms = timer_elapsed_ms(input_ns);
+        PROFILE_END(latch_zone);
+    }
+
+    PROFILE_BEGIN(submit_zone, "submit");
+    context->frame_timeline_values[context->current_frame] =
+        timeline_submit(context->timeline, TIMELINE_QUEUE_GRAPHICS, &submit_info);
+    PROFILE_END(submit_zone);
+
+    deletion_queue_submit(context->deletion_queue,
+                          context->frame_timeline_values[context->current_frame]);
+
+    context->last_submitted_frame = context->current_frame;
+    context->frame_submitted = true;
+
+    if (context->headless) {
+        context->present_time_ms = 0.0;
+        finish_frame_timing(context);
+
+        context->current_frame = (context->current_frame + 1) % context->frames_in_flight;
+        return;
+    }
 
     VkSwapchainKHR swapchains[] = {context->swapchain.handle};
 
@@ -254,42 +281,119 @@ void context_end_frame(context *context) {
         .pResults = NULL,
     };
 
+    u64 present_ns = timer_now_ns();
+    PROFILE_BEGIN(present_zone, "present");
     VkResult result = vkQueuePresentKHR(context->device.present_queue, &present_info);
+    PROFILE_END(present_zone);
+    context->present_time_ms = timer_elapsed_ms(present_ns);
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
-        context->framebuffer_resized) {
-        context->framebuffer_resized = false;
-        swapchain_recreate(context,
-                           context->framebuffer_width,
-                           context->framebuffer_height,
-                           &context->swapchain);
+    // NOTE: Recreated at the start of the next frame, after it has waited for its frame slot.
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        context->swapchain_suboptimal = true;
     } else
         VK_CHECK(result);
 
-    context->current_frame = (context->current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+    finish_frame_timing(context);
+
+    context->current_frame = (context->current_frame + 1) % context->frames_in_flight;
+}
+
+void context_end_main_loop(context *context) { timeline_flush(context->timeline, context); }
+
+void context_set_late_latch(context *context,
+                            u64 (*latch)(context *context, void *user_data),
+                            void *user_data) {
+    context->late_latch = latch;
+    context->late_latch_user_data = user_data;
 }
 
-void context_end_main_loop(context *context) { vkDeviceWaitIdle(context->device.logical_device); }
+/**
+ * Reports the last frame ended. Its GPU time is the most recent one read back, which belongs to
+ * the frame that last used the same frame slot.
+ */
+void context_frame_timing(const context *context, frame_timing *out_timing) {
+    f64 gpu_time_ms;
+    if (!gpu_profiler_frame_time(context->gpu_profiler, &gpu_time_ms)) {
+        gpu_time_ms = FRAME_STATS_NO_SAMPLE;
+    }
+
+    out_timing->ms[FRAME_METRIC_FRAME] = context->frame_interval_ms;
+    out_timing->ms[FRAME_METRIC_CPU] = context->cpu_time_ms;
+    out_timing->ms[FRAME_METRIC_GPU] = gpu_time_ms;
+    out_timing->ms[FRAME_METRIC_ACQUIRE] = context->acquire_time_ms;
+    out_timing->ms[FRAME_METRIC_PRESENT] = context->headless ? FRAME_STATS_NO_SAMPLE
+                                                             : context->present_time_ms;
+    out_timing->ms[FRAME_METRIC_INPUT_LATENCY] = context->input_latency_ms;
+}
+
+/**
+ * Waits for the most recently submitted frame and copies its color image into pixels, which must
+ * hold framebuffer_width * framebuffer_height texels of swapchain.image_format, 4 bytes each.
+ * @returns false unless the context is headless with readback and has submitted a frame.
+ */
+b8 context_read_frame(context *context, void *pixels) {
+    if (!context->swapchain.readback_buffers || !context->frame_submitted) {
+        return false;
+    }
+
+    u32 frame = context->last_submitted_frame;
+    timeline_wait(context->timeline,
+                  TIMELINE_QUEUE_GRAPHICS,
+                  context->frame_timeline_values[frame]);
+
+    memcpy(pixels,
+           context->swapchain.readback_mapped[frame],
+           (u64)context->framebuffer_width * context->framebuffer_height * 4);
+
+    return true;
+}
 
 void context_cleanup(context *context) {
+    timeline_flush(context->timeline, context);
+    // NOTE: Offscreen images are released to the deletion queue, so before it is flushed.
     swapchain_destroy(context, &context->swapchain);
+    deletion_queue_flush(context->deletion_queue, context);
+    render_graph_destroy(context->render_graph, context);
+    context->render_graph = NULL;
+    darray_destroy(context->frame_recordings);
+    context->frame_recordings = NULL;
+    resource_registry_destroy(context->resources, context);
+    context->resources = NULL;
 
     vkDestroyRenderPass(context->device.logical_device, context->render_pass, NULL);
 
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    command_recorder_destroy(context->command_recorder, &context->device);
+    context->command_recorder = NULL;
+
+    for (u32 i = 0; i < context->max_frames_in_flight; i++) {
+        vkDestroyCommandPool(context->device.logical_device, context->frame_command_pools[i], NULL);
         vkDestroySemaphore(context->device.logical_device,
                            context->image_available_semaphores[i],
                            NULL);
         vkDestroySemaphore(context->device.logical_device,
                            context->render_finished_semaphores[i],
                            NULL);
-        vkDestroyFence(context->device.logical_device, context->in_flight_fences[i], NULL);
     }
 
+    gpu_profiler_destroy(context->gpu_profiler, &context->device);
+    context->gpu_profiler = NULL;
+
+    bindless_set_destroy(context);
+    pipeline_registry_destroy(context->pipeline_registry, &context->device);
+    context->pipeline_registry = NULL;
+    pipeline_cache_destroy(context, PIPELINE_CACHE_FILE_NAME);
+
+    deletion_queue_destroy(context->deletion_queue);
+    context->deletion_queue = NULL;
+    timeline_destroy(context->timeline);
+    context->timeline = NULL;
+
     device_destroy(&context->device);
 
-    vkDestroySurfaceKHR(context->instance, context->surface, NULL);
-    context->surface = NULL;
+    if (context->surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(context->instance, context->surface, NULL);
+        context->surface = NULL;
+    }
 
 #ifndef NDEBUG
     destroy_debug_utils_messenger_ext(context->instance, context->debug_messenger, NULL);
@@ -300,12 +404,15 @@ void context_cleanup(context *context) {
     context->instance = NULL;
 }
 
-void context_create_buffer(const context *context,
-                           VkDeviceSize size,
-                           VkBufferUsageFlags usage,
-                           VkMemoryPropertyFlags properties,
-                           VkBuffer *buffer,
-                           VkDeviceMemory *buffer_memory) {
+/**
+ * @returns The size of the memory allocated for the buffer, which may be larger than size.
+ */
+VkDeviceSize context_create_buffer(const context *context,
+                                   VkDeviceSize size,
+                                   VkBufferUsageFlags usage,
+                                   VkMemoryPropertyFlags properties,
+                                   VkBuffer *buffer,
+                                   VkDeviceMemory *buffer_memory) {
     VkBufferCreateInfo buffer_info = {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .size = size,
@@ -328,13 +435,17 @@ void context_create_buffer(const context *context,
     VK_CHECK(vkAllocateMemory(context->device.logical_device, &alloc_info, NULL, buffer_memory));
 
     vkBindBufferMemory(context->device.logical_device, *buffer, *buffer_memory, 0);
+
+    return memory_requirements.size;
 }
 
-void context_copy_buffer(const context *context,
-                         VkBuffer src_buffer,
-                         VkBuffer dst_buffer,
-                         VkDeviceSize size) {
+u64 context_copy_buffer(const context *context,
+                        VkBuffer src_buffer,
+                        VkBuffer dst_buffer,
+                        VkDeviceSize size) {
     VkCommandBuffer command_buffer = begin_single_time_commands(context);
+    u32 scope =
+        gpu_profiler_begin_immediate(context->gpu_profiler, &context->device, command_buffer);
 
     VkBufferCopy copy_region = {
         .srcOffset = 0,
@@ -343,8 +454,351 @@ void context_copy_buffer(const context *context,
     };
 
     vkCmdCopyBuffer(command_buffer, src_buffer, dst_buffer, 1, &copy_region);
+    context_upload_barrier(command_buffer);
+
+    gpu_profiler_end_immediate(context->gpu_profiler, command_buffer, scope, "upload");
+    u64 value = submit_single_time_commands(context, command_buffer);
+    gpu_profiler_submit_immediate(context->gpu_profiler, scope, value);
+
+    return value;
+}
 
-    end_single_time_commands(context, command_buffer);
+/**
+ * Makes transfer writes recorded before it visible to every later command on the queue, which is
+ * what lets an upload be submitted without waiting for it: the frames using the data are
+ * submitted to the same queue afterwards.
+ */
+void context_upload_barrier(VkCommandBuffer command_buffer) {
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+    };
+
+    vkCmdPipelineBarrier(command_buffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         NULL,
+                         0,
+                         NULL);
+}
+
+void context_destroy_buffer(const context *context, VkBuffer buffer, VkDeviceMemory buffer_memory) {
+    deletion_queue_push(context->deletion_queue,
+                        (deletion){.type = DELETION_BUFFER, .buffer = buffer});
+    deletion_queue_push(context->deletion_queue,
+                        (deletion){.type = DELETION_DEVICE_MEMORY, .memory = buffer_memory});
+}
+
+void context_destroy_buffer_after(const context *context,
+                                  u64 value,
+                                  VkBuffer buffer,
+                                  VkDeviceMemory buffer_memory) {
+    deletion_queue_push_after(context->deletion_queue,
+                              TIMELINE_QUEUE_GRAPHICS,
+                              value,
+                              (deletion){.type = DELETION_BUFFER, .buffer = buffer});
+    deletion_queue_push_after(context->deletion_queue,
+                              TIMELINE_QUEUE_GRAPHICS,
+                              value,
+                              (deletion){.type = DELETION_DEVICE_MEMORY, .memory = buffer_memory});
+}
+
+static context create(GLFWwindow *window,
+                      u32 width,
+                      u32 height,
+                      b8 readback,
+                      const presentation_settings *presentation) {
+    context context = {
+        .find_memory_index = find_memory_index,
+        .framebuffer_width = width,
+        .framebuffer_height = height,
+        .requested_framebuffer_size = (u64)width << 32 | height,
+        .headless = window == NULL,
+    };
+
+    choose_frames_in_flight(&context, presentation);
+
+    VkApplicationInfo app_info = {
+        .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+        .pApplicationName = "Vulkan Game",
+        .applicationVersion = VK_MAKE_VERSION(0, 1, 0),
+        .pEngineName = "Vulkan Game",
+        .engineVersion = VK_MAKE_VERSION(0, 1, 0),
+        .apiVersion = VK_API_VERSION_1_3,
+    };
+
+    const char **required_extensions = get_required_extensions(context.headless);
+
+#ifndef NDEBUG
+    VkDebugUtilsMessengerCreateInfoEXT debug_create_info;
+    populate_debug_messenger_create_info(&debug_create_info);
+#endif
+
+    VkInstanceCreateInfo instance_create_info = {
+        .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+        .pApplicationInfo = &app_info,
+        .enabledExtensionCount = darray_length(required_extensions),
+        .ppEnabledExtensionNames = required_extensions,
+#ifndef NDEBUG
+        .enabledLayerCount = validation_layer_count,
+        .ppEnabledLayerNames = validation_layers,
+        .pNext = &debug_create_info,
+#endif
+    };
+
+    VK_CHECK(vkCreateInstance(&instance_create_info, NULL, &context.instance));
+    darray_destroy(required_extensions);
+
+#ifndef NDEBUG
+    VK_CHECK(create_debug_utils_messenger_ext(context.instance,
+                                              &debug_create_info,
+                                              NULL,
+                                              &context.debug_messenger));
+#endif
+
+    if (!context.headless) {
+        VK_CHECK(glfwCreateWindowSurface(context.instance, window, NULL, &context.surface));
+    }
+
+    device_new(&context);
+    context.timeline = timeline_create(&context.device);
+    context.deletion_queue = deletion_queue_create(context.timeline);
+    context.resources = resource_registry_create();
+    context.render_graph = render_graph_create();
+    context.frame_recordings = darray_create(command_recording);
+
+    if (!device_detect_depth_format(&context.device)) {
+        context.device.depth_format = VK_FORMAT_UNDEFINED;
+        fprintf(stderr, "Failed to find a supported format!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    pipeline_cache_create(&context, PIPELINE_CACHE_FILE_NAME);
+    context.pipeline_registry = pipeline_registry_create();
+    bindless_set_create(&context);
+
+    if (!context.device.supports_dynamic_rendering) {
+        create_render_pass(&context);
+    }
+
+    if (context.headless) {
+        swapchain_create_offscreen(&context,
+                                   context.framebuffer_width,
+                                   context.framebuffer_height,
+                                   readback,
+                                   &context.swapchain);
+    } else {
+        swapchain_create(&context,
+                         context.framebuffer_width,
+                         context.framebuffer_height,
+                         &context.swapchain);
+    }
+
+    // NOTE: The surface may dictate a different extent than the one asked for.
+    context.framebuffer_width = context.swapchain.extent.width;
+    context.framebuffer_height = context.swapchain.extent.height;
+
+    if (context.frames_in_flight > context.swapchain.max_frames_in_flight) {
+        context.frames_in_flight = context.swapchain.max_frames_in_flight;
+    }
+
+    context.gpu_profiler = gpu_profiler_create(&context);
+
+    VkCommandPoolCreateInfo frame_pool_create_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .queueFamilyIndex = context.device.graphics_queue_index,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+    };
+
+    for (u32 i = 0; i < context.max_frames_in_flight; i++) {
+        VK_CHECK(vkCreateCommandPool(context.device.logical_device,
+                                     &frame_pool_create_info,
+                                     NULL,
+                                     &context.frame_command_pools[i]));
+
+        VkCommandBufferAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = context.frame_command_pools[i],
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+
+        VK_CHECK(vkAllocateCommandBuffers(context.device.logical_device,
+                                          &alloc_info,
+                                          &context.graphics_command_buffers[i]));
+    }
+
+    context.command_recorder = command_recorder_create(&context);
+
+    VkSemaphoreCreateInfo semaphore_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    };
+
+    for (u32 i = 0; i < context.max_frames_in_flight; i++) {
+        VK_CHECK(vkCreateSemaphore(context.device.logical_device,
+                                   &semaphore_info,
+                                   NULL,
+                                   &context.image_available_semaphores[i]))
+        VK_CHECK(vkCreateSemaphore(context.device.logical_device,
+                                   &semaphore_info,
+                                   NULL,
+                                   &context.render_finished_semaphores[i]))
+    }
+
+    return context;
+}
+
+static void choose_frames_in_flight(context *context, const presentation_settings *presentation) {
+    context->presentation = *presentation;
+
+    u32 frames_in_flight = presentation->frames_in_flight;
+    if (frames_in_flight == 0) {
+        frames_in_flight = presentation->policy == PRESENT_POLICY_LOW_LATENCY ? 2 : 3;
+    }
+    context->max_frames_in_flight = CLAMP(frames_in_flight, 1, MAX_FRAMES_IN_FLIGHT);
+
+    // NOTE: Adaptive starts one frame short of its maximum and only adds it back once the GPU
+    // turns out to be the bottleneck.
+    context->frames_in_flight = context->max_frames_in_flight;
+    if (presentation->policy == PRESENT_POLICY_ADAPTIVE && context->frames_in_flight > 1) {
+        context->frames_in_flight--;
+    }
+
+    printf("Presentation policy: %s, %u of %u frames in flight, vsync %s.\n",
+           config_present_policy_name(presentation->policy),
+           context->frames_in_flight,
+           context->max_frames_in_flight,
+           presentation->vsync ? "on" : "off");
+}
+
+/**
+ * Called once the current frame slot is free again and the GPU profiler has read back the
+ * timestamps this frame slot held.
+ */
+static void update_frame_timing(context *context) {
+    u64 now = timer_now_ns();
+    if (context->last_frame_start_ns != 0) {
+        f64 interval_ms = (f64)(now - context->last_frame_start_ns) / 1000000.0;
+        context->average_frame_interval_ms +=
+            (interval_ms - context->average_frame_interval_ms) * FRAME_TIME_SMOOTHING;
+    }
+    context->last_frame_start_ns = now;
+
+    if (gpu_profiler_frame_time(context->gpu_profiler, &context->gpu_frame_time_ms)) {
+        context->average_gpu_frame_time_ms +=
+            (context->gpu_frame_time_ms - context->average_gpu_frame_time_ms) *
+            FRAME_TIME_SMOOTHING;
+    }
+
+    if (context->presentation.policy == PRESENT_POLICY_ADAPTIVE) {
+        adapt_frames_in_flight(context);
+    }
+}
+
+/**
+ * A GPU-bound frame loop keeps the extra frame in flight so the GPU never starves, a CPU-bound
+ * one drops it since it would only add a frame of latency.
+ */
+static void adapt_frames_in_flight(context *context) {
+    if (!gpu_profiler_enabled(context->gpu_profiler) || context->max_frames_in_flight == 1) {
+        return;
+    }
+
+    b8 gpu_bound = context->average_gpu_frame_time_ms >
+                   context->average_frame_interval_ms * ADAPTIVE_GPU_BOUND_RATIO;
+
+    u32 target = gpu_bound ? context->max_frames_in_flight : context->max_frames_in_flight - 1;
+    if (target > context->swapchain.max_frames_in_flight) {
+        target = context->swapchain.max_frames_in_flight;
+    }
+
+    if (target == context->frames_in_flight) {
+        context->adaptive_switch_frames = 0;
+        return;
+    }
+
+    if (++context->adaptive_switch_frames < ADAPTIVE_SWITCH_FRAMES) {
+        return;
+    }
+
+    context->adaptive_switch_frames = 0;
+    context->frames_in_flight = target;
+
+    printf("Adaptive presentation: %u frames in flight (GPU %.2f ms of a %.2f ms frame).\n",
+           target,
+           context->average_gpu_frame_time_ms,
+           context->average_frame_interval_ms);
+}
+
+static void finish_frame_timing(context *context) {
+    context->cpu_time_ms = timer_elapsed_ms(context->frame_begin_ns) - context->acquire_time_ms -
+                           context->present_time_ms;
+}
+
+/**
+ * Recreates the swapchain once the requested size has not changed for RESIZE_DEBOUNCE_MS, so a
+ * burst of resize events while dragging a window edge rebuilds it once, or right away when it
+ * only went suboptimal. A minimized window keeps the old swapchain until it is restored.
+ */
+static void recreate_swapchain_if_stale(context *context, u64 now_ns) {
+    u64 generation = atomic_load(&context->framebuffer_size_generation);
+    if (generation != context->framebuffer_size_seen_generation) {
+        context->framebuffer_size_seen_generation = generation;
+        context->framebuffer_size_changed_ns = now_ns;
+    }
+
+    b8 resized = generation != context->framebuffer_size_last_generation;
+    if (!resized && !context->swapchain_suboptimal) {
+        return;
+    }
+
+    f64 settled_ms = (f64)(now_ns - context->framebuffer_size_changed_ns) / 1000000.0;
+    if (resized && settled_ms < RESIZE_DEBOUNCE_MS) {
+        return;
+    }
+
+    if (requested_size_is_empty(context)) {
+        return;
+    }
+
+    recreate_swapchain(context);
+}
+
+static void recreate_swapchain(context *context) {
+    // NOTE: The generation is read first, a resize racing with this one starts another.
+    u64 generation = atomic_load(&context->framebuffer_size_generation);
+    u64 size = atomic_load(&context->requested_framebuffer_size);
+
+    render_graph_forget_views(context->render_graph, context);
+    swapchain_recreate(context, (u32)(size >> 32), (u32)size, &context->swapchain);
+
+    context->framebuffer_width = context->swapchain.extent.width;
+    context->framebuffer_height = context->swapchain.extent.height;
+    context->framebuffer_size_last_generation = generation;
+    context->swapchain_suboptimal = false;
+
+    if (context->frames_in_flight > context->swapchain.max_frames_in_flight) {
+        context->frames_in_flight = context->swapchain.max_frames_in_flight;
+    }
+}
+
+static b8 requested_size_is_empty(const context *context) {
+    u64 size = atomic_load(&context->requested_framebuffer_size);
+    return (u32)(size >> 32) == 0 || (u32)size == 0;
+}
+
+static VkResult acquire_image(context *context) {
+    return vkAcquireNextImageKHR(context->device.logical_device,
+                                 context->swapchain.handle,
+                                 UINT64_MAX,
+                                 context->image_available_semaphores[context->current_frame],
+                                 VK_NULL_HANDLE,
+                                 &context->image_index);
 }
 
 static VkResult create_debug_utils_messenger_ext(
@@ -402,11 +856,14 @@ static void populate_debug_messenger_create_info(VkDebugUtilsMessengerCreateInfo
 /**
  * @returns darray
  */
-static const char **get_required_extensions() {
+static const char **get_required_extensions(b8 headless) {
     uint32_t glfw_extension_count = 0;
-    const char **glfw_extensions;
+    const char **glfw_extensions = NULL;
 
-    glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+    // NOTE: GLFW is not initialized without a window, and nothing needs surface extensions.
+    if (!headless) {
+        glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+    }
 
     const char **required_extensions = darray_create(const char *);
     for (u32 i = 0; i < glfw_extension_count; ++i) {
@@ -436,23 +893,13 @@ static i32 find_memory_index(const context *context, u32 type_filter, u32 proper
     return -1;
 }
 
+/**
+ * The render pass pipelines are built against on devices without dynamic rendering. The render
+ * graph begins its own, which only differ in load and store operations and layouts and are
+ * therefore compatible with it.
+ */
 static void create_render_pass(context *context) {
-    VkSurfaceFormatKHR swapchain_image_format;
-    b8 found = false;
-
-    for (u32 i = 0; i < context->device.swapchain_support.format_count; i++) {
-        if (context->device.swapchain_support.formats[i].format == VK_FORMAT_B8G8R8A8_SRGB &&
-            context->device.swapchain_support.formats[i].colorSpace ==
-                VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
-            swapchain_image_format = context->device.swapchain_support.formats[i];
-            found = true;
-            break;
-        }
-    }
-
-    if (!found) {
-        swapchain_image_format = context->device.swapchain_support.formats[0];
-    }
+    VkSurfaceFormatKHR swapchain_image_format = swapchain_choose_format(context);
 
     VkAttachmentDescription color_attachment = {
         .format = swapchain_image_format.format,
@@ -461,8 +908,8 @@ static void create_render_pass(context *context) {
         .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
         .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        .initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
     };
 
     VkAttachmentReference color_attachment_reference = {
@@ -477,7 +924,7 @@ static void create_render_pass(context *context) {
         .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
         .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
         .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
     };
 
@@ -493,18 +940,6 @@ static void create_render_pass(context *context) {
         .pDepthStencilAttachment = &depth_attachment_reference,
     };
 
-    VkSubpassDependency dependency = {
-        .srcSubpass = VK_SUBPASS_EXTERNAL,
-        .dstSubpass = 0,
-        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-                        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-        .srcAccessMask = 0,
-        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-                        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-        .dstAccessMask =
-            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-    };
-
     VkAttachmentDescription attachments[] = {color_attachment, depth_attachment};
 
     VkRenderPassCreateInfo render_pass_info = {
@@ -513,8 +948,6 @@ static void create_render_pass(context *context) {
         .pAttachments = attachments,
         .subpassCount = 1,
         .pSubpasses = &subpass,
-        .dependencyCount = 1,
-        .pDependencies = &dependency,
     };
 
     VK_CHECK(vkCreateRenderPass(context->device.logical_device,
@@ -522,3 +955,124 @@ static void create_render_pass(context *context) {
                                 NULL,
                                 &context->render_pass));
 }
+
+/**
+ * Starts the frame's render graph with the acquired color image, a transient depth image and the
+ * main pass that clears and draws into them. The color image's contents do not survive from the
+ * frame before, it was presented or read back, so it is imported as UNDEFINED, waiting for the
+ * stages that last wrote it. Depth is cleared every frame and never stored, the graph places it
+ * in memory it keeps from frame to frame.
+ */
+static void declare_frame_targets(context *context) {
+    struct render_graph *graph = context->render_graph;
+    render_graph_begin(graph);
+
+    // NOTE: Offscreen images without readback are never looked at, they stay in the attachment
+    // layout.
+    render_graph_image_import color = {
+        .image = context->swapchain.images[context->image_index],
+        .view = context->swapchain.image_views[context->image_index],
+        .format = context->swapchain.image_format.format,
+        .extent = context->swapchain.extent,
+        .aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+        .initial_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .initial_stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        .initial_access = 0,
+        .final_layout = context->headless ? VK_IMAGE_LAYOUT_UNDEFINED
+                                          : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        .output = true,
+    };
+    context->frame_color_target = render_graph_import_image(graph, "frame color", &color);
+
+    b8 has_stencil = context->device.depth_format == VK_FORMAT_D32_SFLOAT_S8_UINT ||
+                     context->device.depth_format == VK_FORMAT_D24_UNORM_S8_UINT;
+    render_graph_image_desc depth = {
+        .format = context->device.depth_format,
+        .extent = context->swapchain.extent,
+        .aspect = VK_IMAGE_ASPECT_DEPTH_BIT | (has_stencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0),
+    };
+    context->frame_depth_target = render_graph_create_image(graph, "frame depth", &depth);
+
+    VkClearValue color_clear = {.color = {{0.2f, 0.2f, 0.2f, 1.0f}}};
+    VkClearValue depth_clear = {.depthStencil = {1.0f, 0}};
+
+    // NOTE: All drawing is recorded into secondary command buffers, see context_record.
+    context->main_pass = render_graph_add_pass(graph,
+                                               "main",
+                                               RENDER_GRAPH_PASS_GRAPHICS_SECONDARY,
+                                               record_main_pass,
+                                               context);
+    render_graph_color_attachment(graph,
+                                  context->main_pass,
+                                  context->frame_color_target,
+                                  &color_clear);
+    render_graph_depth_attachment(graph,
+                                  context->main_pass,
+                                  context->frame_depth_target,
+                                  &depth_clear);
+}
+
+static void record_main_pass(VkCommandBuffer command_buffer, void *user_data) {
+    PROFILE_FUNCTION();
+
+    context *context = user_data;
+
+    render_graph_inheritance inheritance;
+    render_graph_pass_inheritance(context->render_graph, &inheritance);
+
+    command_recorder_record(context->command_recorder,
+                            context,
+                            command_buffer,
+                            &inheritance.info,
+                            inheritance.extent,
+                            context->frame_recordings,
+                            darray_length(context->frame_recordings));
+}
+
+/**
+ * Copies the frame's color image, which the render graph has moved to TRANSFER_SRC_OPTIMAL, into
+ * its readback buffer and makes the copy visible to the host once the frame's timeline value is
+ * reached.
+ */
+static void record_readback(VkCommandBuffer command_buffer, void *user_data) {
+    context *context = user_data;
+
+    VkBufferImageCopy region = {
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource =
+            {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {context->framebuffer_width, context->framebuffer_height, 1},
+    };
+
+    vkCmdCopyImageToBuffer(command_buffer,
+                           context->swapchain.images[context->image_index],
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           context->swapchain.readback_buffers[context->image_index],
+                           1,
+                           &region);
+
+    VkMemoryBarrier host_barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+    };
+
+    vkCmdPipelineBarrier(command_buffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT,
+                         0,
+                         1,
+                         &host_barrier,
+                         0,
+                         NULL,
+                         0,
+                         NULL);
+}
@@ -1,29 +1,63 @@
 #ifndef CONTEXT_H
 #define CONTEXT_H
 
+#include "command_recorder.h"
+#include "frame_stats.h"
 #include "types.h"
 
-context context_new(GLFWwindow *window);
+context context_new(GLFWwindow *window, const presentation_settings *presentation);
+context context_new_headless(u32 width,
+                             u32 height,
+                             b8 readback,
+                             const presentation_settings *presentation);
 
 void context_on_resized(context *context, u32 width, u32 height);
 
 void context_begin_main_loop(context *context);
 VkCommandBuffer context_begin_frame(context *context);
+void context_record(context *context, const command_recording *recordings, u32 count);
 void context_end_frame(context *context);
+/**
+ * Calls latch on the thread ending each frame once its command buffer is recorded, immediately
+ * before it is submitted, for writing per-frame data that should be as fresh as possible into
+ * host coherent memory the frame reads. latch returns the timer_now_ns timestamp of the input the
+ * data was derived from, which context_frame_timing reports as the input latency. NULL removes it.
+ */
+void context_set_late_latch(context *context,
+                            u64 (*latch)(context *context, void *user_data),
+                            void *user_data);
 void context_end_main_loop(context *context);
 
+void context_frame_timing(const context *context, frame_timing *out_timing);
+
+b8 context_read_frame(context *context, void *pixels);
+
 void context_cleanup(context *context);
 
-void context_create_buffer(const context *context,
-                           VkDeviceSize size,
-                           VkBufferUsageFlags usage,
-                           VkMemoryPropertyFlags properties,
-                           VkBuffer *buffer,
-                           VkDeviceMemory *buffer_memory);
-
-void context_copy_buffer(const context *context,
-                         VkBuffer src_buffer,
-                         VkBuffer dst_buffer,
-                         VkDeviceSize size);
+VkDeviceSize context_create_buffer(const context *context,
+                                   VkDeviceSize size,
+                                   VkBufferUsageFlags usage,
+                                   VkMemoryPropertyFlags properties,
+                                   VkBuffer *buffer,
+                                   VkDeviceMemory *buffer_memory);
+
+/**
+ * Records and submits the copy without waiting for it, later submissions to the graphics queue see
+ * its result.
+ * @returns the graphics timeline value the copy signals, for releasing the source.
+ */
+u64 context_copy_buffer(const context *context,
+                        VkBuffer src_buffer,
+                        VkBuffer dst_buffer,
+                        VkDeviceSize size);
+void context_upload_barrier(VkCommandBuffer command_buffer);
+
+// NOTE: Destroys the buffer once the next frame submitted has finished.
+void context_destroy_buffer(const context *context, VkBuffer buffer, VkDeviceMemory buffer_memory);
+// NOTE: Destroys the buffer once the graphics timeline reaches value.
+void context_destroy_buffer_after(const context *context,
+                                  u64 value,
+                                  VkBuffer buffer,
+                                  VkDeviceMemory buffer_memory);
 
 #endif // CONTEXT_H
@@ -0,0 +1,165 @@
+#include "deletion_queue.h"
+
+#include "darray.h"
+
+#include <string.h>
+
+typedef struct {
+    timeline_deferred_fn fn;
+    u8 data[TIMELINE_DEFERRED_DATA_SIZE];
+} deletion_fn;
+
+struct deletion_queue {
+    struct timeline *timeline;
+
+    // NOTE: Pushed since the last frame was submitted, waiting for the value it signals.
+    deletion *pending;        // darray
+    deletion_fn *pending_fns; // darray
+};
+
+static void destroy_object(VkDevice device, const deletion *object);
+static void destroy_one(context *context, void *object);
+static void destroy_batch(context *context, void *batch);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+struct deletion_queue *deletion_queue_create(struct timeline *timeline) {
+    struct deletion_queue *queue = calloc(1, sizeof(struct deletion_queue));
+    queue->timeline = timeline;
+    queue->pending = darray_create(deletion);
+    queue->pending_fns = darray_create(deletion_fn);
+
+    return queue;
+}
+
+void deletion_queue_destroy(struct deletion_queue *queue) {
+    u64 left = darray_length(queue->pending) + darray_length(queue->pending_fns);
+    if (left > 0) {
+        fprintf(stderr,
+                "Destroying a deletion queue with %llu objects left, flush it first.\n",
+                left);
+    }
+    darray_destroy(queue->pending);
+    darray_destroy(queue->pending_fns);
+
+    free(queue);
+}
+
+void deletion_queue_push(struct deletion_queue *queue, deletion object) {
+    darray_push(queue->pending, object);
+}
+
+void deletion_queue_push_fn(struct deletion_queue *queue,
+                            timeline_deferred_fn fn,
+                            const void *data,
+                            u64 size) {
+    if (size > TIMELINE_DEFERRED_DATA_SIZE) {
+        fprintf(stderr, "Deletion data of %llu bytes does not fit!\n", size);
+        exit(EXIT_FAILURE);
+    }
+
+    deletion_fn entry = {.fn = fn};
+    memcpy(entry.data, data, size);
+
+    darray_push(queue->pending_fns, entry);
+}
+
+void deletion_queue_push_after(struct deletion_queue *queue,
+                               timeline_queue timeline_queue,
+                               u64 value,
+                               deletion object) {
+    timeline_defer(queue->timeline, timeline_queue, value, destroy_one, &object, sizeof(object));
+}
+
+void deletion_queue_submit(struct deletion_queue *queue, u64 value) {
+    for (u64 i = 0; i < darray_length(queue->pending_fns); i++) {
+        timeline_defer(queue->timeline,
+                       TIMELINE_QUEUE_GRAPHICS,
+                       value,
+                       queue->pending_fns[i].fn,
+                       queue->pending_fns[i].data,
+                       TIMELINE_DEFERRED_DATA_SIZE);
+    }
+    darray_clear(queue->pending_fns);
+
+    if (darray_length(queue->pending) == 0) {
+        return;
+    }
+
+    // NOTE: The whole frame's objects become one deferred action, which owns the array.
+    deletion *batch = queue->pending;
+    queue->pending = darray_create(deletion);
+
+    timeline_defer(queue->timeline,
+                   TIMELINE_QUEUE_GRAPHICS,
+                   value,
+                   destroy_batch,
+                   &batch,
+                   sizeof(batch));
+}
+
+void deletion_queue_flush(struct deletion_queue *queue, context *context) {
+    // NOTE: Functions may push more objects, so they run first and each is copied out before it
+    // runs.
+    while (darray_length(queue->pending_fns) > 0) {
+        deletion_fn entry;
+        darray_pop_front(queue->pending_fns, &entry);
+        entry.fn(context, entry.data);
+    }
+
+    for (u64 i = 0; i < darray_length(queue->pending); i++) {
+        destroy_object(context->device.logical_device, &queue->pending[i]);
+    }
+    darray_clear(queue->pending);
+}
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+static void destroy_object(VkDevice device, const deletion *object) {
+    switch (object->type) {
+    case DELETION_BUFFER:
+        vkDestroyBuffer(device, object->buffer, NULL);
+        break;
+    case DELETION_DEVICE_MEMORY:
+        vkFreeMemory(device, object->memory, NULL);
+        break;
+    case DELETION_IMAGE:
+        vkDestroyImage(device, object->image, NULL);
+        break;
+    case DELETION_IMAGE_VIEW:
+        vkDestroyImageView(device, object->image_view, NULL);
+        break;
+    case DELETION_SAMPLER:
+        vkDestroySampler(device, object->sampler, NULL);
+        break;
+    case DELETION_FRAMEBUFFER:
+        vkDestroyFramebuffer(device, object->framebuffer, NULL);
+        break;
+    case DELETION_PIPELINE:
+        vkDestroyPipeline(device, object->pipeline, NULL);
+        break;
+    case DELETION_PIPELINE_LAYOUT:
+        vkDestroyPipelineLayout(device, object->pipeline_layout, NULL);
+        break;
+    case DELETION_DESCRIPTOR_POOL:
+        vkDestroyDescriptorPool(device, object->descriptor_pool, NULL);
+        break;
+    }
+}
+
+static void destroy_one(context *context, void *object) {
+    destroy_object(context->device.logical_device, object);
+}
+
+static void destroy_batch(context *context, void *batch) {
+    deletion *objects = *(deletion **)batch;
+
+    for (u64 i = 0; i < darray_length(objects); i++) {
+        destroy_object(context->device.logical_device, &objects[i]);
+    }
+    darray_destroy(objects);
+}
@@ -0,0 +1,65 @@
+#ifndef DELETION_QUEUE_H
+#define DELETION_QUEUE_H
+
+#include "timeline.h"
+#include "types.h"
+
+typedef enum {
+    DELETION_BUFFER,
+    DELETION_DEVICE_MEMORY,
+    DELETION_IMAGE,
+    DELETION_IMAGE_VIEW,
+    DELETION_SAMPLER,
+    DELETION_FRAMEBUFFER,
+    DELETION_PIPELINE,
+    DELETION_PIPELINE_LAYOUT,
+    DELETION_DESCRIPTOR_POOL,
+} deletion_type;
+
+typedef struct {
+    deletion_type type;
+    union {
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+        VkImage image;
+        VkImageView image_view;
+        VkSampler sampler;
+        VkFramebuffer framebuffer;
+        VkPipeline pipeline;
+        VkPipelineLayout pipeline_layout;
+        VkDescriptorPool descriptor_pool;
+    };
+} deletion;
+
+/**
+ * Destroys Vulkan objects once the GPU has finished with them, so destroying never waits. An
+ * object pushed without a value is destroyed once the next frame submitted has finished, which
+ * covers every use recorded or submitted before the push. Belongs to the thread making the
+ * context's Vulkan calls.
+ */
+struct deletion_queue *deletion_queue_create(struct timeline *timeline);
+void deletion_queue_destroy(struct deletion_queue *queue);
+
+void deletion_queue_push(struct deletion_queue *queue, deletion object);
+// NOTE: For objects that take more than a vkDestroy call, fn runs once the next frame has finished.
+void deletion_queue_push_fn(struct deletion_queue *queue,
+                            timeline_deferred_fn fn,
+                            const void *data,
+                            u64 size);
+
+// NOTE: For objects whose last use is a known submission, such as an upload's staging buffer.
+void deletion_queue_push_after(struct deletion_queue *queue,
+                               timeline_queue timeline_queue,
+                               u64 value,
+                               deletion object);
+
+/**
+ * Hands everything pushed since the previous frame to the timeline, to be destroyed once the
+ * graphics queue reaches value. Called by context_end_frame after submitting.
+ */
+void deletion_queue_submit(struct deletion_queue *queue, u64 value);
+
+// NOTE: Destroys everything still waiting for a frame. For shutdown, once the device is idle.
+void deletion_queue_flush(struct deletion_queue *queue, context *context);
+
+#endif // DELETION_QUEUE_H
@@ -25,6 +25,8 @@ typedef struct {
     b8 transfer;
     const char **device_extension_names; // darray
     b8 sampler_anisotropy;
+    b8 descriptor_indexing;
+    b8 timeline_semaphore;
     b8 discrete_gpu;
 } physical_device_requirements;
 
@@ -40,9 +42,11 @@ static b8 physical_device_meets_requirements(VkPhysicalDevice device,
                                              VkSurfaceKHR surface,
                                              const VkPhysicalDeviceProperties *properties,
                                              const VkPhysicalDeviceFeatures *features,
+                                             const VkPhysicalDeviceVulkan12Features *features_12,
                                              const physical_device_requirements *requirements,
                                              queue_family_info *queue_family_info,
                                              swapchain_support_info *swapchain_support);
+static b8 physical_device_supports_extension(VkPhysicalDevice device, const char *extension_name);
 
 void device_new(context *context) {
     if (!pick_physical_device(context)) {
@@ -57,7 +61,8 @@ void device_new(context *context) {
         context->device.graphics_queue_index == context->device.present_queue_index;
     b8 transfer_shares_graphics_queue =
         context->device.graphics_queue_index == context->device.transfer_queue_index;
-    b8 present_must_share_graphics = false;
+    // NOTE: Headless devices never present, so the present queue is just the graphics queue.
+    b8 present_must_share_graphics = context->headless;
     u32 index_count = 1;
     if (!present_shares_graphics_queue) {
         index_count++;
@@ -92,7 +97,8 @@ void device_new(context *context) {
         queue_create_infos[i].queueFamilyIndex = indices[i];
         queue_create_infos[i].queueCount = 1;
 
-        if (present_shares_graphics_queue && indices[i] == context->device.present_queue_index) {
+        if (present_shares_graphics_queue && !context->headless &&
+            indices[i] == context->device.present_queue_index) {
             if (properties[context->device.present_queue_index].queueCount > 1) {
                 queue_create_infos[i].queueCount = 2;
             } else {
@@ -105,16 +111,80 @@ void device_new(context *context) {
         queue_create_infos[i].pQueuePriorities = queue_priorities;
     }
 
-    const char *extension_names[] = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-    };
-#define extension_name_count sizeof(extension_names) / sizeof(const char *)
+    const char *extension_names[8];
+    u32 extension_name_count = 0;
+
+    if (!context->headless) {
+        extension_names[extension_name_count++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+    }
+    if (context->device.supports_graphics_pipeline_library) {
+        extension_names[extension_name_count++] = VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME;
+        extension_names[extension_name_count++] = VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME;
+    }
+    if (context->device.supports_dynamic_blend_enable) {
+        extension_names[extension_name_count++] = VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME;
+    }
 
     VkPhysicalDeviceFeatures device_features = {
         .samplerAnisotropy = context->device.features.samplerAnisotropy,
         .fillModeNonSolid = context->device.features.fillModeNonSolid,
+        .multiDrawIndirect = context->device.features.multiDrawIndirect,
+        .drawIndirectFirstInstance = context->device.features.drawIndirectFirstInstance,
+        .shaderSampledImageArrayDynamicIndexing = VK_TRUE,
+        .shaderStorageBufferArrayDynamicIndexing = VK_TRUE,
+    };
+
+    VkPhysicalDeviceVulkan12Features device_features_12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .drawIndirectCount = context->device.features_12.drawIndirectCount,
+        .descriptorIndexing = VK_TRUE,
+        .timelineSemaphore = VK_TRUE,
+        .runtimeDescriptorArray = VK_TRUE,
+        .descriptorBindingPartiallyBound = VK_TRUE,
+        .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+        .descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE,
+        .descriptorBindingUpdateUnusedWhilePending =
+            context->device.features_12.descriptorBindingUpdateUnusedWhilePending,
+        .shaderSampledImageArrayNonUniformIndexing =
+            context->device.features_12.shaderSampledImageArrayNonUniformIndexing,
+        .shaderStorageBufferArrayNonUniformIndexing =
+            context->device.features_12.shaderStorageBufferArrayNonUniformIndexing,
+    };
+
+    VkPhysicalDeviceVulkan13Features device_features_13 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+        .dynamicRendering = VK_TRUE,
+    };
+
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphics_pipeline_library_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+        .graphicsPipelineLibrary = VK_TRUE,
+    };
+
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extended_dynamic_state_3_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+        .extendedDynamicState3ColorBlendEnable = VK_TRUE,
     };
 
+    // NOTE: Optional feature structs are prepended to the chain as they become enabled.
+    void *features_chain = NULL;
+    if (context->device.supports_graphics_pipeline_library) {
+        graphics_pipeline_library_features.pNext = features_chain;
+        features_chain = &graphics_pipeline_library_features;
+    }
+    if (context->device.supports_dynamic_blend_enable) {
+        extended_dynamic_state_3_features.pNext = features_chain;
+        features_chain = &extended_dynamic_state_3_features;
+    }
+    if (context->device.supports_dynamic_rendering) {
+        device_features_13.pNext = features_chain;
+        features_chain = &device_features_13;
+    }
+    if (context->device.properties.apiVersion >= VK_API_VERSION_1_2) {
+        device_features_12.pNext = features_chain;
+        features_chain = &device_features_12;
+    }
+
     VkDeviceCreateInfo device_create_info = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
         .queueCreateInfoCount = index_count,
@@ -124,9 +194,8 @@ void device_new(context *context) {
         .ppEnabledExtensionNames = extension_names,
         .enabledLayerCount = 0,      // deprecated & ignored
         .ppEnabledLayerNames = NULL, // deprecated & ignored
-        .pNext = NULL,
+        .pNext = features_chain,
     };
-#undef extension_name_count
 
     VK_CHECK(vkCreateDevice(context->device.physical_device,
                             &device_create_info,
@@ -135,6 +204,15 @@ void device_new(context *context) {
 
     printf("Logical device created.\n");
 
+    if (context->device.supports_dynamic_blend_enable) {
+        context->device.cmd_set_color_blend_enable =
+            (PFN_vkCmdSetColorBlendEnableEXT)vkGetDeviceProcAddr(context->device.logical_device,
+                                                                 "vkCmdSetColorBlendEnableEXT");
+        if (context->device.cmd_set_color_blend_enable == NULL) {
+            context->device.supports_dynamic_blend_enable = false;
+        }
+    }
+
     vkGetDeviceQueue(context->device.logical_device,
                      context->device.graphics_queue_index,
                      0,
@@ -248,16 +326,21 @@ static b8 pick_physical_device(context *context) {
 
     physical_device_requirements requirements = {
         .graphics = true,
-        .present = true,
+        .present = !context->headless,
         .transfer = true,
         .compute = true,
         .sampler_anisotropy = true,
+        .descriptor_indexing = true,
+        .timeline_semaphore = true,
         .discrete_gpu = false,
         .device_extension_names = darray_create(const char *),
     };
 
-    for (u32 i = 0; i < device_extenstion_count; i++) {
-        darray_push(requirements.device_extension_names, device_extenstions[i]);
+    // NOTE: Headless contexts never create a swapchain, so they need no present support either.
+    if (!context->headless) {
+        for (u32 i = 0; i < device_extenstion_count; i++) {
+            darray_push(requirements.device_extension_names, device_extenstions[i]);
+        }
     }
 
     VkPhysicalDevice physical_devices[physical_device_count];
@@ -272,6 +355,62 @@ static b8 pick_physical_device(context *context) {
         VkPhysicalDeviceFeatures features;
         vkGetPhysicalDeviceFeatures(physical_devices[i], &features);
 
+        // NOTE: Vulkan 1.2 features can only be queried on devices that report 1.2 or newer.
+        VkPhysicalDeviceVulkan12Features features_12 = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        };
+        VkPhysicalDeviceVulkan13Features features_13 = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+        };
+        VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphics_pipeline_library_features = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+        };
+        VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extended_dynamic_state_3_features = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+        };
+        VkPhysicalDeviceExtendedDynamicState3PropertiesEXT extended_dynamic_state_3_properties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_PROPERTIES_EXT,
+        };
+        b8 has_graphics_pipeline_library_extensions =
+            physical_device_supports_extension(physical_devices[i],
+                                               VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+            physical_device_supports_extension(physical_devices[i],
+                                               VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+        b8 has_extended_dynamic_state_3_extension =
+            physical_device_supports_extension(physical_devices[i],
+                                               VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+        if (properties.apiVersion >= VK_API_VERSION_1_2) {
+            void *features_chain = NULL;
+            if (has_graphics_pipeline_library_extensions) {
+                graphics_pipeline_library_features.pNext = features_chain;
+                features_chain = &graphics_pipeline_library_features;
+            }
+            if (has_extended_dynamic_state_3_extension) {
+                extended_dynamic_state_3_features.pNext = features_chain;
+                features_chain = &extended_dynamic_state_3_features;
+            }
+            if (properties.apiVersion >= VK_API_VERSION_1_3) {
+                features_13.pNext = features_chain;
+                features_chain = &features_13;
+            }
+            features_12.pNext = features_chain;
+
+            VkPhysicalDeviceFeatures2 features_2 = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                .pNext = &features_12,
+            };
+            vkGetPhysicalDeviceFeatures2(physical_devices[i], &features_2);
+            features_12.pNext = NULL;
+
+            if (has_extended_dynamic_state_3_extension) {
+                VkPhysicalDeviceProperties2 properties_2 = {
+                    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+                    .pNext = &extended_dynamic_state_3_properties,
+                };
+                vkGetPhysicalDeviceProperties2(physical_devices[i], &properties_2);
+            }
+        }
+
         VkPhysicalDeviceMemoryProperties memory;
         vkGetPhysicalDeviceMemoryProperties(physical_devices[i], &memory);
 
@@ -283,6 +422,7 @@ static b8 pick_physical_device(context *context) {
                                                        context->surface,
                                                        &properties,
                                                        &features,
+                                                       &features_12,
                                                        &requirements,
                                                        &queue_info,
                                                        &context->device.swapchain_support);
@@ -328,8 +468,40 @@ static b8 pick_physical_device(context *context) {
 
             context->device.properties = properties;
             context->device.features = features;
+            context->device.features_12 = features_12;
             context->device.memory = memory;
 
+            context->device.supports_graphics_pipeline_library =
+                has_graphics_pipeline_library_extensions &&
+                graphics_pipeline_library_features.graphicsPipelineLibrary;
+            printf("Graphics pipeline library %s.\n",
+                   context->device.supports_graphics_pipeline_library ? "supported"
+                                                                       : "not supported");
+
+            // NOTE: Extended dynamic state 1 and 2 are core in Vulkan 1.3 and need no feature.
+            context->device.supports_extended_dynamic_state =
+                properties.apiVersion >= VK_API_VERSION_1_3;
+            context->device.supports_dynamic_blend_enable =
+                context->device.supports_extended_dynamic_state &&
+                has_extended_dynamic_state_3_extension &&
+                extended_dynamic_state_3_features.extendedDynamicState3ColorBlendEnable;
+            // NOTE: The property only applies with the extension enabled, which it is along with
+            // dynamic blend enable.
+            context->device.supports_unrestricted_topology =
+                context->device.supports_dynamic_blend_enable &&
+                extended_dynamic_state_3_properties.dynamicPrimitiveTopologyUnrestricted;
+            printf("Extended dynamic state %s, dynamic blend enable %s.\n",
+                   context->device.supports_extended_dynamic_state ? "supported"
+                                                                   : "not supported",
+                   context->device.supports_dynamic_blend_enable ? "supported" : "not supported");
+            printf("Unrestricted dynamic topology %s.\n",
+                   context->device.supports_unrestricted_topology ? "supported" : "not supported");
+
+            context->device.supports_dynamic_rendering =
+                properties.apiVersion >= VK_API_VERSION_1_3 && features_13.dynamicRendering;
+            printf("Dynamic rendering %s.\n",
+                   context->device.supports_dynamic_rendering ? "supported" : "not supported");
+
             break;
         }
     }
@@ -349,6 +521,7 @@ static b8 physical_device_meets_requirements(VkPhysicalDevice device,
                                              VkSurfaceKHR surface,
                                              const VkPhysicalDeviceProperties *properties,
                                              const VkPhysicalDeviceFeatures *features,
+                                             const VkPhysicalDeviceVulkan12Features *features_12,
                                              const physical_device_requirements *requirements,
                                              queue_family_info *queue_family_info,
                                              swapchain_support_info *swapchain_support) {
@@ -379,8 +552,11 @@ static b8 physical_device_meets_requirements(VkPhysicalDevice device,
             queue_family_info->graphics_family_index = i;
             current_transfer_score++;
 
-            VkBool32 supports_present = VK_FALSE;
-            VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &supports_present));
+            VkBool32 supports_present = surface == VK_NULL_HANDLE;
+            if (surface != VK_NULL_HANDLE) {
+                VK_CHECK(
+                    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &supports_present));
+            }
             if (supports_present) {
                 queue_family_info->present_family_index = i;
                 current_transfer_score++;
@@ -400,7 +576,7 @@ static b8 physical_device_meets_requirements(VkPhysicalDevice device,
         }
     }
 
-    if (queue_family_info->present_family_index == -1) {
+    if (queue_family_info->present_family_index == -1 && surface != VK_NULL_HANDLE) {
         for (u32 i = 0; i < queue_family_count; i++) {
             VkBool32 supports_present = VK_FALSE;
             VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &supports_present));
@@ -435,9 +611,12 @@ static b8 physical_device_meets_requirements(VkPhysicalDevice device,
          (requirements->transfer && queue_family_info->transfer_family_index != -1))) {
         printf("Device meets queue requirements.\n");
 
-        device_query_swapchain_support(device, surface, swapchain_support);
+        if (surface != VK_NULL_HANDLE) {
+            device_query_swapchain_support(device, surface, swapchain_support);
+        }
 
-        if (swapchain_support->format_count < 1 || swapchain_support->present_mode_count < 1) {
+        if (surface != VK_NULL_HANDLE &&
+            (swapchain_support->format_count < 1 || swapchain_support->present_mode_count < 1)) {
             if (swapchain_support->formats) {
                 free(swapchain_support->formats);
             }
@@ -484,8 +663,48 @@ static b8 physical_device_meets_requirements(VkPhysicalDevice device,
             return false;
         }
 
+        // NOTE: Shaders index the bindless arrays with indices from push constants, which
+        // counts as dynamic indexing.
+        if (requirements->descriptor_indexing &&
+            (!features->shaderSampledImageArrayDynamicIndexing ||
+             !features->shaderStorageBufferArrayDynamicIndexing ||
+             !features_12->descriptorIndexing || !features_12->runtimeDescriptorArray ||
+             !features_12->descriptorBindingPartiallyBound ||
+             !features_12->descriptorBindingSampledImageUpdateAfterBind ||
+             !features_12->descriptorBindingStorageBufferUpdateAfterBind)) {
+            printf("Device does not support descriptor indexing, skipping.\n");
+            return false;
+        }
+
+        if (requirements->timeline_semaphore && !features_12->timelineSemaphore) {
+            printf("Device does not support timeline semaphores, skipping.\n");
+            return false;
+        }
+
         return true;
     }
 
     return false;
 }
+
+static b8 physical_device_supports_extension(VkPhysicalDevice device, const char *extension_name) {
+    u32 available_extension_count = 0;
+    VK_CHECK(vkEnumerateDeviceExtensionProperties(device, 0, &available_extension_count, NULL));
+    if (available_extension_count == 0) {
+        return false;
+    }
+
+    VkExtensionProperties available_extensions[available_extension_count];
+    VK_CHECK(vkEnumerateDeviceExtensionProperties(device,
+                                                  0,
+                                                  &available_extension_count,
+                                                  available_extensions));
+
+    for (u32 i = 0; i < available_extension_count; i++) {
+        if (strcmp(extension_name, available_extensions[i].extensionName) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
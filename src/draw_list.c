@@ -0,0 +1,181 @@
+#include "draw_list.h"
+
+#include "context.h"
+#include "types.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static void create_mapped_buffer(const context *context,
+                                 VkDeviceSize size,
+                                 VkBufferUsageFlags usage,
+                                 VkBuffer *buffer,
+                                 VkDeviceMemory *buffer_memory,
+                                 void **mapped);
+
+draw_list draw_list_create(const context *context, u32 capacity, u64 draw_data_stride) {
+    draw_list list = {
+        .capacity = capacity,
+        .draw_data_stride = draw_data_stride,
+        .frame_count = context->max_frames_in_flight,
+    };
+
+    for (u32 i = 0; i < list.frame_count; i++) {
+        create_mapped_buffer(context,
+                             sizeof(VkDrawIndexedIndirectCommand) * capacity,
+                             VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                             &list.commands[i],
+                             &list.commands_memory[i],
+                             (void **)&list.commands_mapped[i]);
+
+        create_mapped_buffer(context,
+                             sizeof(u32),
+                             VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                             &list.count[i],
+                             &list.count_memory[i],
+                             (void **)&list.count_mapped[i]);
+        *list.count_mapped[i] = 0;
+
+        if (draw_data_stride != 0) {
+            create_mapped_buffer(context,
+                                 draw_data_stride * capacity,
+                                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                 &list.draw_data[i],
+                                 &list.draw_data_memory[i],
+                                 &list.draw_data_mapped[i]);
+        }
+    }
+
+    return list;
+}
+
+void draw_list_begin(draw_list *list, u32 frame_index) {
+    list->frame_index = frame_index;
+    list->draw_count = 0;
+    *list->count_mapped[frame_index] = 0;
+}
+
+u32 draw_list_push(draw_list *list, const geometry_range *range, const void *draw_data) {
+    if (list->draw_count >= list->capacity) {
+        fprintf(stderr, "Draw list is full (%u draws)\n", list->capacity);
+        return UINT32_MAX;
+    }
+
+    u32 draw_index = list->draw_count++;
+
+    list->commands_mapped[list->frame_index][draw_index] = (VkDrawIndexedIndirectCommand){
+        .indexCount = range->index_count,
+        .instanceCount = 1,
+        .firstIndex = range->first_index,
+        .vertexOffset = range->vertex_offset,
+        .firstInstance = draw_index,
+    };
+
+    if (list->draw_data_stride != 0 && draw_data != NULL) {
+        memcpy((void *)((u64)list->draw_data_mapped[list->frame_index] +
+                        list->draw_data_stride * draw_index),
+               draw_data,
+               list->draw_data_stride);
+    }
+
+    *list->count_mapped[list->frame_index] = list->draw_count;
+
+    return draw_index;
+}
+
+void draw_list_submit(const draw_list *list,
+                      const context *context,
+                      VkCommandBuffer command_buffer,
+                      u32 draw_data_binding) {
+    if (list->draw_count == 0) {
+        return;
+    }
+
+    u32 frame = list->frame_index;
+
+    if (list->draw_data_stride != 0 && draw_data_binding != DRAW_LIST_UNBOUND) {
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(command_buffer,
+                               draw_data_binding,
+                               1,
+                               &list->draw_data[frame],
+                               offsets);
+    }
+
+    const device *device = &context->device;
+
+    // NOTE: firstInstance carries the draw index, so without these features the commands are
+    // replayed from the mapped copy instead.
+    if (!device->features.multiDrawIndirect || !device->features.drawIndirectFirstInstance) {
+        for (u32 i = 0; i < list->draw_count; i++) {
+            const VkDrawIndexedIndirectCommand *command = &list->commands_mapped[frame][i];
+            vkCmdDrawIndexed(command_buffer,
+                             command->indexCount,
+                             command->instanceCount,
+                             command->firstIndex,
+                             command->vertexOffset,
+                             command->firstInstance);
+        }
+        return;
+    }
+
+    u32 max_draw_count = list->capacity;
+    if (max_draw_count > device->properties.limits.maxDrawIndirectCount) {
+        max_draw_count = device->properties.limits.maxDrawIndirectCount;
+    }
+
+    if (device->features_12.drawIndirectCount) {
+        vkCmdDrawIndexedIndirectCount(command_buffer,
+                                      list->commands[frame],
+                                      0,
+                                      list->count[frame],
+                                      0,
+                                      max_draw_count,
+                                      sizeof(VkDrawIndexedIndirectCommand));
+    } else {
+        vkCmdDrawIndexedIndirect(command_buffer,
+                                 list->commands[frame],
+                                 0,
+                                 list->draw_count < max_draw_count ? list->draw_count
+                                                                   : max_draw_count,
+                                 sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+void draw_list_destroy(draw_list *list, device *device) {
+    for (u32 i = 0; i < list->frame_count; i++) {
+        vkDestroyBuffer(device->logical_device, list->commands[i], NULL);
+        vkFreeMemory(device->logical_device, list->commands_memory[i], NULL);
+
+        vkDestroyBuffer(device->logical_device, list->count[i], NULL);
+        vkFreeMemory(device->logical_device, list->count_memory[i], NULL);
+
+        if (list->draw_data_stride != 0) {
+            vkDestroyBuffer(device->logical_device, list->draw_data[i], NULL);
+            vkFreeMemory(device->logical_device, list->draw_data_memory[i], NULL);
+        }
+    }
+
+    *list = (draw_list){0};
+}
+
+static void create_mapped_buffer(const context *context,
+                                 VkDeviceSize size,
+                                 VkBufferUsageFlags usage,
+                                 VkBuffer *buffer,
+                                 VkDeviceMemory *buffer_memory,
+                                 void **mapped) {
+    context_create_buffer(context,
+                          size,
+                          usage,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                          buffer,
+                          buffer_memory);
+
+    vkMapMemory(context->device.logical_device, *buffer_memory, 0, size, 0, mapped);
+}
@@ -0,0 +1,51 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include "geometry_arena.h"
+#include "types.h"
+
+#include <stdint.h>
+
+// NOTE: Pass as draw_data_binding when shaders read the draw data through the bindless set.
+#define DRAW_LIST_UNBOUND UINT32_MAX
+
+/**
+ * Per-frame buffer of VkDrawIndexedIndirectCommand plus a parallel array of per-draw data. Each
+ * command's firstInstance is its draw index, so the per-draw data is indexed through
+ * gl_InstanceIndex, either from an instance-rate vertex buffer or from a bindless storage buffer.
+ * The CPU fills it today; the buffers are storage-buffer capable so a compute pass can write them
+ * instead.
+ */
+typedef struct {
+    VkBuffer commands[MAX_FRAMES_IN_FLIGHT];
+    VkDeviceMemory commands_memory[MAX_FRAMES_IN_FLIGHT];
+    VkDrawIndexedIndirectCommand *commands_mapped[MAX_FRAMES_IN_FLIGHT];
+
+    VkBuffer count[MAX_FRAMES_IN_FLIGHT];
+    VkDeviceMemory count_memory[MAX_FRAMES_IN_FLIGHT];
+    u32 *count_mapped[MAX_FRAMES_IN_FLIGHT];
+
+    VkBuffer draw_data[MAX_FRAMES_IN_FLIGHT];
+    VkDeviceMemory draw_data_memory[MAX_FRAMES_IN_FLIGHT];
+    void *draw_data_mapped[MAX_FRAMES_IN_FLIGHT];
+
+    u64 draw_data_stride;
+    u32 capacity;
+    u32 frame_count;
+
+    u32 frame_index;
+    u32 draw_count;
+} draw_list;
+
+draw_list draw_list_create(const context *context, u32 capacity, u64 draw_data_stride);
+
+void draw_list_begin(draw_list *list, u32 frame_index);
+u32 draw_list_push(draw_list *list, const geometry_range *range, const void *draw_data);
+void draw_list_submit(const draw_list *list,
+                      const context *context,
+                      VkCommandBuffer command_buffer,
+                      u32 draw_data_binding);
+
+void draw_list_destroy(draw_list *list, device *device);
+
+#endif // DRAW_LIST_H
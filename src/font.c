@@ -1,5 +1,6 @@
 #include "font.h"
 #include "defines.h"
+#include "profiler.h"
 
 #include <endian.h>
 #include <stddef.h>
@@ -555,6 +556,8 @@ static struct glyph_point_iterator otf_reader_read_glyf(struct otf_reader *r,
 }
 
 void load_font(const char *file_name, struct font *font) {
+    PROFILE_FUNCTION();
+
     (void)font;
 
     FILE *fp = fopen(file_name, "rb");
@@ -0,0 +1,118 @@
+#include "frame_packet.h"
+
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define FRAME_PACKET_SLOT_COUNT 3
+#define FRAME_PACKET_INDEX_MASK 0x3u
+#define FRAME_PACKET_FRESH_BIT 0x4u
+
+struct frame_packet_mailbox {
+    u8 *packets;
+    u64 packet_size;
+
+    // NOTE: Each side owns one slot, the third is shared and carries FRAME_PACKET_FRESH_BIT
+    // while it holds a packet the consumer has not taken yet.
+    u32 write_index;
+    u32 read_index;
+    atomic_uint shared;
+
+    atomic_bool closed;
+    sem_t published;
+    sem_t consumed;
+};
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+struct frame_packet_mailbox *frame_packet_mailbox_create(u64 packet_size) {
+    struct frame_packet_mailbox *mailbox = calloc(1, sizeof(struct frame_packet_mailbox));
+
+    mailbox->packets = calloc(FRAME_PACKET_SLOT_COUNT, packet_size);
+    mailbox->packet_size = packet_size;
+
+    mailbox->write_index = 0;
+    mailbox->read_index = 1;
+    atomic_init(&mailbox->shared, 2);
+
+    atomic_init(&mailbox->closed, false);
+    sem_init(&mailbox->published, 0, 0);
+    sem_init(&mailbox->consumed, 0, 0);
+
+    return mailbox;
+}
+
+void frame_packet_mailbox_destroy(struct frame_packet_mailbox *mailbox) {
+    sem_destroy(&mailbox->consumed);
+    sem_destroy(&mailbox->published);
+
+    free(mailbox->packets);
+    free(mailbox);
+}
+
+void *frame_packet_mailbox_begin_write(struct frame_packet_mailbox *mailbox) {
+    return mailbox->packets + mailbox->write_index * mailbox->packet_size;
+}
+
+void frame_packet_mailbox_publish(struct frame_packet_mailbox *mailbox) {
+    u32 previous = atomic_exchange_explicit(&mailbox->shared,
+                                            mailbox->write_index | FRAME_PACKET_FRESH_BIT,
+                                            memory_order_acq_rel);
+    mailbox->write_index = previous & FRAME_PACKET_INDEX_MASK;
+
+    sem_post(&mailbox->published);
+}
+
+/**
+ * Blocks until the consumer has taken the last published packet, which keeps the producer at most
+ * one packet ahead instead of producing packets that are never consumed.
+ */
+void frame_packet_mailbox_wait_consumed(struct frame_packet_mailbox *mailbox) {
+    if (atomic_load(&mailbox->closed)) {
+        return;
+    }
+
+    sem_wait(&mailbox->consumed);
+}
+
+/**
+ * Returns the newest published packet, blocking until one is available.
+ * @returns NULL once the mailbox is closed and its last packet was taken.
+ */
+const void *frame_packet_mailbox_acquire(struct frame_packet_mailbox *mailbox) {
+    for (;;) {
+        if (atomic_load_explicit(&mailbox->shared, memory_order_relaxed) & FRAME_PACKET_FRESH_BIT) {
+            // NOTE: Only the producer changes the shared slot in between, and it only ever sets
+            // it fresh, so the exchange always takes a fresh packet.
+            u32 previous = atomic_exchange_explicit(&mailbox->shared,
+                                                    mailbox->read_index,
+                                                    memory_order_acq_rel);
+            mailbox->read_index = previous & FRAME_PACKET_INDEX_MASK;
+
+            // NOTE: Drops wakeups for packets that were overwritten before being read.
+            while (sem_trywait(&mailbox->published) == 0) {
+            }
+            sem_post(&mailbox->consumed);
+
+            return mailbox->packets + mailbox->read_index * mailbox->packet_size;
+        }
+
+        if (atomic_load(&mailbox->closed)) {
+            return NULL;
+        }
+
+        sem_wait(&mailbox->published);
+    }
+}
+
+/**
+ * Wakes both sides; from then on wait_consumed returns immediately and acquire stops blocking.
+ */
+void frame_packet_mailbox_close(struct frame_packet_mailbox *mailbox) {
+    atomic_store(&mailbox->closed, true);
+
+    sem_post(&mailbox->published);
+    sem_post(&mailbox->consumed);
+}
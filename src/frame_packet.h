@@ -0,0 +1,26 @@
+#ifndef FRAME_PACKET_H
+#define FRAME_PACKET_H
+
+#include "defines.h"
+
+/**
+ * Hands fixed-size frame packets from one producer thread to one consumer thread through three
+ * slots. Publishing and acquiring swap a slot with a single atomic exchange, so neither side ever
+ * waits on the other to read or write a packet; the consumer always gets the newest packet and
+ * older unread ones are overwritten. The semaphores are only used to sleep when there is nothing
+ * to do.
+ */
+struct frame_packet_mailbox *frame_packet_mailbox_create(u64 packet_size);
+void frame_packet_mailbox_destroy(struct frame_packet_mailbox *mailbox);
+
+// NOTE: Producer side. The slot returned by begin_write belongs to the producer until publish.
+void *frame_packet_mailbox_begin_write(struct frame_packet_mailbox *mailbox);
+void frame_packet_mailbox_publish(struct frame_packet_mailbox *mailbox);
+void frame_packet_mailbox_wait_consumed(struct frame_packet_mailbox *mailbox);
+
+// NOTE: Consumer side. A packet stays valid and unchanged until the next acquire.
+const void *frame_packet_mailbox_acquire(struct frame_packet_mailbox *mailbox);
+
+void frame_packet_mailbox_close(struct frame_packet_mailbox *mailbox);
+
+#endif // FRAME_PACKET_H
@@ -0,0 +1,299 @@
+#include "frame_stats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    u64 frame;
+    frame_timing timing;
+    b8 hitch;
+} frame_record;
+
+struct frame_stats {
+    u32 capacity;
+    f64 hitch_threshold_ms;
+
+    // NOTE: Frame n is kept in records[n % capacity] until frame n + capacity is recorded.
+    frame_record *records;
+    u64 frame_count;
+    u64 hitch_count;
+
+    // NOTE: Sorted copy of one metric, reused by every summary.
+    f64 *scratch;
+};
+
+static const char *metric_names[] = {
+    [FRAME_METRIC_FRAME] = "frame",
+    [FRAME_METRIC_CPU] = "cpu",
+    [FRAME_METRIC_GPU] = "gpu",
+    [FRAME_METRIC_ACQUIRE] = "acquire",
+    [FRAME_METRIC_PRESENT] = "present",
+    [FRAME_METRIC_INPUT_LATENCY] = "input",
+};
+
+static u64 first_held_frame(const struct frame_stats *stats, u32 frame_count);
+static int compare_f64(const void *a, const void *b);
+static f64 percentile(const f64 *sorted, u32 count, f64 fraction);
+static void write_csv(const struct frame_stats *stats, FILE *fp);
+static void write_json(struct frame_stats *stats, FILE *fp);
+static void write_json_summary(FILE *fp, const frame_metric_summary *summary);
+static void write_json_ms(FILE *fp, f64 ms);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+struct frame_stats *frame_stats_create(u32 capacity, f64 hitch_threshold_ms) {
+    struct frame_stats *stats = calloc(1, sizeof(struct frame_stats));
+    stats->capacity = capacity;
+    stats->hitch_threshold_ms = hitch_threshold_ms;
+    stats->records = calloc(capacity, sizeof(frame_record));
+    stats->scratch = malloc(sizeof(f64) * capacity);
+
+    return stats;
+}
+
+void frame_stats_destroy(struct frame_stats *stats) {
+    free(stats->records);
+    free(stats->scratch);
+    free(stats);
+}
+
+void frame_stats_record(struct frame_stats *stats, const frame_timing *timing) {
+    b8 hitch = timing->ms[FRAME_METRIC_FRAME] > stats->hitch_threshold_ms;
+
+    stats->records[stats->frame_count % stats->capacity] = (frame_record){
+        .frame = stats->frame_count,
+        .timing = *timing,
+        .hitch = hitch,
+    };
+
+    stats->frame_count++;
+    if (hitch) {
+        stats->hitch_count++;
+    }
+}
+
+u64 frame_stats_frame_count(const struct frame_stats *stats) { return stats->frame_count; }
+
+u64 frame_stats_hitch_count(const struct frame_stats *stats) { return stats->hitch_count; }
+
+const char *frame_metric_name(frame_metric metric) { return metric_names[metric]; }
+
+frame_metric_summary frame_stats_summarize(struct frame_stats *stats,
+                                           frame_metric metric,
+                                           u32 frame_count) {
+    frame_metric_summary summary = {0};
+
+    f64 total_ms = 0.0;
+    for (u64 i = first_held_frame(stats, frame_count); i < stats->frame_count; i++) {
+        f64 ms = stats->records[i % stats->capacity].timing.ms[metric];
+        if (ms < 0.0) {
+            continue;
+        }
+
+        stats->scratch[summary.sample_count++] = ms;
+        total_ms += ms;
+    }
+
+    if (summary.sample_count == 0) {
+        return summary;
+    }
+
+    qsort(stats->scratch, summary.sample_count, sizeof(f64), compare_f64);
+
+    summary.mean_ms = total_ms / summary.sample_count;
+    summary.p50_ms = percentile(stats->scratch, summary.sample_count, 0.50);
+    summary.p95_ms = percentile(stats->scratch, summary.sample_count, 0.95);
+    summary.p99_ms = percentile(stats->scratch, summary.sample_count, 0.99);
+    summary.max_ms = stats->scratch[summary.sample_count - 1];
+
+    return summary;
+}
+
+void frame_stats_print(struct frame_stats *stats, u32 frame_count) {
+    frame_metric_summary frame = frame_stats_summarize(stats, FRAME_METRIC_FRAME, frame_count);
+    printf("%.1f fps, %llu hitches longer than %.1f ms so far\n",
+           frame.mean_ms > 0.0 ? 1000.0 / frame.mean_ms : 0.0,
+           stats->hitch_count,
+           stats->hitch_threshold_ms);
+
+    for (u32 i = 0; i < FRAME_METRIC_COUNT; i++) {
+        frame_metric_summary summary = frame_stats_summarize(stats, i, frame_count);
+        if (summary.sample_count == 0) {
+            continue;
+        }
+
+        printf("  %-8s p50 %7.3f  p95 %7.3f  p99 %7.3f  max %7.3f ms\n",
+               metric_names[i],
+               summary.p50_ms,
+               summary.p95_ms,
+               summary.p99_ms,
+               summary.max_ms);
+    }
+}
+
+b8 frame_stats_write_report(struct frame_stats *stats, const char *file_name) {
+    FILE *fp = fopen(file_name, "w");
+    if (!fp) {
+        fprintf(stderr, "Unable to open %s\n", file_name);
+        return false;
+    }
+
+    u64 length = strlen(file_name);
+    if (length >= 4 && strcmp(file_name + length - 4, ".csv") == 0) {
+        write_csv(stats, fp);
+    } else {
+        write_json(stats, fp);
+    }
+
+    fclose(fp);
+
+    printf("Wrote frame statistics to %s\n", file_name);
+    return true;
+}
+
+void frame_stats_write_summary(struct frame_stats *stats, f64 run_ms, FILE *fp) {
+    fprintf(fp,
+            "{\"frames\": %llu, \"run_ms\": %.4f, \"frames_per_second\": %.4f, "
+            "\"hitches\": %llu",
+            stats->frame_count,
+            run_ms,
+            run_ms > 0.0 ? stats->frame_count * 1000.0 / run_ms : 0.0,
+            stats->hitch_count);
+
+    for (u32 i = 0; i < FRAME_METRIC_COUNT; i++) {
+        frame_metric_summary summary = frame_stats_summarize(stats, i, 0);
+
+        fprintf(fp, ", \"%s\": {", metric_names[i]);
+        write_json_summary(fp, &summary);
+        fprintf(fp, "}");
+    }
+
+    fprintf(fp, "}\n");
+}
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+static u64 first_held_frame(const struct frame_stats *stats, u32 frame_count) {
+    u64 held = stats->frame_count < stats->capacity ? stats->frame_count : stats->capacity;
+    if (frame_count != 0 && frame_count < held) {
+        held = frame_count;
+    }
+
+    return stats->frame_count - held;
+}
+
+static int compare_f64(const void *a, const void *b) {
+    f64 left = *(const f64 *)a;
+    f64 right = *(const f64 *)b;
+    return (left > right) - (left < right);
+}
+
+/**
+ * Nearest-rank percentile: the smallest sample at least fraction of all samples are at or below.
+ */
+static f64 percentile(const f64 *sorted, u32 count, f64 fraction) {
+    u32 rank = (u32)ceil(fraction * count);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void write_csv(const struct frame_stats *stats, FILE *fp) {
+    fprintf(fp, "frame");
+    for (u32 i = 0; i < FRAME_METRIC_COUNT; i++) {
+        fprintf(fp, ",%s_ms", metric_names[i]);
+    }
+    fprintf(fp, ",hitch\n");
+
+    for (u64 i = first_held_frame(stats, 0); i < stats->frame_count; i++) {
+        const frame_record *record = &stats->records[i % stats->capacity];
+
+        fprintf(fp, "%llu", record->frame);
+        for (u32 j = 0; j < FRAME_METRIC_COUNT; j++) {
+            // NOTE: Metrics that were not measured are left empty.
+            if (record->timing.ms[j] < 0.0) {
+                fprintf(fp, ",");
+            } else {
+                fprintf(fp, ",%.4f", record->timing.ms[j]);
+            }
+        }
+        fprintf(fp, ",%d\n", record->hitch ? 1 : 0);
+    }
+}
+
+static void write_json(struct frame_stats *stats, FILE *fp) {
+    fprintf(fp,
+            "{\n  \"frames\": %llu,\n  \"hitch_threshold_ms\": %.4f,\n  \"hitches\": %llu,\n",
+            stats->frame_count,
+            stats->hitch_threshold_ms,
+            stats->hitch_count);
+    fprintf(fp, "  \"histogram_bucket_width_ms\": %.4f,\n", FRAME_STATS_BUCKET_WIDTH_MS);
+
+    u64 first = first_held_frame(stats, 0);
+
+    fprintf(fp, "  \"metrics\": {\n");
+    for (u32 i = 0; i < FRAME_METRIC_COUNT; i++) {
+        frame_metric_summary summary = frame_stats_summarize(stats, i, 0);
+
+        fprintf(fp, "    \"%s\": {", metric_names[i]);
+        write_json_summary(fp, &summary);
+        fprintf(fp, ",\n");
+
+        // NOTE: The last bucket also counts every sample beyond it.
+        u32 histogram[FRAME_STATS_HISTOGRAM_BUCKETS] = {0};
+        for (u64 j = first; j < stats->frame_count; j++) {
+            f64 ms = stats->records[j % stats->capacity].timing.ms[i];
+            if (ms < 0.0) {
+                continue;
+            }
+
+            u32 bucket = (u32)(ms / FRAME_STATS_BUCKET_WIDTH_MS);
+            histogram[bucket < FRAME_STATS_HISTOGRAM_BUCKETS ? bucket
+                                                             : FRAME_STATS_HISTOGRAM_BUCKETS - 1]++;
+        }
+
+        fprintf(fp, "      \"histogram\": [");
+        for (u32 j = 0; j < FRAME_STATS_HISTOGRAM_BUCKETS; j++) {
+            fprintf(fp, "%s%u", j == 0 ? "" : ", ", histogram[j]);
+        }
+        fprintf(fp, "]}%s\n", i + 1 < FRAME_METRIC_COUNT ? "," : "");
+    }
+    fprintf(fp, "  },\n");
+
+    fprintf(fp, "  \"timings\": [");
+    for (u64 i = first; i < stats->frame_count; i++) {
+        const frame_record *record = &stats->records[i % stats->capacity];
+
+        fprintf(fp, "%s\n    {\"frame\": %llu", i == first ? "" : ",", record->frame);
+        for (u32 j = 0; j < FRAME_METRIC_COUNT; j++) {
+            fprintf(fp, ", \"%s_ms\": ", metric_names[j]);
+            write_json_ms(fp, record->timing.ms[j]);
+        }
+        fprintf(fp, ", \"hitch\": %s}", record->hitch ? "true" : "false");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+}
+
+static void write_json_summary(FILE *fp, const frame_metric_summary *summary) {
+    fprintf(fp,
+            "\"samples\": %u, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, "
+            "\"p99_ms\": %.4f, \"max_ms\": %.4f",
+            summary->sample_count,
+            summary->mean_ms,
+            summary->p50_ms,
+            summary->p95_ms,
+            summary->p99_ms,
+            summary->max_ms);
+}
+
+static void write_json_ms(FILE *fp, f64 ms) {
+    if (ms < 0.0) {
+        fprintf(fp, "null");
+    } else {
+        fprintf(fp, "%.4f", ms);
+    }
+}
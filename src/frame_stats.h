@@ -0,0 +1,77 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include "defines.h"
+
+#include <stdio.h>
+
+#define FRAME_STATS_HISTOGRAM_BUCKETS 64
+#define FRAME_STATS_BUCKET_WIDTH_MS 0.5
+
+// NOTE: Marks a metric that was not measured for a frame, such as GPU time before the first
+// timestamps are read back.
+#define FRAME_STATS_NO_SAMPLE (-1.0)
+
+typedef enum {
+    // NOTE: Time from the start of the previous frame to the start of this one.
+    FRAME_METRIC_FRAME,
+    // NOTE: Time spent recording and submitting the frame, without waiting to acquire or present.
+    FRAME_METRIC_CPU,
+    FRAME_METRIC_GPU,
+    FRAME_METRIC_ACQUIRE,
+    FRAME_METRIC_PRESENT,
+    // NOTE: Time from sampling the input the frame's camera follows to submitting the frame.
+    FRAME_METRIC_INPUT_LATENCY,
+    FRAME_METRIC_COUNT,
+} frame_metric;
+
+typedef struct {
+    f64 ms[FRAME_METRIC_COUNT];
+} frame_timing;
+
+typedef struct {
+    u32 sample_count;
+    f64 mean_ms;
+    f64 p50_ms;
+    f64 p95_ms;
+    f64 p99_ms;
+    f64 max_ms;
+} frame_metric_summary;
+
+/**
+ * Keeps the timings of the last capacity frames in a ring. Percentiles are taken over the most
+ * recent frames on request, so recording a frame costs a copy. A frame whose FRAME_METRIC_FRAME
+ * exceeds the hitch threshold counts as a hitch. Not thread-safe; one thread records and reports.
+ */
+struct frame_stats *frame_stats_create(u32 capacity, f64 hitch_threshold_ms);
+void frame_stats_destroy(struct frame_stats *stats);
+
+void frame_stats_record(struct frame_stats *stats, const frame_timing *timing);
+
+u64 frame_stats_frame_count(const struct frame_stats *stats);
+u64 frame_stats_hitch_count(const struct frame_stats *stats);
+
+const char *frame_metric_name(frame_metric metric);
+
+/**
+ * Summarizes the last frame_count frames still held by the ring, or all of them when frame_count
+ * is 0. Frames the metric was not measured for are skipped.
+ */
+frame_metric_summary frame_stats_summarize(struct frame_stats *stats,
+                                           frame_metric metric,
+                                           u32 frame_count);
+void frame_stats_print(struct frame_stats *stats, u32 frame_count);
+
+/**
+ * Writes one row per frame held by the ring when file_name ends in .csv. Otherwise writes JSON
+ * with each metric's summary and histogram, the hitches and the same per-frame timings.
+ */
+b8 frame_stats_write_report(struct frame_stats *stats, const char *file_name);
+
+/**
+ * Writes a single JSON line with the frame count, throughput over run_ms and every metric's
+ * summary over the frames still held by the ring, for scripts comparing runs.
+ */
+void frame_stats_write_summary(struct frame_stats *stats, f64 run_ms, FILE *fp);
+
+#endif // FRAME_STATS_H
@@ -0,0 +1,145 @@
+#include "geometry_arena.h"
+
+#include "command_buffer.h"
+#include "context.h"
+#include "gpu_profiler.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <string.h>
+
+geometry_arena geometry_arena_create(const context *context,
+                                     u64 vertex_stride,
+                                     u32 vertex_capacity,
+                                     u32 index_capacity) {
+    geometry_arena arena = {
+        .vertex_stride = vertex_stride,
+        .vertex_capacity = vertex_capacity,
+        .index_capacity = index_capacity,
+    };
+
+    context_create_buffer(context,
+                          vertex_stride * vertex_capacity,
+                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                          &arena.vertex_buffer,
+                          &arena.vertex_buffer_memory);
+
+    context_create_buffer(context,
+                          sizeof(u32) * index_capacity,
+                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                          &arena.index_buffer,
+                          &arena.index_buffer_memory);
+
+    return arena;
+}
+
+b8 geometry_arena_upload(geometry_arena *arena,
+                         const context *context,
+                         const void *vertices,
+                         u32 vertex_count,
+                         const u32 *indices,
+                         u32 index_count,
+                         geometry_range *out_range) {
+    if (arena->vertex_count + vertex_count > arena->vertex_capacity ||
+        arena->index_count + index_count > arena->index_capacity) {
+        fprintf(stderr,
+                "Geometry arena is full (%u/%u vertices, %u/%u indices)\n",
+                arena->vertex_count,
+                arena->vertex_capacity,
+                arena->index_count,
+                arena->index_capacity);
+        return false;
+    }
+
+    VkDeviceSize vertex_size = arena->vertex_stride * vertex_count;
+    VkDeviceSize index_size = sizeof(u32) * index_count;
+
+    VkBuffer staging_buffer;
+    VkDeviceMemory staging_buffer_memory;
+
+    context_create_buffer(context,
+                          vertex_size + index_size,
+                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                          &staging_buffer,
+                          &staging_buffer_memory);
+
+    void *staging_buffer_mapped;
+    vkMapMemory(context->device.logical_device,
+                staging_buffer_memory,
+                0,
+                vertex_size + index_size,
+                0,
+                &staging_buffer_mapped);
+
+    memcpy(staging_buffer_mapped, vertices, vertex_size);
+    memcpy((void *)((u64)staging_buffer_mapped + vertex_size), indices, index_size);
+
+    vkUnmapMemory(context->device.logical_device, staging_buffer_memory);
+
+    VkCommandBuffer command_buffer = begin_single_time_commands(context);
+    u32 scope =
+        gpu_profiler_begin_immediate(context->gpu_profiler, &context->device, command_buffer);
+
+    VkBufferCopy vertex_region = {
+        .srcOffset = 0,
+        .dstOffset = arena->vertex_stride * arena->vertex_count,
+        .size = vertex_size,
+    };
+    vkCmdCopyBuffer(command_buffer, staging_buffer, arena->vertex_buffer, 1, &vertex_region);
+
+    VkBufferCopy index_region = {
+        .srcOffset = vertex_size,
+        .dstOffset = sizeof(u32) * arena->index_count,
+        .size = index_size,
+    };
+    vkCmdCopyBuffer(command_buffer, staging_buffer, arena->index_buffer, 1, &index_region);
+
+    context_upload_barrier(command_buffer);
+
+    gpu_profiler_end_immediate(context->gpu_profiler, command_buffer, scope, "upload");
+    u64 value = submit_single_time_commands(context, command_buffer);
+    gpu_profiler_submit_immediate(context->gpu_profiler, scope, value);
+
+    context_destroy_buffer_after(context, value, staging_buffer, staging_buffer_memory);
+
+    *out_range = (geometry_range){
+        .first_index = arena->index_count,
+        .index_count = index_count,
+        .vertex_offset = (i32)arena->vertex_count,
+        .vertex_count = vertex_count,
+    };
+
+    arena->vertex_count += vertex_count;
+    arena->index_count += index_count;
+
+    return true;
+}
+
+void geometry_arena_bind(const geometry_arena *arena, VkCommandBuffer command_buffer) {
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, &arena->vertex_buffer, offsets);
+    vkCmdBindIndexBuffer(command_buffer, arena->index_buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void geometry_arena_draw(const geometry_range *range, VkCommandBuffer command_buffer) {
+    vkCmdDrawIndexed(command_buffer,
+                     range->index_count,
+                     1,
+                     range->first_index,
+                     range->vertex_offset,
+                     0);
+}
+
+void geometry_arena_destroy(geometry_arena *arena, device *device) {
+    vkDestroyBuffer(device->logical_device, arena->vertex_buffer, NULL);
+    vkFreeMemory(device->logical_device, arena->vertex_buffer_memory, NULL);
+
+    vkDestroyBuffer(device->logical_device, arena->index_buffer, NULL);
+    vkFreeMemory(device->logical_device, arena->index_buffer_memory, NULL);
+
+    *arena = (geometry_arena){0};
+}
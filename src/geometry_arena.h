@@ -0,0 +1,49 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include "types.h"
+
+typedef struct {
+    u32 first_index;
+    u32 index_count;
+    i32 vertex_offset;
+    u32 vertex_count;
+} geometry_range;
+
+/**
+ * One device-local vertex buffer and one index buffer shared by every mesh with the same vertex
+ * layout. Meshes are sub-allocated as ranges and drawn through firstIndex/vertexOffset, so the
+ * arena is bound once per frame.
+ */
+typedef struct {
+    VkBuffer vertex_buffer;
+    VkDeviceMemory vertex_buffer_memory;
+    VkBuffer index_buffer;
+    VkDeviceMemory index_buffer_memory;
+
+    u64 vertex_stride;
+    u32 vertex_capacity;
+    u32 vertex_count;
+    u32 index_capacity;
+    u32 index_count;
+} geometry_arena;
+
+geometry_arena geometry_arena_create(const context *context,
+                                     u64 vertex_stride,
+                                     u32 vertex_capacity,
+                                     u32 index_capacity);
+
+b8 geometry_arena_upload(geometry_arena *arena,
+                         const context *context,
+                         const void *vertices,
+                         u32 vertex_count,
+                         const u32 *indices,
+                         u32 index_count,
+                         geometry_range *out_range);
+
+void geometry_arena_bind(const geometry_arena *arena, VkCommandBuffer command_buffer);
+void geometry_arena_draw(const geometry_range *range, VkCommandBuffer command_buffer);
+
+void geometry_arena_destroy(geometry_arena *arena, device *device);
+
+#endif // GEOMETRY_ARENA_H
@@ -4,6 +4,7 @@
 #include "cglm/types-struct.h"
 #include "defines.h"
 #include "json.h"
+#include "profiler.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -28,8 +29,13 @@ struct gltf_chunk {
 
 static void parse_gltf(json_value *gltf, gltf_root *out_data);
 
+/**
+ * Stops at the first problem it reports, leaving out_gltf with whatever was parsed so far, which
+ * gltf_destroy can still release.
+ */
 void load_gltf_from_file(const char *file_name, gltf_root *out_gltf) {
-    (void)out_gltf;
+    PROFILE_FUNCTION();
+
     FILE *fp = fopen(file_name, "rb");
     if (!fp) {
         fprintf(stderr, "Unable to open file: %s\n", file_name);
@@ -39,14 +45,17 @@ void load_gltf_from_file(const char *file_name, gltf_root *out_gltf) {
     struct gltf_header header;
     if (fread(&header, sizeof(struct gltf_header), 1, fp) != 1) {
         fprintf(stderr, "unable to read file header: %s\n", file_name);
+        fclose(fp);
         return;
     }
     if (header.magic != GLTF_MAGIC) {
         fprintf(stderr, "%s is not a glTF file\n", file_name);
+        fclose(fp);
         return;
     }
     if (header.version != 2) {
         fprintf(stderr, "glTF binary version is not supported for: %s\n", file_name);
+        fclose(fp);
         return;
     }
 
@@ -55,6 +64,7 @@ void load_gltf_from_file(const char *file_name, gltf_root *out_gltf) {
         struct gltf_chunk temp_chunk;
         if (fread(&temp_chunk, sizeof(temp_chunk), 1, fp) != 1) {
             fprintf(stderr, "unable to read chunk from: %s\n", file_name);
+            fclose(fp);
             return;
         }
 
@@ -68,6 +78,8 @@ void load_gltf_from_file(const char *file_name, gltf_root *out_gltf) {
                     : chunk->chunk_type == GLTF_CHUNK_TYPE_BIN ? "binary"
                                                                : "unknown",
                     file_name);
+            free(chunk);
+            fclose(fp);
             return;
         }
 
@@ -75,22 +87,34 @@ void load_gltf_from_file(const char *file_name, gltf_root *out_gltf) {
             json_value *gltf = json_parse((char *)chunk->chunk_data, chunk->chunk_length);
             if (gltf == NULL) {
                 fprintf(stderr, "Failed to parse json!\n");
+                free(chunk);
+                fclose(fp);
                 return;
             }
             if (gltf->type != JSON_VALUE_OBJECT) {
                 fprintf(stderr, "gltf is not an object\n");
+                json_value_free(gltf);
+                free(chunk);
+                fclose(fp);
                 return;
             }
             parse_gltf(gltf, out_gltf);
             json_value_free(gltf);
 
-            out_gltf->buffer_data = malloc(sizeof(*out_gltf->buffer_data) * out_gltf->buffer_count);
+            out_gltf->buffer_data = calloc(out_gltf->buffer_count, sizeof(*out_gltf->buffer_data));
             for (u32 i = 0; i < out_gltf->buffer_count; i++) {
                 out_gltf->buffer_data[i] = malloc(out_gltf->buffers[i].byte_length);
             }
         }
 
         if (chunk->chunk_type == GLTF_CHUNK_TYPE_BIN) {
+            // NOTE: Only a chunk following the JSON chunk knows where its data goes.
+            if (out_gltf->buffer_data == NULL || buffer_index >= out_gltf->buffer_count) {
+                fprintf(stderr, "unexpected binary chunk in: %s\n", file_name);
+                free(chunk);
+                fclose(fp);
+                return;
+            }
             memcpy(out_gltf->buffer_data[buffer_index],
                    chunk->chunk_data,
                    out_gltf->buffers[buffer_index].byte_length);
@@ -103,6 +127,31 @@ void load_gltf_from_file(const char *file_name, gltf_root *out_gltf) {
     fclose(fp);
 }
 
+void gltf_destroy(gltf_root *gltf) {
+    for (u32 i = 0; i < gltf->mesh_count; i++) {
+        for (u32 j = 0; j < gltf->meshes[i].primitive_count; j++) {
+            free(gltf->meshes[i].primitives[j].attributes);
+        }
+        free(gltf->meshes[i].primitives);
+    }
+
+    if (gltf->buffer_data != NULL) {
+        for (u32 i = 0; i < gltf->buffer_count; i++) {
+            free(gltf->buffer_data[i]);
+        }
+    }
+
+    free(gltf->default_scene.nodes);
+    free(gltf->nodes);
+    free(gltf->meshes);
+    free(gltf->accessors);
+    free(gltf->buffer_views);
+    free(gltf->buffers);
+    free(gltf->buffer_data);
+
+    *gltf = (gltf_root){0};
+}
+
 #define json_get_value(object, value, value_type)                                                  \
     {                                                                                              \
         value = json_object_get_value(object, #value);                                             \
@@ -130,7 +179,7 @@ static void parse_scene(json_value *scene, gltf_scene *out_data) {
     json_get_value(scene, nodes, JSON_VALUE_ARRAY);
 
     out_data->node_count = nodes->u.array.length;
-    out_data->nodes = malloc(sizeof(*(out_data->nodes)) * nodes->u.array.length);
+    out_data->nodes = calloc(nodes->u.array.length, sizeof(*(out_data->nodes)));
     for (u32 i = 0; i < nodes->u.array.length; i++) {
         if (nodes->u.array.values[i]->type != JSON_VALUE_INTEGER) {
             fprintf(stderr, "nodes array contains value that is not an integer\n");
@@ -196,7 +245,7 @@ static void parse_primitive(json_value *primitive, gltf_mesh_primitive *out_data
     }
 
     out_data->attribute_count = attribute_count;
-    out_data->attributes = malloc(sizeof(*out_data->attributes) * attribute_count);
+    out_data->attributes = calloc(attribute_count, sizeof(*out_data->attributes));
     {
         u32 i = 0;
         if (POSITION) {
@@ -231,7 +280,7 @@ static void parse_mesh(json_value *mesh, gltf_mesh *out_data) {
     json_get_value(mesh, primitives, JSON_VALUE_ARRAY);
 
     out_data->primitive_count = primitives->u.array.length;
-    out_data->primitives = malloc(sizeof(*out_data->primitives) * primitives->u.array.length);
+    out_data->primitives = calloc(primitives->u.array.length, sizeof(*out_data->primitives));
     for (u32 i = 0; i < primitives->u.array.length; i++) {
         if (primitives->u.array.values[i]->type != JSON_VALUE_OBJECT) {
             fprintf(stderr, "value at index %d in nodes array is not an object", i);
@@ -393,7 +442,7 @@ static void parse_gltf(json_value *gltf, gltf_root *out_data) {
     json_get_value(gltf, nodes, JSON_VALUE_ARRAY);
 
     out_data->node_count = nodes->u.array.length;
-    out_data->nodes = malloc(sizeof(*out_data->nodes) * nodes->u.array.length);
+    out_data->nodes = calloc(nodes->u.array.length, sizeof(*out_data->nodes));
     for (u32 i = 0; i < nodes->u.array.length; i++) {
         if (nodes->u.array.values[i]->type != JSON_VALUE_OBJECT) {
             fprintf(stderr, "value at index %d in nodes array is not an object", i);
@@ -406,7 +455,7 @@ static void parse_gltf(json_value *gltf, gltf_root *out_data) {
     json_get_value(gltf, meshes, JSON_VALUE_ARRAY);
 
     out_data->mesh_count = meshes->u.array.length;
-    out_data->meshes = malloc(sizeof(*out_data->meshes) * meshes->u.array.length);
+    out_data->meshes = calloc(meshes->u.array.length, sizeof(*out_data->meshes));
     for (u32 i = 0; i < meshes->u.array.length; i++) {
         if (meshes->u.array.values[i]->type != JSON_VALUE_OBJECT) {
             fprintf(stderr, "value at index %d in meshes array is not an object", i);
@@ -419,7 +468,7 @@ static void parse_gltf(json_value *gltf, gltf_root *out_data) {
     json_get_value(gltf, accessors, JSON_VALUE_ARRAY);
 
     out_data->accessor_count = accessors->u.array.length;
-    out_data->accessors = malloc(sizeof(*out_data->accessors) * accessors->u.array.length);
+    out_data->accessors = calloc(accessors->u.array.length, sizeof(*out_data->accessors));
     for (u32 i = 0; i < accessors->u.array.length; i++) {
         if (accessors->u.array.values[i]->type != JSON_VALUE_OBJECT) {
             fprintf(stderr, "value at index %d in accessors array is not an object", i);
@@ -432,7 +481,7 @@ static void parse_gltf(json_value *gltf, gltf_root *out_data) {
     json_get_value(gltf, bufferViews, JSON_VALUE_ARRAY);
 
     out_data->buffer_view_count = bufferViews->u.array.length;
-    out_data->buffer_views = malloc(sizeof(*out_data->buffer_views) * bufferViews->u.array.length);
+    out_data->buffer_views = calloc(bufferViews->u.array.length, sizeof(*out_data->buffer_views));
     for (u32 i = 0; i < bufferViews->u.array.length; i++) {
         if (bufferViews->u.array.values[i]->type != JSON_VALUE_OBJECT) {
             fprintf(stderr, "value at index %d in bufferViews array is not an object", i);
@@ -445,7 +494,7 @@ static void parse_gltf(json_value *gltf, gltf_root *out_data) {
     json_get_value(gltf, buffers, JSON_VALUE_ARRAY);
 
     out_data->buffer_count = buffers->u.array.length;
-    out_data->buffers = malloc(sizeof(*out_data->buffers) * buffers->u.array.length);
+    out_data->buffers = calloc(buffers->u.array.length, sizeof(*out_data->buffers));
     for (u32 i = 0; i < buffers->u.array.length; i++) {
         if (buffers->u.array.values[i]->type != JSON_VALUE_OBJECT) {
             fprintf(stderr, "value at index %d in buffers array is not an object", i);
@@ -3,6 +3,7 @@
 
 #include "defines.h"
 
+#include <stdio.h>
 #include <string.h>
 
 typedef struct {
@@ -148,5 +149,7 @@ typedef struct {
 } gltf_root;
 
 void load_gltf_from_file(const char *file_name, gltf_root *out_gltf);
+// NOTE: For a gltf_root that was zero-initialized before loading, also after a failed load.
+void gltf_destroy(gltf_root *gltf);
 
 #endif // GLFT_H
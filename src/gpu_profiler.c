@@ -0,0 +1,494 @@
+#include "gpu_profiler.h"
+
+#include "timeline.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    VkQueryPool query_pool;
+    // NOTE: Bumped by every thread beginning a scope, may run past GPU_PROFILER_MAX_SCOPES.
+    atomic_uint scope_count;
+    const char *scope_names[GPU_PROFILER_MAX_SCOPES];
+    b8 pending;
+} profiler_frame;
+
+typedef struct {
+    const char *name;
+    f64 samples_ms[GPU_PROFILER_HISTORY];
+    u32 sample_count;
+    u32 next_sample;
+} profiler_scope;
+
+typedef struct {
+    const char *name;
+    u64 begin;
+    u64 end;
+} trace_event;
+
+typedef struct {
+    const char *name;
+    // NOTE: Graphics timeline value of the slot's submission, 0 until it is submitted. The slot's
+    // queries still hold the previous results until then, since they are reset on the GPU.
+    u64 value;
+    b8 in_use;
+} immediate_scope;
+
+struct gpu_profiler {
+    b8 enabled;
+    // NOTE: Nanoseconds per timestamp tick.
+    f64 timestamp_period;
+    u64 timestamp_mask;
+
+    profiler_frame frames[MAX_FRAMES_IN_FLIGHT];
+    u32 frame_count;
+    u32 current_frame;
+
+    struct timeline *timeline;
+    VkQueryPool immediate_query_pool;
+    immediate_scope immediates[GPU_PROFILER_MAX_IMMEDIATE];
+
+    profiler_scope scopes[GPU_PROFILER_MAX_NAMES];
+    u32 scope_count;
+
+    b8 has_frame_time;
+    f64 frame_time_ms;
+
+    trace_event *trace_events;
+    u32 trace_next;
+    u32 trace_count;
+};
+
+static VkQueryPool create_query_pool(const context *context, u32 query_count);
+static void collect_frame(struct gpu_profiler *profiler,
+                          const device *device,
+                          profiler_frame *frame);
+static void add_sample(struct gpu_profiler *profiler, const char *name, u64 begin, u64 end);
+static u32 find_free_immediate(const struct gpu_profiler *profiler);
+static f64 ticks_to_ms(const struct gpu_profiler *profiler, u64 ticks);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+struct gpu_profiler *gpu_profiler_create(const context *context) {
+    struct gpu_profiler *profiler = calloc(1, sizeof(struct gpu_profiler));
+    profiler->frame_count = context->max_frames_in_flight;
+    profiler->timeline = context->timeline;
+
+    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        atomic_init(&profiler->frames[i].scope_count, 0);
+    }
+
+    u32 family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(context->device.physical_device,
+                                             &family_count,
+                                             NULL);
+    VkQueueFamilyProperties families[family_count];
+    vkGetPhysicalDeviceQueueFamilyProperties(context->device.physical_device,
+                                             &family_count,
+                                             families);
+    u32 valid_bits = families[context->device.graphics_queue_index].timestampValidBits;
+
+    if (!context->device.properties.limits.timestampComputeAndGraphics || valid_bits == 0) {
+        printf("Timestamps are not supported, GPU timings are unavailable.\n");
+        return profiler;
+    }
+
+    profiler->enabled = true;
+    profiler->timestamp_period = context->device.properties.limits.timestampPeriod;
+    profiler->timestamp_mask = valid_bits >= 64 ? UINT64_MAX : (1ull << valid_bits) - 1;
+
+    for (u32 i = 0; i < profiler->frame_count; i++) {
+        profiler->frames[i].query_pool = create_query_pool(context, GPU_PROFILER_MAX_SCOPES * 2);
+    }
+    profiler->immediate_query_pool = create_query_pool(context, GPU_PROFILER_MAX_IMMEDIATE * 2);
+
+    profiler->trace_events = calloc(GPU_PROFILER_TRACE_CAPACITY, sizeof(trace_event));
+
+    return profiler;
+}
+
+void gpu_profiler_destroy(struct gpu_profiler *profiler, device *device) {
+    for (u32 i = 0; i < profiler->frame_count; i++) {
+        vkDestroyQueryPool(device->logical_device, profiler->frames[i].query_pool, NULL);
+    }
+    vkDestroyQueryPool(device->logical_device, profiler->immediate_query_pool, NULL);
+
+    free(profiler->trace_events);
+    free(profiler);
+}
+
+b8 gpu_profiler_enabled(const struct gpu_profiler *profiler) { return profiler->enabled; }
+
+/**
+ * Reads back the results this frame slot held since its last use and resets its queries. Must be
+ * recorded outside of a render pass, after the frame's timeline value has been reached.
+ */
+void gpu_profiler_begin_frame(struct gpu_profiler *profiler,
+                              const device *device,
+                              VkCommandBuffer command_buffer,
+                              u32 frame_index) {
+    if (!profiler->enabled) {
+        return;
+    }
+
+    profiler_frame *frame = &profiler->frames[frame_index];
+    collect_frame(profiler, device, frame);
+    gpu_profiler_collect_immediate(profiler, device);
+
+    vkCmdResetQueryPool(command_buffer, frame->query_pool, 0, GPU_PROFILER_MAX_SCOPES * 2);
+    atomic_store_explicit(&frame->scope_count, 0, memory_order_relaxed);
+    frame->pending = true;
+
+    profiler->current_frame = frame_index;
+}
+
+u32 gpu_profiler_begin_scope(struct gpu_profiler *profiler,
+                             VkCommandBuffer command_buffer,
+                             const char *name) {
+    if (!profiler->enabled) {
+        return GPU_PROFILER_NO_SCOPE;
+    }
+
+    profiler_frame *frame = &profiler->frames[profiler->current_frame];
+    u32 scope = atomic_fetch_add_explicit(&frame->scope_count, 1, memory_order_relaxed);
+    if (scope >= GPU_PROFILER_MAX_SCOPES) {
+        return GPU_PROFILER_NO_SCOPE;
+    }
+
+    frame->scope_names[scope] = name;
+    vkCmdWriteTimestamp(command_buffer,
+                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        frame->query_pool,
+                        scope * 2);
+
+    return scope;
+}
+
+void gpu_profiler_end_scope(struct gpu_profiler *profiler,
+                            VkCommandBuffer command_buffer,
+                            u32 scope) {
+    if (scope == GPU_PROFILER_NO_SCOPE) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(command_buffer,
+                        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        profiler->frames[profiler->current_frame].query_pool,
+                        scope * 2 + 1);
+}
+
+u32 gpu_profiler_begin_immediate(struct gpu_profiler *profiler,
+                                 const device *device,
+                                 VkCommandBuffer command_buffer) {
+    if (!profiler->enabled) {
+        return GPU_PROFILER_NO_SCOPE;
+    }
+
+    u32 scope = find_free_immediate(profiler);
+    if (scope == GPU_PROFILER_NO_SCOPE) {
+        gpu_profiler_collect_immediate(profiler, device);
+        scope = find_free_immediate(profiler);
+        if (scope == GPU_PROFILER_NO_SCOPE) {
+            return GPU_PROFILER_NO_SCOPE;
+        }
+    }
+
+    profiler->immediates[scope] = (immediate_scope){.in_use = true};
+
+    vkCmdResetQueryPool(command_buffer, profiler->immediate_query_pool, scope * 2, 2);
+    vkCmdWriteTimestamp(command_buffer,
+                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        profiler->immediate_query_pool,
+                        scope * 2);
+
+    return scope;
+}
+
+void gpu_profiler_end_immediate(struct gpu_profiler *profiler,
+                                VkCommandBuffer command_buffer,
+                                u32 scope,
+                                const char *name) {
+    if (scope == GPU_PROFILER_NO_SCOPE) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(command_buffer,
+                        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        profiler->immediate_query_pool,
+                        scope * 2 + 1);
+    profiler->immediates[scope].name = name;
+}
+
+void gpu_profiler_submit_immediate(struct gpu_profiler *profiler, u32 scope, u64 value) {
+    if (scope == GPU_PROFILER_NO_SCOPE) {
+        return;
+    }
+
+    profiler->immediates[scope].value = value;
+}
+
+void gpu_profiler_collect_immediate(struct gpu_profiler *profiler, const device *device) {
+    if (!profiler->enabled) {
+        return;
+    }
+
+    for (u32 i = 0; i < GPU_PROFILER_MAX_IMMEDIATE; i++) {
+        immediate_scope *scope = &profiler->immediates[i];
+        if (!scope->in_use || scope->value == 0 ||
+            !timeline_reached(profiler->timeline, TIMELINE_QUEUE_GRAPHICS, scope->value)) {
+            continue;
+        }
+
+        u64 timestamps[2];
+        VkResult result = vkGetQueryPoolResults(device->logical_device,
+                                                profiler->immediate_query_pool,
+                                                i * 2,
+                                                2,
+                                                sizeof(timestamps),
+                                                timestamps,
+                                                sizeof(u64),
+                                                VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS) {
+            add_sample(profiler, scope->name, timestamps[0], timestamps[1]);
+            *scope = (immediate_scope){0};
+        }
+    }
+}
+
+b8 gpu_profiler_frame_time(const struct gpu_profiler *profiler, f64 *frame_time_ms) {
+    if (!profiler->has_frame_time) {
+        return false;
+    }
+
+    *frame_time_ms = profiler->frame_time_ms;
+    return true;
+}
+
+u32 gpu_profiler_scope_count(const struct gpu_profiler *profiler) {
+    return profiler->scope_count;
+}
+
+gpu_scope_stats gpu_profiler_scope_stats(const struct gpu_profiler *profiler, u32 index) {
+    const profiler_scope *scope = &profiler->scopes[index];
+
+    gpu_scope_stats stats = {
+        .name = scope->name,
+        .sample_count = scope->sample_count,
+    };
+
+    if (scope->sample_count == 0) {
+        return stats;
+    }
+
+    stats.last_ms = scope->samples_ms[(scope->next_sample + GPU_PROFILER_HISTORY - 1) %
+                                      GPU_PROFILER_HISTORY];
+    stats.min_ms = scope->samples_ms[0];
+    stats.max_ms = scope->samples_ms[0];
+
+    f64 total_ms = 0.0;
+    for (u32 i = 0; i < scope->sample_count; i++) {
+        f64 sample_ms = scope->samples_ms[i];
+        total_ms += sample_ms;
+        if (sample_ms < stats.min_ms) {
+            stats.min_ms = sample_ms;
+        }
+        if (sample_ms > stats.max_ms) {
+            stats.max_ms = sample_ms;
+        }
+    }
+    stats.average_ms = total_ms / scope->sample_count;
+
+    return stats;
+}
+
+void gpu_profiler_print(const struct gpu_profiler *profiler) {
+    if (!profiler->enabled || profiler->scope_count == 0) {
+        return;
+    }
+
+    printf("GPU ms (min/avg/max):");
+    for (u32 i = 0; i < profiler->scope_count; i++) {
+        gpu_scope_stats stats = gpu_profiler_scope_stats(profiler, i);
+        printf(" %s %.3f/%.3f/%.3f", stats.name, stats.min_ms, stats.average_ms, stats.max_ms);
+    }
+    printf("\n");
+}
+
+b8 gpu_profiler_write_trace(const struct gpu_profiler *profiler, const char *file_name) {
+    FILE *fp = fopen(file_name, "w");
+    if (!fp) {
+        fprintf(stderr, "Unable to open %s\n", file_name);
+        return false;
+    }
+
+    u32 first = (profiler->trace_next + GPU_PROFILER_TRACE_CAPACITY - profiler->trace_count) %
+                GPU_PROFILER_TRACE_CAPACITY;
+
+    u64 origin = UINT64_MAX;
+    for (u32 i = 0; i < profiler->trace_count; i++) {
+        const trace_event *event =
+            &profiler->trace_events[(first + i) % GPU_PROFILER_TRACE_CAPACITY];
+        if (event->begin < origin) {
+            origin = event->begin;
+        }
+    }
+
+    fprintf(fp, "{\"traceEvents\":[\n");
+    fprintf(fp,
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+            "\"args\":{\"name\":\"GPU\"}}");
+
+    for (u32 i = 0; i < profiler->trace_count; i++) {
+        const trace_event *event =
+            &profiler->trace_events[(first + i) % GPU_PROFILER_TRACE_CAPACITY];
+        fprintf(fp,
+                ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                event->name,
+                ticks_to_ms(profiler, event->begin - origin) * 1000.0,
+                ticks_to_ms(profiler, event->end - event->begin) * 1000.0);
+    }
+
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+
+    printf("Wrote %u GPU scopes to %s\n", profiler->trace_count, file_name);
+    return true;
+}
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+static VkQueryPool create_query_pool(const context *context, u32 query_count) {
+    VkQueryPoolCreateInfo query_pool_info = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = query_count,
+    };
+
+    VkQueryPool query_pool;
+    VK_CHECK(vkCreateQueryPool(context->device.logical_device,
+                               &query_pool_info,
+                               NULL,
+                               &query_pool));
+
+    return query_pool;
+}
+
+static u32 find_free_immediate(const struct gpu_profiler *profiler) {
+    for (u32 i = 0; i < GPU_PROFILER_MAX_IMMEDIATE; i++) {
+        if (!profiler->immediates[i].in_use) {
+            return i;
+        }
+    }
+
+    return GPU_PROFILER_NO_SCOPE;
+}
+
+/**
+ * Scopes whose timestamps are not both available, such as one that was never ended, are skipped
+ * rather than waited for.
+ */
+static void collect_frame(struct gpu_profiler *profiler,
+                          const device *device,
+                          profiler_frame *frame) {
+    profiler->has_frame_time = false;
+
+    if (!frame->pending) {
+        return;
+    }
+    frame->pending = false;
+
+    u32 scope_count = atomic_load_explicit(&frame->scope_count, memory_order_relaxed);
+    if (scope_count > GPU_PROFILER_MAX_SCOPES) {
+        scope_count = GPU_PROFILER_MAX_SCOPES;
+    }
+    if (scope_count == 0) {
+        return;
+    }
+
+    // NOTE: Each query yields its timestamp followed by its availability.
+    u64 results[GPU_PROFILER_MAX_SCOPES * 2][2];
+    VkResult result = vkGetQueryPoolResults(device->logical_device,
+                                            frame->query_pool,
+                                            0,
+                                            scope_count * 2,
+                                            sizeof(u64) * 2 * scope_count * 2,
+                                            results,
+                                            sizeof(u64) * 2,
+                                            VK_QUERY_RESULT_64_BIT |
+                                                VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        return;
+    }
+
+    u64 frame_begin = UINT64_MAX;
+    u64 frame_end = 0;
+    for (u32 i = 0; i < scope_count; i++) {
+        const u64 *begin = results[i * 2];
+        const u64 *end = results[i * 2 + 1];
+        if (!begin[1] || !end[1]) {
+            continue;
+        }
+
+        add_sample(profiler, frame->scope_names[i], begin[0], end[0]);
+
+        if (begin[0] < frame_begin) {
+            frame_begin = begin[0];
+        }
+        if (end[0] > frame_end) {
+            frame_end = end[0];
+        }
+    }
+
+    if (frame_begin < frame_end) {
+        profiler->frame_time_ms = ticks_to_ms(profiler, frame_end - frame_begin);
+        profiler->has_frame_time = true;
+    }
+}
+
+static void add_sample(struct gpu_profiler *profiler, const char *name, u64 begin, u64 end) {
+    begin &= profiler->timestamp_mask;
+    end &= profiler->timestamp_mask;
+
+    profiler_scope *scope = NULL;
+    for (u32 i = 0; i < profiler->scope_count; i++) {
+        if (profiler->scopes[i].name == name || strcmp(profiler->scopes[i].name, name) == 0) {
+            scope = &profiler->scopes[i];
+            break;
+        }
+    }
+
+    if (scope == NULL) {
+        if (profiler->scope_count == GPU_PROFILER_MAX_NAMES) {
+            return;
+        }
+        scope = &profiler->scopes[profiler->scope_count++];
+        scope->name = name;
+    }
+
+    scope->samples_ms[scope->next_sample] =
+        ticks_to_ms(profiler, (end - begin) & profiler->timestamp_mask);
+    scope->next_sample = (scope->next_sample + 1) % GPU_PROFILER_HISTORY;
+    if (scope->sample_count < GPU_PROFILER_HISTORY) {
+        scope->sample_count++;
+    }
+
+    profiler->trace_events[profiler->trace_next] = (trace_event){
+        .name = scope->name,
+        .begin = begin,
+        .end = end,
+    };
+    profiler->trace_next = (profiler->trace_next + 1) % GPU_PROFILER_TRACE_CAPACITY;
+    if (profiler->trace_count < GPU_PROFILER_TRACE_CAPACITY) {
+        profiler->trace_count++;
+    }
+}
+
+static f64 ticks_to_ms(const struct gpu_profiler *profiler, u64 ticks) {
+    return (f64)ticks * profiler->timestamp_period / 1000000.0;
+}
@@ -0,0 +1,83 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include "types.h"
+
+#include <stdint.h>
+
+#define GPU_PROFILER_MAX_SCOPES 64
+#define GPU_PROFILER_MAX_NAMES 32
+// NOTE: Samples each scope's min/avg/max is taken over.
+#define GPU_PROFILER_HISTORY 128
+#define GPU_PROFILER_TRACE_CAPACITY (1 << 16)
+// NOTE: One-off command buffers that can be timed while still executing.
+#define GPU_PROFILER_MAX_IMMEDIATE 16
+
+// NOTE: Returned by begin_scope when timestamps are unsupported or the frame is out of scopes.
+#define GPU_PROFILER_NO_SCOPE UINT32_MAX
+
+typedef struct {
+    const char *name;
+    u32 sample_count;
+    f64 last_ms;
+    f64 min_ms;
+    f64 average_ms;
+    f64 max_ms;
+} gpu_scope_stats;
+
+/**
+ * Times named scopes on the GPU with a vkCmdWriteTimestamp pair each, in one query pool per frame
+ * in flight. A frame's results are read back when its slot is reused, after its timeline value
+ * has been reached, so reading never stalls. Scopes may be begun from any thread recording the
+ * frame, in primary or secondary command buffers; everything else belongs to the thread owning the
+ * context. Scope names must outlive the profiler.
+ */
+struct gpu_profiler *gpu_profiler_create(const context *context);
+void gpu_profiler_destroy(struct gpu_profiler *profiler, device *device);
+
+b8 gpu_profiler_enabled(const struct gpu_profiler *profiler);
+
+void gpu_profiler_begin_frame(struct gpu_profiler *profiler,
+                              const device *device,
+                              VkCommandBuffer command_buffer,
+                              u32 frame_index);
+u32 gpu_profiler_begin_scope(struct gpu_profiler *profiler,
+                             VkCommandBuffer command_buffer,
+                             const char *name);
+void gpu_profiler_end_scope(struct gpu_profiler *profiler,
+                            VkCommandBuffer command_buffer,
+                            u32 scope);
+
+/**
+ * For one-off command buffers outside the frame loop, which are not waited for. begin returns
+ * GPU_PROFILER_NO_SCOPE while every immediate slot is still executing. submit_immediate takes the
+ * graphics timeline value the command buffer was submitted with, and the timings are read back by
+ * collect_immediate without waiting once it is reached, which begin_frame calls as well.
+ */
+u32 gpu_profiler_begin_immediate(struct gpu_profiler *profiler,
+                                 const device *device,
+                                 VkCommandBuffer command_buffer);
+void gpu_profiler_end_immediate(struct gpu_profiler *profiler,
+                                VkCommandBuffer command_buffer,
+                                u32 scope,
+                                const char *name);
+void gpu_profiler_submit_immediate(struct gpu_profiler *profiler, u32 scope, u64 value);
+void gpu_profiler_collect_immediate(struct gpu_profiler *profiler, const device *device);
+
+/**
+ * @returns false until a frame has been read back, otherwise the time from its first to its last
+ * timestamp.
+ */
+b8 gpu_profiler_frame_time(const struct gpu_profiler *profiler, f64 *frame_time_ms);
+
+u32 gpu_profiler_scope_count(const struct gpu_profiler *profiler);
+gpu_scope_stats gpu_profiler_scope_stats(const struct gpu_profiler *profiler, u32 index);
+void gpu_profiler_print(const struct gpu_profiler *profiler);
+
+/**
+ * Writes the most recent GPU_PROFILER_TRACE_CAPACITY scopes in the Chrome trace event format,
+ * loadable in chrome://tracing or Perfetto.
+ */
+b8 gpu_profiler_write_trace(const struct gpu_profiler *profiler, const char *file_name);
+
+#endif // GPU_PROFILER_H
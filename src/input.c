@@ -0,0 +1,268 @@
+#include "input.h"
+
+#include "darray.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACKED __attribute__((packed))
+
+#define INPUT_LOG_MAGIC 0x4c504e49 // "INPL"
+#define INPUT_LOG_VERSION 1
+
+typedef enum {
+    INPUT_EVENT_KEY,
+    INPUT_EVENT_CURSOR,
+    // NOTE: Written once per tick, after its other events.
+    INPUT_EVENT_STEP,
+} input_event_type;
+
+typedef struct {
+    u32 magic;
+    u32 version;
+} PACKED input_log_header;
+
+typedef struct {
+    u8 type;
+    u32 tick;
+    union {
+        struct {
+            i16 key;
+            u8 action;
+        } PACKED key;
+        struct {
+            f32 x;
+            f32 y;
+        } PACKED cursor;
+        f32 step;
+    } PACKED;
+} PACKED input_event;
+
+STATIC_ASSERT(sizeof(input_event) == 13, "Expected input events to be 13 bytes.");
+
+struct input {
+    GLFWwindow *window;
+    input_state state;
+    u64 tick;
+
+    FILE *recording;
+
+    input_event *replay_events; // darray
+    u64 replay_next;
+};
+
+static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
+static void cursor_position_callback(GLFWwindow *window, double x_position, double y_position);
+static void submit_event(struct input *input, const input_event *event);
+static void apply_event(input_state *state, const input_event *event);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+struct input *input_create(GLFWwindow *window) {
+    struct input *input = calloc(1, sizeof(struct input));
+    input->window = window;
+
+    if (window) {
+        glfwSetWindowUserPointer(window, input);
+        glfwSetKeyCallback(window, key_callback);
+        glfwSetCursorPosCallback(window, cursor_position_callback);
+    }
+
+    return input;
+}
+
+void input_destroy(struct input *input) {
+    if (input->window) {
+        glfwSetKeyCallback(input->window, NULL);
+        glfwSetCursorPosCallback(input->window, NULL);
+        glfwSetWindowUserPointer(input->window, NULL);
+    }
+
+    if (input->recording) {
+        fclose(input->recording);
+    }
+    if (input->replay_events) {
+        darray_destroy(input->replay_events);
+    }
+
+    free(input);
+}
+
+b8 input_start_recording(struct input *input, const char *file_name) {
+    FILE *fp = fopen(file_name, "wb");
+    if (!fp) {
+        fprintf(stderr, "Unable to open %s\n", file_name);
+        return false;
+    }
+
+    input_log_header header = {
+        .magic = INPUT_LOG_MAGIC,
+        .version = INPUT_LOG_VERSION,
+    };
+    fwrite(&header, sizeof(header), 1, fp);
+
+    input->recording = fp;
+    return true;
+}
+
+b8 input_start_replay(struct input *input, const char *file_name) {
+    FILE *fp = fopen(file_name, "rb");
+    if (!fp) {
+        fprintf(stderr, "Unable to open input log: %s\n", file_name);
+        return false;
+    }
+
+    input_log_header header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != INPUT_LOG_MAGIC ||
+        header.version != INPUT_LOG_VERSION) {
+        fprintf(stderr, "%s is not an input log of version %d\n", file_name, INPUT_LOG_VERSION);
+        fclose(fp);
+        return false;
+    }
+
+    input->replay_events = darray_create(input_event);
+
+    input_event event;
+    while (fread(&event, sizeof(event), 1, fp) == 1) {
+        darray_push(input->replay_events, event);
+    }
+    fclose(fp);
+
+    input->replay_next = 0;
+
+    printf("Replaying %llu input events from %s\n",
+           (u64)darray_length(input->replay_events),
+           file_name);
+    return true;
+}
+
+u64 input_replay_tick_count(const struct input *input) {
+    u64 count = input->replay_events ? darray_length(input->replay_events) : 0;
+    return count > 0 ? (u64)input->replay_events[count - 1].tick + 1 : 0;
+}
+
+f32 input_update(struct input *input, u64 tick, f32 delta_time) {
+    input->tick = tick;
+
+    memset(input->state.keys_pressed, 0, sizeof(input->state.keys_pressed));
+    input->state.cursor_delta_x = 0.0f;
+    input->state.cursor_delta_y = 0.0f;
+
+    // NOTE: Events are still polled while replaying so the window stays responsive, but the
+    // callbacks drop them.
+    if (input->window) {
+        glfwPollEvents();
+    }
+
+    if (input->replay_events) {
+        u64 count = darray_length(input->replay_events);
+        while (input->replay_next < count &&
+               input->replay_events[input->replay_next].tick <= tick) {
+            const input_event *event = &input->replay_events[input->replay_next++];
+            if (event->type == INPUT_EVENT_STEP) {
+                delta_time = event->step;
+            } else {
+                apply_event(&input->state, event);
+            }
+        }
+
+        return delta_time;
+    }
+
+    if (input->recording) {
+        input_event step = {
+            .type = INPUT_EVENT_STEP,
+            .tick = (u32)tick,
+            .step = delta_time,
+        };
+        fwrite(&step, sizeof(step), 1, input->recording);
+    }
+
+    return delta_time;
+}
+
+const input_state *input_get_state(const struct input *input) { return &input->state; }
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    (void)scancode;
+    (void)mods;
+
+    // NOTE: Repeats do not change which keys are down.
+    if (key < 0 || key >= INPUT_KEY_COUNT || action == GLFW_REPEAT) {
+        return;
+    }
+
+    input_event event = {
+        .type = INPUT_EVENT_KEY,
+        .key =
+            {
+                .key = (i16)key,
+                .action = (u8)action,
+            },
+    };
+    submit_event(glfwGetWindowUserPointer(window), &event);
+}
+
+static void cursor_position_callback(GLFWwindow *window, double x_position, double y_position) {
+    input_event event = {
+        .type = INPUT_EVENT_CURSOR,
+        .cursor =
+            {
+                .x = (f32)x_position,
+                .y = (f32)y_position,
+            },
+    };
+    submit_event(glfwGetWindowUserPointer(window), &event);
+}
+
+static void submit_event(struct input *input, const input_event *event) {
+    if (input == NULL || input->replay_events) {
+        return;
+    }
+
+    input_event stamped = *event;
+    stamped.tick = (u32)input->tick;
+
+    if (input->recording) {
+        fwrite(&stamped, sizeof(stamped), 1, input->recording);
+    }
+
+    apply_event(&input->state, &stamped);
+}
+
+static void apply_event(input_state *state, const input_event *event) {
+    switch (event->type) {
+    case INPUT_EVENT_KEY:
+        if (event->key.key < 0 || event->key.key >= INPUT_KEY_COUNT) {
+            break;
+        }
+
+        if (event->key.action == GLFW_PRESS) {
+            if (!state->keys_down[event->key.key]) {
+                state->keys_pressed[event->key.key] = true;
+            }
+            state->keys_down[event->key.key] = true;
+        } else {
+            state->keys_down[event->key.key] = false;
+        }
+        break;
+    case INPUT_EVENT_CURSOR:
+        if (state->has_cursor) {
+            state->cursor_delta_x += event->cursor.x - state->cursor_x;
+            state->cursor_delta_y += event->cursor.y - state->cursor_y;
+        }
+        state->has_cursor = true;
+        state->cursor_x = event->cursor.x;
+        state->cursor_y = event->cursor.y;
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "defines.h"
+
+#define INPUT_KEY_COUNT (GLFW_KEY_LAST + 1)
+
+typedef struct {
+    b8 keys_down[INPUT_KEY_COUNT];
+    // NOTE: Keys that went down during the current tick.
+    b8 keys_pressed[INPUT_KEY_COUNT];
+
+    // NOTE: False until the first cursor event, which sets the position without moving it.
+    b8 has_cursor;
+    f32 cursor_x;
+    f32 cursor_y;
+    f32 cursor_delta_x;
+    f32 cursor_delta_y;
+} input_state;
+
+/**
+ * Collects the window's key and cursor events into a state that changes once per simulation
+ * tick. Every event goes through the same path whether it came from GLFW or from a replayed log,
+ * so a replay drives the simulation with exactly the input it had when recording. The window may
+ * be NULL for headless replays. Belongs to the thread that polls the window's events.
+ */
+struct input *input_create(GLFWwindow *window);
+void input_destroy(struct input *input);
+
+/**
+ * Logs every event and every tick's time step to file_name until the input is destroyed. The log
+ * is a small header followed by fixed-size records in host byte order.
+ */
+b8 input_start_recording(struct input *input, const char *file_name);
+
+/**
+ * Replaces the window's events with the ones logged in file_name, each applied at the tick it
+ * was recorded at.
+ */
+b8 input_start_replay(struct input *input, const char *file_name);
+u64 input_replay_tick_count(const struct input *input);
+
+/**
+ * Polls the window and applies the events of this tick.
+ * @returns the time step the tick should simulate: delta_time, or the recorded one when replaying.
+ */
+f32 input_update(struct input *input, u64 tick, f32 delta_time);
+
+const input_state *input_get_state(const struct input *input);
+
+#endif // INPUT_H
@@ -0,0 +1,731 @@
+#include "job.h"
+
+#include "darray.h"
+#include "profiler.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#define JOB_DEQUE_CAPACITY 4096
+#define JOB_DEQUE_MASK (JOB_DEQUE_CAPACITY - 1)
+
+typedef struct {
+    job_fn function;
+    void *data;
+    job_counter *counter;
+} queued_job;
+
+typedef struct {
+    job_counter *dependency;
+    queued_job job;
+} deferred_job;
+
+typedef struct {
+    ucontext_t context;
+    void *stack;
+
+    queued_job job;
+    // NOTE: Set by the fiber right before it switches away, and read by the thread it switched to
+    // once the fiber's context is fully saved.
+    job_counter *waiting_on;
+    b8 finished;
+} job_fiber;
+
+typedef struct {
+    job_counter *counter;
+    job_fiber *fiber;
+} waiting_fiber;
+
+typedef struct {
+    pthread_t handle;
+
+    // NOTE: The thread's own stack, which every fiber running on it switches back to.
+    ucontext_t context;
+    job_fiber *fiber;
+} job_thread;
+
+/**
+ * Chase-Lev work-stealing deque. The owning thread pushes and pops at the bottom, every other
+ * thread steals from the top.
+ */
+typedef struct {
+    atomic_llong top;
+    atomic_llong bottom;
+    queued_job jobs[JOB_DEQUE_CAPACITY];
+} job_deque;
+
+typedef struct {
+    u32 thread_count;
+    job_thread *threads;
+    job_deque *deques;
+
+    u32 fiber_count;
+    job_fiber *fibers;
+    u64 fiber_stack_size;
+    pthread_mutex_t fiber_mutex;
+    job_fiber **free_fibers;  // darray
+    job_fiber **ready_fibers; // darray
+
+    // NOTE: Jobs scheduled from threads that do not belong to the job system.
+    pthread_mutex_t injected_mutex;
+    queued_job *injected_jobs; // darray
+
+    pthread_mutex_t main_thread_mutex;
+    queued_job *main_thread_jobs; // darray
+
+    pthread_mutex_t deferred_mutex;
+    deferred_job *deferred_jobs;   // darray
+    waiting_fiber *waiting_fibers; // darray
+
+    atomic_uint pending;
+    pthread_mutex_t sleep_mutex;
+    pthread_cond_t sleep_condition;
+    atomic_bool shutting_down;
+} job_system;
+
+static job_system scheduler;
+static _Thread_local u32 current_thread_index = JOB_NO_THREAD;
+
+static void *worker_main(void *index);
+static b8 run_next(u32 thread_index);
+static void schedule(const queued_job *job);
+static b8 find_job(u32 thread_index, queued_job *out_job);
+static b8 pop_locked_queue(pthread_mutex_t *mutex, queued_job *queue, queued_job *out_job);
+static void start(const queued_job *job, u32 thread_index);
+static void execute(const queued_job *job);
+static job_thread *this_thread(void);
+static void create_fiber(job_fiber *fiber);
+static void fiber_main(void);
+static void fiber_wait(job_counter *counter);
+static void resume_fiber(job_fiber *fiber);
+static void park_fiber(job_fiber *fiber);
+static void make_fiber_ready(job_fiber *fiber);
+static void release_dependents(job_counter *counter);
+static void wake_workers(u32 count);
+static b8 deque_push(job_deque *deque, const queued_job *job);
+static b8 deque_pop(job_deque *deque, queued_job *out_job);
+static b8 deque_steal(job_deque *deque, queued_job *out_job);
+static void parallel_for_job(void *data);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+void job_system_init(u32 worker_count, u32 fiber_count) {
+    scheduler.thread_count = worker_count + 1;
+    scheduler.threads = calloc(scheduler.thread_count, sizeof(job_thread));
+    scheduler.deques = calloc(scheduler.thread_count, sizeof(job_deque));
+
+    // NOTE: Every stack is allocated up front, so starting a job never allocates.
+    scheduler.fiber_count = fiber_count;
+    scheduler.fibers = fiber_count != 0 ? calloc(fiber_count, sizeof(job_fiber)) : NULL;
+    scheduler.fiber_stack_size = JOB_FIBER_STACK_SIZE;
+    pthread_mutex_init(&scheduler.fiber_mutex, NULL);
+    scheduler.free_fibers = darray_create(job_fiber *);
+    scheduler.ready_fibers = darray_create(job_fiber *);
+    for (u32 i = 0; i < fiber_count; i++) {
+        job_fiber *fiber = &scheduler.fibers[i];
+        create_fiber(fiber);
+        darray_push(scheduler.free_fibers, fiber);
+    }
+
+    pthread_mutex_init(&scheduler.injected_mutex, NULL);
+    scheduler.injected_jobs = darray_create(queued_job);
+    pthread_mutex_init(&scheduler.main_thread_mutex, NULL);
+    scheduler.main_thread_jobs = darray_create(queued_job);
+    pthread_mutex_init(&scheduler.deferred_mutex, NULL);
+    scheduler.deferred_jobs = darray_create(deferred_job);
+    scheduler.waiting_fibers = darray_create(waiting_fiber);
+
+    atomic_init(&scheduler.pending, 0);
+    pthread_mutex_init(&scheduler.sleep_mutex, NULL);
+    pthread_cond_init(&scheduler.sleep_condition, NULL);
+    atomic_init(&scheduler.shutting_down, false);
+
+    current_thread_index = 0;
+
+    for (u64 i = 1; i < scheduler.thread_count; i++) {
+        if (pthread_create(&scheduler.threads[i].handle, NULL, worker_main, (void *)i) != 0) {
+            fprintf(stderr, "Failed to create job worker thread!\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    printf("Job system started with %u workers and %u fibers.\n", worker_count, fiber_count);
+}
+
+void job_system_shutdown(void) {
+    atomic_store(&scheduler.shutting_down, true);
+
+    pthread_mutex_lock(&scheduler.sleep_mutex);
+    pthread_cond_broadcast(&scheduler.sleep_condition);
+    pthread_mutex_unlock(&scheduler.sleep_mutex);
+
+    for (u32 i = 1; i < scheduler.thread_count; i++) {
+        pthread_join(scheduler.threads[i].handle, NULL);
+    }
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    for (u32 i = 0; i < scheduler.fiber_count; i++) {
+        munmap(scheduler.fibers[i].stack, scheduler.fiber_stack_size + page_size);
+    }
+
+    darray_destroy(scheduler.ready_fibers);
+    darray_destroy(scheduler.free_fibers);
+    darray_destroy(scheduler.waiting_fibers);
+    darray_destroy(scheduler.deferred_jobs);
+    darray_destroy(scheduler.main_thread_jobs);
+    darray_destroy(scheduler.injected_jobs);
+
+    pthread_cond_destroy(&scheduler.sleep_condition);
+    pthread_mutex_destroy(&scheduler.sleep_mutex);
+    pthread_mutex_destroy(&scheduler.deferred_mutex);
+    pthread_mutex_destroy(&scheduler.main_thread_mutex);
+    pthread_mutex_destroy(&scheduler.injected_mutex);
+    pthread_mutex_destroy(&scheduler.fiber_mutex);
+
+    free(scheduler.fibers);
+    free(scheduler.deques);
+    free(scheduler.threads);
+
+    scheduler = (job_system){0};
+    current_thread_index = JOB_NO_THREAD;
+}
+
+u32 job_default_worker_count(void) {
+    i64 cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpu_count > 1 ? cpu_count - 1 : 0;
+}
+
+u32 job_system_thread_count(void) { return scheduler.thread_count; }
+
+/**
+ * @returns 0 on the main thread, 1 to the worker count on workers and JOB_NO_THREAD on threads
+ * that do not belong to the job system. A job running on a fiber may resume on another thread
+ * after job_wait, so the index is only stable between waits.
+ */
+u32 job_thread_index(void) { return current_thread_index; }
+
+void job_run(const job *jobs, u32 count, job_counter *counter) {
+    if (counter != NULL) {
+        atomic_fetch_add(&counter->value, count);
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        queued_job queued = {
+            .function = jobs[i].function,
+            .data = jobs[i].data,
+            .counter = counter,
+        };
+        schedule(&queued);
+    }
+}
+
+/**
+ * Schedules the jobs once the dependency counter reaches zero. The counter is incremented right
+ * away, so waiting on it also waits for the dependency.
+ */
+void job_run_after(const job *jobs, u32 count, job_counter *counter, job_counter *dependency) {
+    if (counter != NULL) {
+        atomic_fetch_add(&counter->value, count);
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        queued_job queued = {
+            .function = jobs[i].function,
+            .data = jobs[i].data,
+            .counter = counter,
+        };
+
+        // NOTE: Checked under the lock release_dependents takes, so a dependency that finishes
+        // concurrently either sees this job or this job sees it finished.
+        pthread_mutex_lock(&scheduler.deferred_mutex);
+        b8 ready = atomic_load(&dependency->value) == 0;
+        if (!ready) {
+            deferred_job deferred = {
+                .dependency = dependency,
+                .job = queued,
+            };
+            darray_push(scheduler.deferred_jobs, deferred);
+        }
+        pthread_mutex_unlock(&scheduler.deferred_mutex);
+
+        if (ready) {
+            schedule(&queued);
+        }
+    }
+}
+
+/**
+ * For work that has to happen on the main thread, such as GLFW calls. These jobs run when the
+ * main thread waits on a counter or calls job_pump_main_thread.
+ */
+void job_run_on_main_thread(const job *jobs, u32 count, job_counter *counter) {
+    if (counter != NULL) {
+        atomic_fetch_add(&counter->value, count);
+    }
+
+    pthread_mutex_lock(&scheduler.main_thread_mutex);
+    for (u32 i = 0; i < count; i++) {
+        queued_job queued = {
+            .function = jobs[i].function,
+            .data = jobs[i].data,
+            .counter = counter,
+        };
+        darray_push(scheduler.main_thread_jobs, queued);
+    }
+    pthread_mutex_unlock(&scheduler.main_thread_mutex);
+}
+
+/**
+ * Inside a job running on a fiber, suspends the fiber until the counter reaches zero and lets
+ * its thread pick up other work. Everywhere else, runs other jobs on the calling stack until the
+ * counter reaches zero instead of blocking the thread.
+ */
+void job_wait(job_counter *counter) {
+    if (current_thread_index != JOB_NO_THREAD && this_thread()->fiber != NULL) {
+        while (atomic_load(&counter->value) != 0) {
+            fiber_wait(counter);
+        }
+        return;
+    }
+
+    while (atomic_load(&counter->value) != 0) {
+        if (!run_next(current_thread_index)) {
+            sched_yield();
+        }
+    }
+}
+
+/**
+ * Main-thread jobs always run on the main thread's own stack, never on a fiber, since a fiber
+ * could resume on another thread after a wait.
+ */
+void job_pump_main_thread(void) {
+    queued_job job;
+    while (pop_locked_queue(&scheduler.main_thread_mutex, scheduler.main_thread_jobs, &job)) {
+        execute(&job);
+    }
+}
+
+typedef struct {
+    parallel_for_fn function;
+    void *data;
+    u32 start;
+    u32 end;
+} parallel_for_batch;
+
+/**
+ * Splits [0, count) into batches of batch_size indices and returns once all of them ran. A batch
+ * size of 0 picks one that gives every thread a few batches.
+ */
+void job_parallel_for(u32 count, u32 batch_size, parallel_for_fn function, void *data) {
+    if (count == 0) {
+        return;
+    }
+
+    if (batch_size == 0) {
+        batch_size = count / (scheduler.thread_count * 4);
+        if (batch_size == 0) {
+            batch_size = 1;
+        }
+    }
+
+    u32 batch_count = (count + batch_size - 1) / batch_size;
+
+    parallel_for_batch batches[batch_count];
+    job jobs[batch_count];
+
+    for (u32 i = 0; i < batch_count; i++) {
+        batches[i] = (parallel_for_batch){
+            .function = function,
+            .data = data,
+            .start = i * batch_size,
+            .end = (i + 1) * batch_size < count ? (i + 1) * batch_size : count,
+        };
+        jobs[i] = (job){
+            .function = parallel_for_job,
+            .data = &batches[i],
+        };
+    }
+
+    job_counter counter = {0};
+    job_run(jobs, batch_count, &counter);
+    job_wait(&counter);
+}
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+static void *worker_main(void *index) {
+    current_thread_index = (u32)(u64)index;
+    PROFILE_THREAD_NAME("worker");
+
+    while (!atomic_load(&scheduler.shutting_down)) {
+        if (run_next(current_thread_index)) {
+            continue;
+        }
+
+        pthread_mutex_lock(&scheduler.sleep_mutex);
+        while (atomic_load(&scheduler.pending) == 0 && !atomic_load(&scheduler.shutting_down)) {
+            pthread_cond_wait(&scheduler.sleep_condition, &scheduler.sleep_mutex);
+        }
+        pthread_mutex_unlock(&scheduler.sleep_mutex);
+    }
+
+    return NULL;
+}
+
+/**
+ * Runs one unit of work: a main-thread job (main thread only), then a fiber whose wait has
+ * finished, then a new job.
+ */
+static b8 run_next(u32 thread_index) {
+    queued_job job;
+
+    if (thread_index == 0 &&
+        pop_locked_queue(&scheduler.main_thread_mutex, scheduler.main_thread_jobs, &job)) {
+        execute(&job);
+        return true;
+    }
+
+    if (thread_index != JOB_NO_THREAD && scheduler.fiber_count != 0) {
+        job_fiber *fiber = NULL;
+
+        pthread_mutex_lock(&scheduler.fiber_mutex);
+        if (darray_length(scheduler.ready_fibers) != 0) {
+            darray_pop_front(scheduler.ready_fibers, &fiber);
+        }
+        pthread_mutex_unlock(&scheduler.fiber_mutex);
+
+        if (fiber != NULL) {
+            atomic_fetch_sub(&scheduler.pending, 1);
+            resume_fiber(fiber);
+            return true;
+        }
+    }
+
+    if (find_job(thread_index, &job)) {
+        start(&job, thread_index);
+        return true;
+    }
+
+    return false;
+}
+
+static void schedule(const queued_job *job) {
+    b8 queued;
+
+    if (current_thread_index != JOB_NO_THREAD) {
+        queued = deque_push(&scheduler.deques[current_thread_index], job);
+    } else {
+        pthread_mutex_lock(&scheduler.injected_mutex);
+        darray_push(scheduler.injected_jobs, *job);
+        pthread_mutex_unlock(&scheduler.injected_mutex);
+        queued = true;
+    }
+
+    // NOTE: A full deque means plenty of queued work, so the job simply runs right here.
+    if (!queued) {
+        execute(job);
+        return;
+    }
+
+    atomic_fetch_add(&scheduler.pending, 1);
+    wake_workers(1);
+}
+
+/**
+ * Looks for work in order of locality: the thread's own deque, jobs injected from outside, then
+ * the other deques.
+ */
+static b8 find_job(u32 thread_index, queued_job *out_job) {
+    if (thread_index != JOB_NO_THREAD && deque_pop(&scheduler.deques[thread_index], out_job)) {
+        atomic_fetch_sub(&scheduler.pending, 1);
+        return true;
+    }
+
+    if (pop_locked_queue(&scheduler.injected_mutex, scheduler.injected_jobs, out_job)) {
+        atomic_fetch_sub(&scheduler.pending, 1);
+        return true;
+    }
+
+    u32 start = thread_index != JOB_NO_THREAD ? thread_index + 1 : 0;
+    for (u32 i = 0; i < scheduler.thread_count; i++) {
+        u32 victim = (start + i) % scheduler.thread_count;
+        if (victim != thread_index && deque_steal(&scheduler.deques[victim], out_job)) {
+            atomic_fetch_sub(&scheduler.pending, 1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static b8 pop_locked_queue(pthread_mutex_t *mutex, queued_job *queue, queued_job *out_job) {
+    b8 found = false;
+
+    pthread_mutex_lock(mutex);
+    if (darray_length(queue) != 0) {
+        darray_pop(queue, out_job);
+        found = true;
+    }
+    pthread_mutex_unlock(mutex);
+
+    return found;
+}
+
+/**
+ * Runs a job on a free fiber when there is one. Once every fiber is busy, or on threads outside
+ * the job system, the job runs on the calling stack and its waits fall back to helping.
+ */
+static void start(const queued_job *job, u32 thread_index) {
+    job_fiber *fiber = NULL;
+
+    if (thread_index != JOB_NO_THREAD && scheduler.fiber_count != 0) {
+        pthread_mutex_lock(&scheduler.fiber_mutex);
+        if (darray_length(scheduler.free_fibers) != 0) {
+            darray_pop(scheduler.free_fibers, &fiber);
+        }
+        pthread_mutex_unlock(&scheduler.fiber_mutex);
+    }
+
+    if (fiber == NULL) {
+        execute(job);
+        return;
+    }
+
+    fiber->job = *job;
+    fiber->finished = false;
+    resume_fiber(fiber);
+}
+
+static void execute(const queued_job *job) {
+    job->function(job->data);
+
+    if (job->counter != NULL && atomic_fetch_sub(&job->counter->value, 1) == 1) {
+        release_dependents(job->counter);
+    }
+}
+
+static void release_dependents(job_counter *counter) {
+    pthread_mutex_lock(&scheduler.deferred_mutex);
+    u32 length = darray_length(scheduler.deferred_jobs);
+    queued_job ready[length ? length : 1];
+    u32 ready_count = 0;
+    for (u32 i = 0; i < darray_length(scheduler.deferred_jobs);) {
+        if (scheduler.deferred_jobs[i].dependency == counter) {
+            ready[ready_count++] = scheduler.deferred_jobs[i].job;
+            darray_pop_at(scheduler.deferred_jobs, i, NULL);
+        } else {
+            i++;
+        }
+    }
+    pthread_mutex_unlock(&scheduler.deferred_mutex);
+
+    for (u32 i = 0; i < ready_count; i++) {
+        schedule(&ready[i]);
+    }
+
+    if (scheduler.fiber_count == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&scheduler.deferred_mutex);
+    u32 waiting_length = darray_length(scheduler.waiting_fibers);
+    job_fiber *resumable[waiting_length ? waiting_length : 1];
+    u32 resumable_count = 0;
+    for (u32 i = 0; i < darray_length(scheduler.waiting_fibers);) {
+        if (scheduler.waiting_fibers[i].counter == counter) {
+            resumable[resumable_count++] = scheduler.waiting_fibers[i].fiber;
+            darray_pop_at(scheduler.waiting_fibers, i, NULL);
+        } else {
+            i++;
+        }
+    }
+    pthread_mutex_unlock(&scheduler.deferred_mutex);
+
+    for (u32 i = 0; i < resumable_count; i++) {
+        make_fiber_ready(resumable[i]);
+    }
+}
+
+// NOTE: Never inlined, so a fiber that resumed on another thread reads that thread's index
+// instead of a thread-local address the compiler cached from before the switch.
+__attribute__((noinline)) static job_thread *this_thread(void) {
+    return &scheduler.threads[current_thread_index];
+}
+
+static void create_fiber(job_fiber *fiber) {
+    // NOTE: The lowest page is left inaccessible so a stack overflow faults instead of silently
+    // corrupting the neighbouring stack.
+    long page_size = sysconf(_SC_PAGESIZE);
+    fiber->stack = mmap(NULL,
+                        scheduler.fiber_stack_size + page_size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK,
+                        -1,
+                        0);
+    if (fiber->stack == MAP_FAILED || mprotect(fiber->stack, page_size, PROT_NONE) != 0) {
+        fprintf(stderr, "Failed to allocate a fiber stack!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    getcontext(&fiber->context);
+    fiber->context.uc_stack.ss_sp = (u8 *)fiber->stack + page_size;
+    fiber->context.uc_stack.ss_size = scheduler.fiber_stack_size;
+    fiber->context.uc_link = NULL;
+    makecontext(&fiber->context, fiber_main, 0);
+}
+
+/**
+ * Every fiber loops here forever: it runs the job it was handed, then switches back to whichever
+ * thread it finished on, which returns it to the free list.
+ */
+static void fiber_main(void) {
+    for (;;) {
+        job_fiber *fiber = this_thread()->fiber;
+        execute(&fiber->job);
+
+        fiber->finished = true;
+        swapcontext(&fiber->context, &this_thread()->context);
+    }
+}
+
+static void fiber_wait(job_counter *counter) {
+    job_thread *thread = this_thread();
+    job_fiber *fiber = thread->fiber;
+
+    fiber->waiting_on = counter;
+    swapcontext(&fiber->context, &thread->context);
+}
+
+static void resume_fiber(job_fiber *fiber) {
+    job_thread *thread = this_thread();
+
+    thread->fiber = fiber;
+    swapcontext(&thread->context, &fiber->context);
+    thread->fiber = NULL;
+
+    if (fiber->finished) {
+        pthread_mutex_lock(&scheduler.fiber_mutex);
+        darray_push(scheduler.free_fibers, fiber);
+        pthread_mutex_unlock(&scheduler.fiber_mutex);
+    } else if (fiber->waiting_on != NULL) {
+        park_fiber(fiber);
+    }
+}
+
+/**
+ * Registers a fiber that switched away inside job_wait. Like job_run_after, the counter is checked
+ * under the lock release_dependents takes, so a wait that finished in between is not lost.
+ */
+static void park_fiber(job_fiber *fiber) {
+    job_counter *counter = fiber->waiting_on;
+    fiber->waiting_on = NULL;
+
+    pthread_mutex_lock(&scheduler.deferred_mutex);
+    b8 ready = atomic_load(&counter->value) == 0;
+    if (!ready) {
+        waiting_fiber waiting = {
+            .counter = counter,
+            .fiber = fiber,
+        };
+        darray_push(scheduler.waiting_fibers, waiting);
+    }
+    pthread_mutex_unlock(&scheduler.deferred_mutex);
+
+    if (ready) {
+        make_fiber_ready(fiber);
+    }
+}
+
+static void make_fiber_ready(job_fiber *fiber) {
+    pthread_mutex_lock(&scheduler.fiber_mutex);
+    darray_push(scheduler.ready_fibers, fiber);
+    pthread_mutex_unlock(&scheduler.fiber_mutex);
+
+    atomic_fetch_add(&scheduler.pending, 1);
+    wake_workers(1);
+}
+
+static void wake_workers(u32 count) {
+    pthread_mutex_lock(&scheduler.sleep_mutex);
+    if (count == 1) {
+        pthread_cond_signal(&scheduler.sleep_condition);
+    } else {
+        pthread_cond_broadcast(&scheduler.sleep_condition);
+    }
+    pthread_mutex_unlock(&scheduler.sleep_mutex);
+}
+
+static b8 deque_push(job_deque *deque, const queued_job *job) {
+    i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    i64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+    if (bottom - top >= JOB_DEQUE_CAPACITY) {
+        return false;
+    }
+
+    deque->jobs[bottom & JOB_DEQUE_MASK] = *job;
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+
+    return true;
+}
+
+static b8 deque_pop(job_deque *deque, queued_job *out_job) {
+    i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    i64 top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return false;
+    }
+
+    *out_job = deque->jobs[bottom & JOB_DEQUE_MASK];
+
+    if (top == bottom) {
+        // NOTE: Last job; race the thieves for it.
+        b8 won = atomic_compare_exchange_strong_explicit(&deque->top,
+                                                         &top,
+                                                         top + 1,
+                                                         memory_order_seq_cst,
+                                                         memory_order_relaxed);
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return won;
+    }
+
+    return true;
+}
+
+static b8 deque_steal(job_deque *deque, queued_job *out_job) {
+    i64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom) {
+        return false;
+    }
+
+    *out_job = deque->jobs[top & JOB_DEQUE_MASK];
+
+    return atomic_compare_exchange_strong_explicit(&deque->top,
+                                                   &top,
+                                                   top + 1,
+                                                   memory_order_seq_cst,
+                                                   memory_order_relaxed);
+}
+
+static void parallel_for_job(void *data) {
+    parallel_for_batch *batch = data;
+    batch->function(batch->start, batch->end, batch->data);
+}
@@ -0,0 +1,50 @@
+#ifndef JOB_H
+#define JOB_H
+
+#include "defines.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define JOB_NO_THREAD UINT32_MAX
+#define JOB_DEFAULT_FIBER_COUNT 128
+#define JOB_FIBER_STACK_SIZE (256 * 1024)
+
+typedef void (*job_fn)(void *data);
+typedef void (*parallel_for_fn)(u32 start, u32 end, void *data);
+
+/**
+ * Counts the unfinished jobs scheduled against it. Zero-initialize before first use; a counter
+ * may be reused once it has reached zero.
+ */
+typedef struct {
+    atomic_uint value;
+} job_counter;
+
+typedef struct {
+    job_fn function;
+    void *data;
+} job;
+
+/**
+ * Must be called from the main thread, which becomes thread 0 of the job system. A worker count
+ * of 0 runs every job on the main thread while it waits. With a fiber count of 0 every job runs
+ * on its thread's own stack and job_wait helps run other jobs until the counter is done.
+ */
+void job_system_init(u32 worker_count, u32 fiber_count);
+void job_system_shutdown(void);
+
+u32 job_default_worker_count(void);
+u32 job_system_thread_count(void);
+u32 job_thread_index(void);
+
+void job_run(const job *jobs, u32 count, job_counter *counter);
+void job_run_after(const job *jobs, u32 count, job_counter *counter, job_counter *dependency);
+void job_run_on_main_thread(const job *jobs, u32 count, job_counter *counter);
+
+void job_wait(job_counter *counter);
+void job_pump_main_thread(void);
+
+void job_parallel_for(u32 count, u32 batch_size, parallel_for_fn function, void *data);
+
+#endif // JOB_H
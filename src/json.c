@@ -308,15 +308,13 @@ static json_value *json_parse_impl(parse_state *state, json_value *parent) {
             decimal_part += (state->json[i] - '0') * exponent;
         }
 
-        if (is_negative)
-            decimal_part *= -1;
-
         if ((current(state) != '.') && (current(state) != 'e') && (current(state) != 'E')) {
             value->type = JSON_VALUE_INTEGER;
-            value->u.integer = decimal_part;
+            value->u.integer = is_negative ? -decimal_part : decimal_part;
             return value;
         }
 
+        // NOTE: The sign is applied last, the fraction adds to the magnitude.
         f64 number = (f64)decimal_part;
 
         if (current(state) == '.') {
@@ -373,7 +371,7 @@ static json_value *json_parse_impl(parse_state *state, json_value *parent) {
         }
 
         value->type = JSON_VALUE_NUMBER;
-        value->u.number = number;
+        value->u.number = is_negative ? -number : number;
     } else if (current_char == 't') {
         next(state);
         if (assert_current(state, 'r') && assert_current(state, 'u') &&
@@ -1,20 +1,42 @@
+#include "bindless.h"
 #include "camera.h"
+#include "camera_path.h"
+#include "config.h"
 #include "context.h"
 #include "darray.h"
 #include "defines.h"
+#include "draw_list.h"
 #include "font.h"
+#include "frame_stats.h"
+#include "frame_packet.h"
+#include "geometry_arena.h"
 #include "gltf.h"
+#include "gpu_profiler.h"
+#include "input.h"
+#include "job.h"
 #include "pipeline.h"
+#include "profiler.h"
+#include "resource_registry.h"
+#include "timer.h"
 #include "types.h"
 
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define WIDTH 1280
-#define HEIGHT 720
+// NOTE: Headless runs have no window to close, so they stop after this many frames by default.
+#define HEADLESS_DEFAULT_FRAME_COUNT 1000
+// NOTE: Where F9 writes the CPU profiling zones when no cpu-trace file is configured.
+#define DEFAULT_CPU_TRACE_FILE_NAME "cpu_trace.json"
+// NOTE: Where F10 writes the frame statistics when no frame-report file is configured.
+#define DEFAULT_FRAME_REPORT_FILE_NAME "frame_report.json"
+// NOTE: Frames the frame statistics keep for percentiles and reports.
+#define FRAME_STATS_HISTORY 8192
 
 typedef struct {
     vec2s aa;
@@ -31,6 +53,7 @@ typedef struct {
 
 typedef struct {
     Mesh mesh;
+    geometry_range geometry;
     i32 resolution;
     vec3s local_up;
     vec3s axis_a;
@@ -39,6 +62,46 @@ typedef struct {
 
 #define FACES_PER_PLANET 6
 
+#define GEOMETRY_ARENA_VERTEX_CAPACITY (1 << 20)
+#define GEOMETRY_ARENA_INDEX_CAPACITY (1 << 22)
+#define MAX_DRAWS_PER_FRAME (1 << 16)
+#define MAX_PACKET_DRAWS 1024
+
+typedef struct {
+    vec4s color;
+} DrawData;
+
+// NOTE: Matches the push constant block in simple.vert.
+typedef struct {
+    u32 draw_data;
+} PlanetIndices;
+
+typedef struct {
+    geometry_range geometry;
+    DrawData draw_data;
+} PacketDraw;
+
+/**
+ * Everything the render thread needs to draw one simulation tick. Filled by the simulation thread
+ * and never modified once published.
+ */
+typedef struct {
+    u64 tick;
+    // NOTE: Turned into matrices right before the frame is submitted, see latch_camera.
+    Camera camera;
+    // NOTE: timer_now_ns when the input the camera follows was sampled.
+    u64 input_ns;
+    u32 draw_count;
+    PacketDraw draws[MAX_PACKET_DRAWS];
+} FramePacket;
+
+enum {
+    PIPELINE_TEXT,
+    PIPELINE_UI,
+    PIPELINE_PLANET,
+    PIPELINE_COUNT,
+};
+
 typedef struct {
     TerrainFace terrain_faces[FACES_PER_PLANET];
 } Planet;
@@ -118,13 +181,17 @@ static Planet create_planet(void) {
     return planet;
 }
 
-static void planet_generate_meshes(Planet *planet) {
-    for (int i = 0; i < FACES_PER_PLANET; i++) {
-        terrain_face_construct_mesh(&planet->terrain_faces[i]);
+static void planet_construct_faces(u32 start, u32 end, void *planet) {
+    for (u32 i = start; i < end; i++) {
+        terrain_face_construct_mesh(&((Planet *)planet)->terrain_faces[i]);
     }
 }
 
-static GLFWwindow *create_window(void) {
+static void planet_generate_meshes(Planet *planet) {
+    job_parallel_for(FACES_PER_PLANET, 1, planet_construct_faces, planet);
+}
+
+static GLFWwindow *create_window(u32 width, u32 height) {
     if (glfwInit() != GLFW_TRUE) {
         fprintf(stderr, "Failed to initialize GLFW!\n");
         exit(EXIT_FAILURE);
@@ -132,22 +199,20 @@ static GLFWwindow *create_window(void) {
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
-    GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "game", NULL, NULL);
+    GLFWwindow *window = glfwCreateWindow(width, height, "game", NULL, NULL);
 
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    glfwSetCursorPosCallback(window, camera_mouse_callback);
 
     return window;
 }
 
 typedef struct {
-    pipeline pipeline;
+    pipeline_handle pipeline;
 
-    VkBuffer vertex_buffer;
-    VkDeviceMemory vertex_buffer_memory;
+    buffer_handle vertex_buffer;
 } TextRenderer;
 
-static TextRenderer text_renderer_create(context *context) {
+static pipeline_builder text_renderer_pipeline_builder(context *context) {
     pipeline_builder builder = pipeline_builder_new(context);
     pipeline_builder_set_shaders(&builder, "shaders/text.vert.spv", "shaders/text.frag.spv");
     pipeline_builder_add_input_binding(&builder, 0, sizeof(vec2s) * 2, VK_VERTEX_INPUT_RATE_VERTEX);
@@ -156,46 +221,35 @@ static TextRenderer text_renderer_create(context *context) {
     pipeline_builder_set_cull_mode(&builder, VK_CULL_MODE_NONE);
     pipeline_builder_set_alpha_blending(&builder, true);
 
+    return builder;
+}
+
+static TextRenderer text_renderer_create(pipeline_handle text_pipeline) {
     return (TextRenderer){
-        .pipeline = pipeline_builder_build(&builder, context->render_pass),
+        .pipeline = text_pipeline,
     };
 }
 
-static void text_renderer_destroy(TextRenderer *renderer, device *render_device) {
-    vkDestroyBuffer(render_device->logical_device, renderer->vertex_buffer, NULL);
-    vkFreeMemory(render_device->logical_device, renderer->vertex_buffer_memory, NULL);
-
-    pipeline_destroy(&renderer->pipeline, render_device);
+static void text_renderer_destroy(TextRenderer *renderer, context *render_context) {
+    resource_destroy_buffer(render_context, renderer->vertex_buffer);
+    resource_destroy_pipeline(render_context, renderer->pipeline);
 }
 
 static void text_renderer_setup_buffers(TextRenderer *renderer, context *render_context) {
     VkDeviceSize vertex_buffer_size = sizeof(vec2s) * 2 * 3;
 
-    VkBuffer vertex_staging_buffer;
-    VkDeviceMemory vertex_staging_buffer_memory;
-
-    context_create_buffer(render_context,
-                          vertex_buffer_size,
-                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                          &vertex_staging_buffer,
-                          &vertex_staging_buffer_memory);
-
-    context_create_buffer(render_context,
-                          vertex_buffer_size,
-                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                          &renderer->vertex_buffer,
-                          &renderer->vertex_buffer_memory);
-
-    void *vertex_staging_buffer_memory_mapped;
-    vkMapMemory(render_context->device.logical_device,
-                vertex_staging_buffer_memory,
-                0,
-                vertex_buffer_size,
-                0,
-                &vertex_staging_buffer_memory_mapped);
+    buffer_handle vertex_staging_buffer =
+        resource_create_buffer(render_context,
+                               vertex_buffer_size,
+                               VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    renderer->vertex_buffer =
+        resource_create_buffer(render_context,
+                               vertex_buffer_size,
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
     vec2s buf[] = {
         {{-0.5, 0}},
@@ -206,39 +260,55 @@ static void text_renderer_setup_buffers(TextRenderer *renderer, context *render_
         {{1, 1}},
     };
 
-    memcpy((void *)((u64)vertex_staging_buffer_memory_mapped), buf, sizeof(buf));
+    memcpy(resource_buffer_mapped(render_context->resources, vertex_staging_buffer),
+           buf,
+           sizeof(buf));
 
     context_copy_buffer(render_context,
-                        vertex_staging_buffer,
-                        renderer->vertex_buffer,
+                        resource_buffer(render_context->resources, vertex_staging_buffer),
+                        resource_buffer(render_context->resources, renderer->vertex_buffer),
                         vertex_buffer_size);
 
-    vkDestroyBuffer(render_context->device.logical_device, vertex_staging_buffer, NULL);
-    vkFreeMemory(render_context->device.logical_device, vertex_staging_buffer_memory, NULL);
+    // NOTE: Released once the next frame has finished, which is submitted after the copy.
+    resource_destroy_buffer(render_context, vertex_staging_buffer);
 }
 
 static void text_renderer_render(TextRenderer *renderer,
+                                 const struct resource_registry *resources,
                                  u32 current_frame,
                                  VkCommandBuffer command_buffer) {
-    pipeline_bind(&renderer->pipeline, command_buffer, current_frame);
+    pipeline_bind(resource_pipeline(resources, renderer->pipeline), command_buffer, current_frame);
 
+    VkBuffer vertex_buffer = resource_buffer(resources, renderer->vertex_buffer);
     VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(command_buffer, 0, 1, &renderer->vertex_buffer, offsets);
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer, offsets);
 
     vkCmdDraw(command_buffer, 3, 1, 0, 0);
 }
 
 typedef struct {
-    pipeline rectangle_pipeline;
+    TextRenderer *renderer;
+    const struct resource_registry *resources;
+    u32 current_frame;
+} TextRecording;
+
+static void text_renderer_record(VkCommandBuffer command_buffer, void *user_data) {
+    TextRecording *recording = user_data;
+    text_renderer_render(recording->renderer,
+                         recording->resources,
+                         recording->current_frame,
+                         command_buffer);
+}
+
+typedef struct {
+    pipeline_handle rectangle_pipeline;
     ColoredRectangle *rectangles; // darray
 
-    VkBuffer vertex_buffer;
-    VkDeviceMemory vertex_buffer_memory;
-    VkBuffer instance_buffer;
-    VkDeviceMemory instance_buffer_memory;
+    buffer_handle vertex_buffer;
+    buffer_handle instance_buffer;
 } ColoredRectangleRenderer;
 
-static ColoredRectangleRenderer colored_rectangle_renderer_create(context *render_context) {
+static pipeline_builder colored_rectangle_renderer_pipeline_builder(context *render_context) {
     pipeline_builder ui_pipeline_builder = pipeline_builder_new(render_context);
     pipeline_builder_set_shaders(&ui_pipeline_builder,
                                  "shaders/ui.vert.spv",
@@ -261,24 +331,25 @@ static ColoredRectangleRenderer colored_rectangle_renderer_create(context *rende
     pipeline_builder_set_topology(&ui_pipeline_builder, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP);
     pipeline_builder_set_alpha_blending(&ui_pipeline_builder, true);
 
+    return ui_pipeline_builder;
+}
+
+static ColoredRectangleRenderer
+colored_rectangle_renderer_create(pipeline_handle rectangle_pipeline) {
     return (ColoredRectangleRenderer){
         .rectangles = darray_create(ColoredRectangle),
-        .rectangle_pipeline =
-            pipeline_builder_build(&ui_pipeline_builder, render_context->render_pass),
+        .rectangle_pipeline = rectangle_pipeline,
     };
 }
 
 static void colored_rectangle_renderer_destroy(ColoredRectangleRenderer *renderer,
-                                               device *render_device) {
+                                               context *render_context) {
     darray_destroy(renderer->rectangles);
 
-    vkDestroyBuffer(render_device->logical_device, renderer->vertex_buffer, NULL);
-    vkFreeMemory(render_device->logical_device, renderer->vertex_buffer_memory, NULL);
+    resource_destroy_buffer(render_context, renderer->vertex_buffer);
+    resource_destroy_buffer(render_context, renderer->instance_buffer);
 
-    vkDestroyBuffer(render_device->logical_device, renderer->instance_buffer, NULL);
-    vkFreeMemory(render_device->logical_device, renderer->instance_buffer_memory, NULL);
-
-    pipeline_destroy(&renderer->rectangle_pipeline, render_device);
+    resource_destroy_pipeline(render_context, renderer->rectangle_pipeline);
 }
 
 static void colored_rectangle_renderer_add_rectangle(ColoredRectangleRenderer *renderer,
@@ -294,31 +365,21 @@ static void colored_rectangle_renderer_setup_buffers(ColoredRectangleRenderer *r
     VkDeviceSize vertex_buffer_size = sizeof(vec2s) * 4 * 2 * darray_length(renderer->rectangles);
     VkDeviceSize instance_buffer_size = sizeof(vec3s) * darray_length(renderer->rectangles);
 
-    VkBuffer vertex_staging_buffer;
-    VkDeviceMemory vertex_staging_buffer_memory;
-
-    context_create_buffer(render_context,
-                          vertex_buffer_size,
-                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                          &vertex_staging_buffer,
-                          &vertex_staging_buffer_memory);
-
-    context_create_buffer(render_context,
-                          vertex_buffer_size,
-                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                          &renderer->vertex_buffer,
-                          &renderer->vertex_buffer_memory);
-
-    void *vertex_staging_buffer_memory_mapped;
-    vkMapMemory(render_context->device.logical_device,
-                vertex_staging_buffer_memory,
-                0,
-                vertex_buffer_size,
-                0,
-                &vertex_staging_buffer_memory_mapped);
+    buffer_handle vertex_staging_buffer =
+        resource_create_buffer(render_context,
+                               vertex_buffer_size,
+                               VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    renderer->vertex_buffer =
+        resource_create_buffer(render_context,
+                               vertex_buffer_size,
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    void *vertex_staging_buffer_memory_mapped =
+        resource_buffer_mapped(render_context->resources, vertex_staging_buffer);
 
     for (u32 i = 0; i < darray_length(renderer->rectangles); i++) {
         vec2s buf[] = {
@@ -338,66 +399,99 @@ static void colored_rectangle_renderer_setup_buffers(ColoredRectangleRenderer *r
     }
 
     context_copy_buffer(render_context,
-                        vertex_staging_buffer,
-                        renderer->vertex_buffer,
+                        resource_buffer(render_context->resources, vertex_staging_buffer),
+                        resource_buffer(render_context->resources, renderer->vertex_buffer),
                         vertex_buffer_size);
 
-    vkDestroyBuffer(render_context->device.logical_device, vertex_staging_buffer, NULL);
-    vkFreeMemory(render_context->device.logical_device, vertex_staging_buffer_memory, NULL);
-
-    VkBuffer instance_staging_buffer;
-    VkDeviceMemory instance_staging_buffer_memory;
-
-    context_create_buffer(render_context,
-                          instance_buffer_size,
-                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                          &instance_staging_buffer,
-                          &instance_staging_buffer_memory);
-
-    context_create_buffer(render_context,
-                          instance_buffer_size,
-                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                          &renderer->instance_buffer,
-                          &renderer->instance_buffer_memory);
-
-    void *instance_staging_buffer_memory_mapped;
-    vkMapMemory(render_context->device.logical_device,
-                instance_staging_buffer_memory,
-                0,
-                instance_buffer_size,
-                0,
-                &instance_staging_buffer_memory_mapped);
+    resource_destroy_buffer(render_context, vertex_staging_buffer);
+
+    buffer_handle instance_staging_buffer =
+        resource_create_buffer(render_context,
+                               instance_buffer_size,
+                               VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    renderer->instance_buffer =
+        resource_create_buffer(render_context,
+                               instance_buffer_size,
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
     vec3s colors[darray_length(renderer->rectangles)];
     for (u32 i = 0; i < darray_length(renderer->rectangles); i++) {
         colors[i] = renderer->rectangles[i].color;
     }
 
-    memcpy(instance_staging_buffer_memory_mapped, colors, sizeof(colors));
+    memcpy(resource_buffer_mapped(render_context->resources, instance_staging_buffer),
+           colors,
+           sizeof(colors));
     context_copy_buffer(render_context,
-                        instance_staging_buffer,
-                        renderer->instance_buffer,
+                        resource_buffer(render_context->resources, instance_staging_buffer),
+                        resource_buffer(render_context->resources, renderer->instance_buffer),
                         instance_buffer_size);
 
-    vkDestroyBuffer(render_context->device.logical_device, instance_staging_buffer, NULL);
-    vkFreeMemory(render_context->device.logical_device, instance_staging_buffer_memory, NULL);
+    resource_destroy_buffer(render_context, instance_staging_buffer);
 }
 
 static void colored_rectangle_renderer_render(ColoredRectangleRenderer *renderer,
+                                              const struct resource_registry *resources,
                                               u32 current_frame,
                                               VkCommandBuffer command_buffer) {
-    pipeline_bind(&renderer->rectangle_pipeline, command_buffer, current_frame);
+    pipeline_bind(resource_pipeline(resources, renderer->rectangle_pipeline),
+                  command_buffer,
+                  current_frame);
 
-    VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(command_buffer, 0, 1, &renderer->vertex_buffer, offsets);
-    vkCmdBindVertexBuffers(command_buffer, 1, 1, &renderer->instance_buffer, offsets);
+    VkBuffer vertex_buffers[] = {
+        resource_buffer(resources, renderer->vertex_buffer),
+        resource_buffer(resources, renderer->instance_buffer),
+    };
+    VkDeviceSize offsets[] = {0, 0};
+    vkCmdBindVertexBuffers(command_buffer, 0, 2, vertex_buffers, offsets);
 
     vkCmdDraw(command_buffer, 4, darray_length(renderer->rectangles), 0, 0);
 }
 
+typedef struct {
+    context *render_context;
+    const pipeline *planet_pipeline;
+    geometry_arena *planet_geometry;
+    draw_list *planet_draws;
+    u32 draw_data_slot;
+} PlanetRecording;
+
+static void planet_record(VkCommandBuffer command_buffer, void *user_data) {
+    PlanetRecording *recording = user_data;
+    context *render_context = recording->render_context;
+
+    // NOTE: Secondary command buffers start without any bound state.
+    bindless_bind(&render_context->bindless, command_buffer);
+
+    pipeline_bind(recording->planet_pipeline, command_buffer, render_context->current_frame);
+
+    PlanetIndices planet_indices = {
+        .draw_data = recording->draw_data_slot,
+    };
+    bindless_push_constants(&render_context->bindless,
+                            command_buffer,
+                            &planet_indices,
+                            sizeof(planet_indices));
+
+    geometry_arena_bind(recording->planet_geometry, command_buffer);
+    draw_list_submit(recording->planet_draws, render_context, command_buffer, DRAW_LIST_UNBOUND);
+}
+
+static pipeline_builder planet_pipeline_builder(context *render_context) {
+    pipeline_builder builder = pipeline_builder_new(render_context);
+    pipeline_builder_set_ubo_size(&builder, sizeof(UniformBufferObject));
+    pipeline_builder_use_bindless(&builder);
+    pipeline_builder_add_input_binding(&builder, 0, sizeof(vec3s), VK_VERTEX_INPUT_RATE_VERTEX);
+    pipeline_builder_add_input_attribute(&builder, 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0);
+    pipeline_builder_set_shaders(&builder, "shaders/simple.vert.spv", "shaders/simple.frag.spv");
+
+    return builder;
+}
+
 vec4s calculate_plane(vec3s vertices[3]) {
     vec3s ab = glms_vec3_sub(vertices[1], vertices[0]);
     vec3s ac = glms_vec3_sub(vertices[2], vertices[0]);
@@ -658,9 +752,314 @@ void simplify_mesh(Mesh *mesh, f32 error_limit) {
     darray_destroy(pairs);
 }
 
-int main(void) {
-    GLFWwindow *window = create_window();
-    context render_context = context_new(window);
+typedef struct {
+    pthread_t handle;
+    struct frame_packet_mailbox *mailbox;
+
+    context *render_context;
+    pipeline_handle planet_pipeline;
+    geometry_arena *planet_geometry;
+    draw_list *planet_draws;
+    const u32 *planet_draw_data_slots;
+    TextRenderer *text_renderer;
+
+    struct frame_stats *frame_stats;
+    const char *frame_report_path;
+    // NOTE: Set by the main thread, the render thread writes the report after its next frame.
+    atomic_bool report_requested;
+
+    // NOTE: The newest camera the main thread has simulated and when its input was sampled,
+    // which frames use instead of their packet's camera when late_latch is set.
+    b8 late_latch;
+    pthread_mutex_t latch_mutex;
+    Camera latched_camera;
+    u64 latched_input_ns;
+    // NOTE: The packet being rendered, only touched by the render thread.
+    const FramePacket *packet;
+} RenderThread;
+
+/**
+ * Writes the frame's camera matrices into its slot of the planet pipeline's uniforms right before
+ * the frame is submitted. With late latching they follow the newest simulated camera, which the
+ * main thread usually built from input sampled after the frame's packet was published.
+ */
+static u64 latch_camera(context *render_context, void *user_data) {
+    RenderThread *renderer = user_data;
+
+    Camera camera = renderer->packet->camera;
+    u64 input_ns = renderer->packet->input_ns;
+    if (renderer->late_latch) {
+        pthread_mutex_lock(&renderer->latch_mutex);
+        camera = renderer->latched_camera;
+        input_ns = renderer->latched_input_ns;
+        pthread_mutex_unlock(&renderer->latch_mutex);
+    }
+
+    UniformBufferObject ubo = camera_create_ubo(render_context, camera);
+
+    const pipeline *planet_pipeline =
+        resource_pipeline(render_context->resources, renderer->planet_pipeline);
+    memcpy(pipeline_uniform_slot(planet_pipeline, render_context->current_frame),
+           &ubo,
+           sizeof(ubo));
+
+    return input_ns;
+}
+
+/**
+ * Owns every Vulkan call of the main loop: it renders the newest frame packet while the main
+ * thread simulates the next one, until the mailbox is closed.
+ */
+static void *render_thread_main(void *render_thread) {
+    RenderThread *renderer = render_thread;
+    context *render_context = renderer->render_context;
+    PROFILE_THREAD_NAME("render");
+
+    u64 last_second = timer_now_ns();
+    u32 frames = 0;
+
+    const FramePacket *packet;
+    while ((packet = frame_packet_mailbox_acquire(renderer->mailbox)) != NULL) {
+        PROFILE_SCOPE("render frame");
+
+        // NOTE: Skipped when the window was minimized after the packet was published, the main
+        // thread stops publishing until it is restored.
+        if (context_begin_frame(render_context) == VK_NULL_HANDLE) {
+            continue;
+        }
+        renderer->packet = packet;
+
+        draw_list_begin(renderer->planet_draws, render_context->current_frame);
+        for (u32 i = 0; i < packet->draw_count; i++) {
+            draw_list_push(renderer->planet_draws,
+                           &packet->draws[i].geometry,
+                           &packet->draws[i].draw_data);
+        }
+
+        const pipeline *planet_pipeline =
+            resource_pipeline(render_context->resources, renderer->planet_pipeline);
+
+        PlanetRecording planet_recording = {
+            .render_context = render_context,
+            .planet_pipeline = planet_pipeline,
+            .planet_geometry = renderer->planet_geometry,
+            .planet_draws = renderer->planet_draws,
+            .draw_data_slot = renderer->planet_draw_data_slots[render_context->current_frame],
+        };
+
+        // colored_rectangle_renderer_render(&rectangle_renderer, render_context.current_frame,
+        // command_buffer);
+        TextRecording text_recording = {
+            .renderer = renderer->text_renderer,
+            .resources = render_context->resources,
+            .current_frame = render_context->current_frame,
+        };
+
+        command_recording recordings[] = {
+            {.record = planet_record, .user_data = &planet_recording, .name = "planet"},
+            {.record = text_renderer_record, .user_data = &text_recording, .name = "text"},
+        };
+        context_record(render_context,
+                       recordings,
+                       sizeof(recordings) / sizeof(command_recording));
+
+        // NOTE: The camera is written by latch_camera, right before the frame is submitted.
+        context_end_frame(render_context);
+
+        frame_timing timing;
+        context_frame_timing(render_context, &timing);
+        frame_stats_record(renderer->frame_stats, &timing);
+
+        frames++;
+        if (timer_elapsed_ms(last_second) >= 1000.0) {
+            frame_stats_print(renderer->frame_stats, frames);
+            gpu_profiler_print(render_context->gpu_profiler);
+            frames = 0;
+            last_second = timer_now_ns();
+        }
+
+        if (atomic_exchange(&renderer->report_requested, false)) {
+            frame_stats_write_report(renderer->frame_stats, renderer->frame_report_path);
+        }
+    }
+
+    return NULL;
+}
+
+static void render_thread_start(RenderThread *renderer) {
+    if (pthread_create(&renderer->handle, NULL, render_thread_main, renderer) != 0) {
+        fprintf(stderr, "Failed to create the render thread!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void render_thread_stop(RenderThread *renderer) {
+    frame_packet_mailbox_close(renderer->mailbox);
+    pthread_join(renderer->handle, NULL);
+}
+
+static void simulate_frame_packet(FramePacket *packet,
+                                  u64 tick,
+                                  const Planet *planet,
+                                  Camera camera,
+                                  u64 input_ns) {
+    PROFILE_FUNCTION();
+
+    packet->tick = tick;
+    packet->camera = camera;
+    packet->input_ns = input_ns;
+
+    packet->draw_count = 0;
+    for (u32 i = 0; i < FACES_PER_PLANET; i++) {
+        packet->draws[packet->draw_count++] = (PacketDraw){
+            .geometry = planet->terrain_faces[i].geometry,
+            .draw_data =
+                {
+                    .color = {{0.8f, 0.8f, 0.8f, 1.0f}},
+                },
+        };
+    }
+}
+
+typedef struct {
+    Planet *planet;
+    f32 error_limit;
+} PlanetSimplification;
+
+static void planet_simplify_faces(u32 start, u32 end, void *simplification) {
+    PlanetSimplification *work = simplification;
+    for (u32 i = start; i < end; i++) {
+        simplify_mesh(&work->planet->terrain_faces[i].mesh, work->error_limit);
+    }
+}
+
+void planet_simplify_meshes(Planet *planet, f32 error_limit) {
+    PlanetSimplification work = {
+        .planet = planet,
+        .error_limit = error_limit,
+    };
+    job_parallel_for(FACES_PER_PLANET, 1, planet_simplify_faces, &work);
+}
+
+/**
+ * Writes the last rendered frame of a headless context with readback as a binary PPM.
+ */
+static void write_capture(context *render_context, const char *file_name) {
+    u32 width = render_context->framebuffer_width;
+    u32 height = render_context->framebuffer_height;
+    u8 *pixels = malloc((u64)width * height * 4);
+
+    if (!context_read_frame(render_context, pixels)) {
+        fprintf(stderr, "Capturing %s needs a headless run that rendered a frame\n", file_name);
+        free(pixels);
+        return;
+    }
+
+    FILE *fp = fopen(file_name, "wb");
+    if (!fp) {
+        fprintf(stderr, "Unable to open %s\n", file_name);
+        free(pixels);
+        return;
+    }
+
+    b8 bgra = render_context->swapchain.image_format.format == VK_FORMAT_B8G8R8A8_SRGB;
+
+    fprintf(fp, "P6\n%u %u\n255\n", width, height);
+    for (u64 i = 0; i < (u64)width * height; i++) {
+        u8 *texel = &pixels[i * 4];
+        u8 rgb[] = {
+            bgra ? texel[2] : texel[0],
+            texel[1],
+            bgra ? texel[0] : texel[2],
+        };
+        fwrite(rgb, 1, sizeof(rgb), fp);
+    }
+
+    fclose(fp);
+    free(pixels);
+
+    printf("Captured the last frame to %s\n", file_name);
+}
+
+/**
+ * Prints how many resources of each type the registry holds and the device memory behind them.
+ */
+static void print_resource_usage(const struct resource_registry *resources) {
+    const char *type_names[RESOURCE_TYPE_COUNT] = {
+        [RESOURCE_BUFFER] = "buffers",
+        [RESOURCE_IMAGE] = "images",
+        [RESOURCE_SAMPLER] = "samplers",
+        [RESOURCE_PIPELINE] = "pipelines",
+    };
+
+    resource_usage usage;
+    resource_registry_usage(resources, &usage);
+
+    printf("Resources:");
+    for (u32 i = 0; i < RESOURCE_TYPE_COUNT; i++) {
+        printf(" %u %s", usage.counts[i], type_names[i]);
+        if (usage.bytes[i] > 0) {
+            printf(" (%.2f MiB)", usage.bytes[i] / (1024.0 * 1024.0));
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    PROFILE_THREAD_NAME("main");
+
+    config game_config = config_load(argc, argv);
+
+    job_system_init(game_config.worker_count, JOB_DEFAULT_FIBER_COUNT);
+
+    // NOTE: A replayed path at a fixed step runs until its last keyframe unless told otherwise.
+    camera_path replay_path = {0};
+    if (game_config.camera_path[0] != '\0') {
+        if (!camera_path_load(game_config.camera_path, &replay_path)) {
+            exit(EXIT_FAILURE);
+        }
+
+        if (game_config.frame_count == 0 && game_config.tick_rate != 0) {
+            game_config.frame_count =
+                (u32)ceil(camera_path_duration(&replay_path) * game_config.tick_rate) + 1;
+        }
+    }
+
+    camera_path recorded_path = {0};
+    if (game_config.camera_record_path[0] != '\0') {
+        recorded_path = camera_path_create();
+    }
+
+    GLFWwindow *window = NULL;
+    context render_context;
+    if (game_config.headless) {
+        render_context = context_new_headless(game_config.width,
+                                              game_config.height,
+                                              game_config.capture_path[0] != '\0',
+                                              &game_config.presentation);
+    } else {
+        window = create_window(game_config.width, game_config.height);
+        render_context = context_new(window, &game_config.presentation);
+    }
+
+    // NOTE: A replay runs until its last recorded tick unless told otherwise.
+    struct input *input = input_create(window);
+    if (game_config.input_replay_path[0] != '\0') {
+        if (!input_start_replay(input, game_config.input_replay_path)) {
+            exit(EXIT_FAILURE);
+        }
+
+        if (game_config.frame_count == 0) {
+            game_config.frame_count = input_replay_tick_count(input);
+        }
+    }
+    if (game_config.input_record_path[0] != '\0') {
+        input_start_recording(input, game_config.input_record_path);
+    }
+
+    if (game_config.headless && game_config.frame_count == 0) {
+        game_config.frame_count = HEADLESS_DEFAULT_FRAME_COUNT;
+    }
 
     gltf_root gltf;
     load_gltf_from_file("models/tire.glb", &gltf);
@@ -669,189 +1068,245 @@ int main(void) {
     load_font("fonts/foxus/FOXUS.ttf", &font);
     // load_font("fonts/unispace/Unispace Rg.otf", &font);
 
-    // ColoredRectangleRenderer rectangle_renderer =
-    // colored_rectangle_renderer_create(&render_context);
+    pipeline_builder pipeline_builders[PIPELINE_COUNT] = {
+        [PIPELINE_TEXT] = text_renderer_pipeline_builder(&render_context),
+        [PIPELINE_UI] = colored_rectangle_renderer_pipeline_builder(&render_context),
+        [PIPELINE_PLANET] = planet_pipeline_builder(&render_context),
+    };
+    pipeline built_pipelines[PIPELINE_COUNT];
+    pipeline_builder_build_all(pipeline_builders,
+                               PIPELINE_COUNT,
+                               render_context.render_pass,
+                               built_pipelines);
+
+    pipeline_handle pipelines[PIPELINE_COUNT];
+    for (u32 i = 0; i < PIPELINE_COUNT; i++) {
+        pipelines[i] = resource_add_pipeline(&render_context, built_pipelines[i]);
+    }
+
+    ColoredRectangleRenderer rectangle_renderer =
+        colored_rectangle_renderer_create(pipelines[PIPELINE_UI]);
 
     // colored_rectangle_renderer_add_rectangle(&rectangle_renderer, (vec2s){{0.1, 0.1}},
     // (vec2s){{0.2, 0.2}}, (vec3s){{1.0, 0.0, 0.0}});
 
-    TextRenderer text_renderer = text_renderer_create(&render_context);
-
-    pipeline_builder planet_pipeline_builder = pipeline_builder_new(&render_context);
-    pipeline_builder_set_ubo_size(&planet_pipeline_builder, sizeof(UniformBufferObject));
-    pipeline_builder_add_input_binding(&planet_pipeline_builder,
-                                       0,
-                                       sizeof(vec3s),
-                                       VK_VERTEX_INPUT_RATE_VERTEX);
-    pipeline_builder_add_input_attribute(&planet_pipeline_builder,
-                                         0,
-                                         0,
-                                         VK_FORMAT_R32G32B32_SFLOAT,
-                                         0);
-    pipeline_builder_set_shaders(&planet_pipeline_builder,
-                                 "shaders/simple.vert.spv",
-                                 "shaders/simple.frag.spv");
-    pipeline planet_pipeline =
-        pipeline_builder_build(&planet_pipeline_builder, render_context.render_pass);
+    TextRenderer text_renderer = text_renderer_create(pipelines[PIPELINE_TEXT]);
+    pipeline_handle planet_pipeline = pipelines[PIPELINE_PLANET];
 
     Planet planet = create_planet();
     planet_generate_meshes(&planet);
 
-    // for (u32 i = 0; i < 6; i++) {
-    //     simplify_mesh(&planet.terrain_faces[i].mesh, 0.25);
-    // }
-
-    VkDeviceSize vertex_buffer_size = sizeof(vec3s) * (planet.terrain_faces[0].mesh.vertex_count);
-
-    VkBuffer vertex_staging_buffer;
-    VkDeviceMemory vertex_staging_buffer_memory;
-
-    context_create_buffer(&render_context,
-                          vertex_buffer_size,
-                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                          &vertex_staging_buffer,
-                          &vertex_staging_buffer_memory);
-    void *vertex_staging_buffer_memory_mapped;
-    vkMapMemory(render_context.device.logical_device,
-                vertex_staging_buffer_memory,
-                0,
-                vertex_buffer_size,
-                0,
-                &vertex_staging_buffer_memory_mapped);
-
-    VkBuffer vertex_buffers[FACES_PER_PLANET];
-    VkDeviceMemory vertex_buffer_memories[FACES_PER_PLANET];
+    // planet_simplify_meshes(&planet, 0.25);
+
+    geometry_arena planet_geometry = geometry_arena_create(&render_context,
+                                                           sizeof(vec3s),
+                                                           GEOMETRY_ARENA_VERTEX_CAPACITY,
+                                                           GEOMETRY_ARENA_INDEX_CAPACITY);
+
     for (u32 i = 0; i < FACES_PER_PLANET; i++) {
-        context_create_buffer(&render_context,
-                              vertex_buffer_size,
-                              VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                              &vertex_buffers[i],
-                              &vertex_buffer_memories[i]);
-
-        memcpy(vertex_staging_buffer_memory_mapped,
-               planet.terrain_faces[i].mesh.vertices,
-               vertex_buffer_size);
-
-        context_copy_buffer(&render_context,
-                            vertex_staging_buffer,
-                            vertex_buffers[i],
-                            vertex_buffer_size);
-    }
-
-    VkDeviceSize index_buffer_size = sizeof(u32) * planet.terrain_faces[0].mesh.index_count;
-
-    VkBuffer index_staging_buffer;
-    VkDeviceMemory index_staging_buffer_memory;
-
-    VkBuffer index_buffers;
-    VkDeviceMemory index_buffer_memories;
-
-    context_create_buffer(&render_context,
-                          index_buffer_size,
-                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                          &index_staging_buffer,
-                          &index_staging_buffer_memory);
-
-    void *index_staging_buffer_memory_mapped;
-    vkMapMemory(render_context.device.logical_device,
-                index_staging_buffer_memory,
-                0,
-                index_buffer_size,
-                0,
-                &index_staging_buffer_memory_mapped);
-
-    context_create_buffer(&render_context,
-                          index_buffer_size,
-                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                          &index_buffers,
-                          &index_buffer_memories);
-
-    memcpy(index_staging_buffer_memory_mapped,
-           planet.terrain_faces[0].mesh.indices,
-           index_buffer_size);
-
-    context_copy_buffer(&render_context, index_staging_buffer, index_buffers, index_buffer_size);
+        Mesh *mesh = &planet.terrain_faces[i].mesh;
+        if (!geometry_arena_upload(&planet_geometry,
+                                   &render_context,
+                                   mesh->vertices,
+                                   mesh->vertex_count,
+                                   mesh->indices,
+                                   mesh->index_count,
+                                   &planet.terrain_faces[i].geometry)) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    draw_list planet_draws =
+        draw_list_create(&render_context, MAX_DRAWS_PER_FRAME, sizeof(DrawData));
+
+    u32 planet_draw_data_slots[MAX_FRAMES_IN_FLIGHT];
+    for (u32 i = 0; i < render_context.max_frames_in_flight; i++) {
+        planet_draw_data_slots[i] = bindless_add_storage_buffer(&render_context.bindless,
+                                                                &render_context,
+                                                                planet_draws.draw_data[i],
+                                                                0,
+                                                                VK_WHOLE_SIZE);
+    }
 
     // colored_rectangle_renderer_setup_buffers(&rectangle_renderer, &render_context);
     text_renderer_setup_buffers(&text_renderer, &render_context);
 
     context_begin_main_loop(&render_context);
 
+    RenderThread render_thread = {
+        .mailbox = frame_packet_mailbox_create(sizeof(FramePacket)),
+        .render_context = &render_context,
+        .planet_pipeline = planet_pipeline,
+        .planet_geometry = &planet_geometry,
+        .planet_draws = &planet_draws,
+        .planet_draw_data_slots = planet_draw_data_slots,
+        .text_renderer = &text_renderer,
+        .frame_stats = frame_stats_create(FRAME_STATS_HISTORY, game_config.hitch_threshold_ms),
+        .frame_report_path = game_config.frame_report_path[0] != '\0'
+                                 ? game_config.frame_report_path
+                                 : DEFAULT_FRAME_REPORT_FILE_NAME,
+        // NOTE: Replays have to render the camera of each tick to reproduce their frames.
+        .late_latch = game_config.late_latch && !replay_path.keyframes &&
+                      game_config.input_replay_path[0] == '\0',
+    };
+    pthread_mutex_init(&render_thread.latch_mutex, NULL);
+    context_set_late_latch(&render_context, latch_camera, &render_thread);
+    render_thread_start(&render_thread);
+
     Camera camera = camera_create((vec3s){{0.0, 0.0, 5.0}});
 
-    f32 delta_time;
-    f32 last_time = 0.0;
-    f32 last_second = glfwGetTime();
-    u16 frames = 0;
+    u64 start_time = timer_now_ns();
+    u64 last_time = start_time;
+    u64 tick = 0;
+    f64 simulation_time = 0.0;
+
+    // NOTE: The main thread only polls input and simulates; GLFW requires both on this thread.
+    while (game_config.frame_count != 0 ? tick < game_config.frame_count
+                                        : !glfwWindowShouldClose(window)) {
+        // NOTE: A minimized window has nothing to present to, so no packets are published until
+        // it is restored. Waiting for its events keeps both threads idle meanwhile.
+        if (window) {
+            int framebuffer_width, framebuffer_height;
+            glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+            if (framebuffer_width == 0 || framebuffer_height == 0) {
+                context_on_resized(&render_context, 0, 0);
+                glfwWaitEvents();
+                last_time = timer_now_ns();
+                continue;
+            }
+        }
 
-    while (!glfwWindowShouldClose(window)) {
-        f32 current_time = glfwGetTime();
-        delta_time = current_time - last_time;
+        u64 current_time = timer_now_ns();
+        f32 delta_time = (f32)(current_time - last_time) / 1000000000.0f;
         last_time = current_time;
-        frames++;
-        if (current_time >= last_second + 1.0f) {
-            printf("%d\n", frames);
-            frames = 0;
-            last_second = current_time;
-        }
 
-        glfwPollEvents();
+        // NOTE: With a tick rate the simulation only depends on the tick, not on how long the
+        // previous one took.
+        if (game_config.tick_rate != 0) {
+            delta_time = 1.0f / game_config.tick_rate;
+        }
 
-        camera_process_input(window, &camera, delta_time);
+        PROFILE_SCOPE("frame");
 
-        VkCommandBuffer command_buffer = context_begin_frame(&render_context);
+        PROFILE_BEGIN(input_zone, "input");
+        // NOTE: A replay substitutes the recorded time step, so the simulation sees the same ticks.
+        delta_time = input_update(input, tick, delta_time);
+        u64 input_ns = timer_now_ns();
+        const input_state *current_input = input_get_state(input);
 
-        pipeline_bind(&planet_pipeline, command_buffer, render_context.current_frame);
+        // NOTE: The render thread recreates the swapchain once the size has settled.
+        if (window) {
+            int framebuffer_width, framebuffer_height;
+            glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+            context_on_resized(&render_context, framebuffer_width, framebuffer_height);
+        }
 
-        vkCmdBindIndexBuffer(command_buffer, index_buffers, 0, VK_INDEX_TYPE_UINT32);
+        if (!replay_path.keyframes) {
+            camera_process_input(&camera, current_input, delta_time);
+        }
 
-        for (u32 i = 0; i < FACES_PER_PLANET; i++) {
-            VkBuffer buffers[] = {vertex_buffers[i]};
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(command_buffer, 0, 1, buffers, offsets);
+        if (current_input->keys_pressed[GLFW_KEY_F9]) {
+            profile_write_trace(game_config.cpu_trace_path[0] != '\0'
+                                    ? game_config.cpu_trace_path
+                                    : DEFAULT_CPU_TRACE_FILE_NAME);
+        }
+        if (current_input->keys_pressed[GLFW_KEY_F10]) {
+            atomic_store(&render_thread.report_requested, true);
+        }
+        PROFILE_END(input_zone);
 
-            vkCmdDrawIndexed(command_buffer, planet.terrain_faces[i].mesh.index_count, 1, 0, 0, 0);
+        if (replay_path.keyframes) {
+            camera = camera_path_sample(&replay_path, simulation_time);
+        }
+        if (recorded_path.keyframes) {
+            camera_path_append(&recorded_path, simulation_time, camera);
         }
 
-        // colored_rectangle_renderer_render(&rectangle_renderer, render_context.current_frame,
-        // command_buffer);
-        text_renderer_render(&text_renderer, render_context.current_frame, command_buffer);
+        if (render_thread.late_latch) {
+            pthread_mutex_lock(&render_thread.latch_mutex);
+            render_thread.latched_camera = camera;
+            render_thread.latched_input_ns = input_ns;
+            pthread_mutex_unlock(&render_thread.latch_mutex);
+        }
 
-        context_end_frame(&render_context);
+        FramePacket *packet = frame_packet_mailbox_begin_write(render_thread.mailbox);
+        simulate_frame_packet(packet, tick++, &planet, camera, input_ns);
+        frame_packet_mailbox_publish(render_thread.mailbox);
 
-        UniformBufferObject ubo = camera_create_ubo(&render_context, camera);
+        // NOTE: Returns as soon as the render thread picks the packet up, so the next tick is
+        // simulated while this one renders.
+        PROFILE_BEGIN(wait_zone, "wait consumed");
+        frame_packet_mailbox_wait_consumed(render_thread.mailbox);
+        PROFILE_END(wait_zone);
 
-        memcpy(planet_pipeline.uniform_buffer_mapped, &ubo, sizeof(ubo));
+        simulation_time += delta_time;
     }
 
+    render_thread_stop(&render_thread);
+    frame_packet_mailbox_destroy(render_thread.mailbox);
+    context_set_late_latch(&render_context, NULL, NULL);
+    pthread_mutex_destroy(&render_thread.latch_mutex);
+
     context_end_main_loop(&render_context);
 
-    // colored_rectangle_renderer_destroy(&rectangle_renderer, &render_context.device);
-    text_renderer_destroy(&text_renderer, &render_context.device);
+    f64 run_ms = timer_elapsed_ms(start_time);
+    printf("%llu frames in %.2f ms: %.3f ms per frame, GPU %.3f ms per frame\n",
+           tick,
+           run_ms,
+           tick > 0 ? run_ms / tick : 0.0,
+           render_context.average_gpu_frame_time_ms);
+    frame_stats_print(render_thread.frame_stats, 0);
+    print_resource_usage(render_context.resources);
+
+    if (game_config.frame_report_path[0] != '\0') {
+        frame_stats_write_report(render_thread.frame_stats, game_config.frame_report_path);
+    }
+    if (replay_path.keyframes) {
+        camera_path_destroy(&replay_path);
+    }
+    if (recorded_path.keyframes) {
+        camera_path_write(&recorded_path, game_config.camera_record_path);
+        camera_path_destroy(&recorded_path);
+    }
+
+    if (game_config.capture_path[0] != '\0') {
+        write_capture(&render_context, game_config.capture_path);
+    }
 
-    vkDestroyBuffer(render_context.device.logical_device, vertex_staging_buffer, NULL);
-    vkFreeMemory(render_context.device.logical_device, vertex_staging_buffer_memory, NULL);
+    if (game_config.gpu_trace_path[0] != '\0') {
+        gpu_profiler_write_trace(render_context.gpu_profiler, game_config.gpu_trace_path);
+    }
 
-    for (u32 i = 0; i < FACES_PER_PLANET; i++) {
-        vkDestroyBuffer(render_context.device.logical_device, vertex_buffers[i], NULL);
-        vkFreeMemory(render_context.device.logical_device, vertex_buffer_memories[i], NULL);
+    if (game_config.cpu_trace_path[0] != '\0') {
+        profile_write_trace(game_config.cpu_trace_path);
     }
 
-    vkDestroyBuffer(render_context.device.logical_device, index_staging_buffer, NULL);
-    vkFreeMemory(render_context.device.logical_device, index_staging_buffer_memory, NULL);
+    // NOTE: A single line starting with {, easy for scripts to pick out of the output.
+    if (game_config.summary) {
+        frame_stats_write_summary(render_thread.frame_stats, run_ms, stdout);
+    }
+    frame_stats_destroy(render_thread.frame_stats);
 
-    vkDestroyBuffer(render_context.device.logical_device, index_buffers, NULL);
-    vkFreeMemory(render_context.device.logical_device, index_buffer_memories, NULL);
+    colored_rectangle_renderer_destroy(&rectangle_renderer, &render_context);
+    text_renderer_destroy(&text_renderer, &render_context);
 
-    pipeline_destroy(&planet_pipeline, &render_context.device);
+    for (u32 i = 0; i < render_context.max_frames_in_flight; i++) {
+        bindless_release(&render_context.bindless,
+                         BINDLESS_STORAGE_BUFFER,
+                         planet_draw_data_slots[i]);
+    }
+    draw_list_destroy(&planet_draws, &render_context.device);
+    geometry_arena_destroy(&planet_geometry, &render_context.device);
+
+    resource_destroy_pipeline(&render_context, planet_pipeline);
     context_cleanup(&render_context);
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    input_destroy(input);
+
+    if (window) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+
+    job_system_shutdown();
 }
@@ -1,19 +1,139 @@
 #include "pipeline.h"
 
+#include "bindless.h"
 #include "context.h"
 #include "darray.h"
 #include "defines.h"
 
 #include "device.h"
+#include "job.h"
+#include "profiler.h"
+#include "timer.h"
 #include "types.h"
 #include "vulkan/vulkan_core.h"
 #include <stdio.h>
 #include <vulkan/vulkan.h>
 
+#include <pthread.h>
 #include <stdlib.h>
-
+#include <string.h>
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+typedef struct {
+    VkPipelineVertexInputStateCreateInfo vertex_input;
+    VkPipelineInputAssemblyStateCreateInfo input_assembly;
+    VkDynamicState dynamic_states[8];
+    VkPipelineDynamicStateCreateInfo dynamic;
+    VkPipelineViewportStateCreateInfo viewport;
+    VkPipelineRasterizationStateCreateInfo rasterization;
+    VkPipelineMultisampleStateCreateInfo multisample;
+    VkPipelineColorBlendAttachmentState color_blend_attachment;
+    VkPipelineColorBlendStateCreateInfo color_blend;
+    VkPipelineDepthStencilStateCreateInfo depth_stencil;
+} fixed_function_state;
+
+/**
+ * The bytes a registry key was hashed from. Entries match when their hashes match and the bytes
+ * are equal, so a hash collision can never hand out another builder's objects.
+ */
+typedef struct {
+    u64 hash;
+    u8 *bytes;
+    u64 size;
+    u64 capacity;
+} registry_key;
+
+typedef struct {
+    registry_key key;
+    VkPipeline handle;
+} pipeline_library;
+
+typedef struct {
+    registry_key key;
+    u32 reference_count;
+    VkPipelineLayout layout;
+    VkDescriptorSetLayout descriptor_set_layout;
+} shared_layout;
+
+typedef struct {
+    registry_key key;
+    u32 reference_count;
+    VkPipeline handle;
+    VkPipelineLayout layout;
+    VkDescriptorSetLayout descriptor_set_layout;
+} shared_pipeline;
+
+struct pipeline_registry {
+    pthread_mutex_t mutex;
+    pipeline_library *libraries; // darray
+    shared_layout *layouts;      // darray
+    shared_pipeline *pipelines;  // darray
+};
+
+typedef struct {
+    pipeline_builder *builders;
+    pipeline *pipelines;
+    VkRenderPass render_pass;
+} build_all_work;
+
+static void build_all_batch(u32 start, u32 end, void *work);
+static b8 acquire_shared_pipeline(struct pipeline_registry *registry,
+                                  const registry_key *key,
+                                  pipeline *out_pipeline);
+static void publish_shared_pipeline(struct pipeline_registry *registry,
+                                    registry_key *key,
+                                    pipeline *pipeline,
+                                    device *device);
+static void release_shared_pipeline(struct pipeline_registry *registry,
+                                    VkPipeline handle,
+                                    device *device);
+static void acquire_shared_layout(const pipeline_builder *builder, pipeline *out_pipeline);
+static void release_shared_layout(struct pipeline_registry *registry,
+                                  VkPipelineLayout layout,
+                                  device *device);
+static void fixed_function_state_init(const pipeline_builder *builder,
+                                      fixed_function_state *state);
+static VkPipeline create_monolithic_pipeline(const pipeline_builder *builder,
+                                             const fixed_function_state *state,
+                                             VkPipelineLayout layout,
+                                             VkRenderPass render_pass);
+static VkPipeline link_pipeline(const pipeline_builder *builder,
+                                const fixed_function_state *state,
+                                VkPipelineLayout layout,
+                                VkRenderPass render_pass);
+static VkPipeline get_library_part(const pipeline_builder *builder,
+                                   const fixed_function_state *state,
+                                   VkPipelineLayout layout,
+                                   VkRenderPass render_pass,
+                                   VkGraphicsPipelineLibraryFlagsEXT part);
+static VkPipeline create_library_part(const pipeline_builder *builder,
+                                      const fixed_function_state *state,
+                                      VkPipelineLayout layout,
+                                      VkRenderPass render_pass,
+                                      VkGraphicsPipelineLibraryFlagsEXT part);
+static registry_key library_part_key(const pipeline_builder *builder,
+                                     VkRenderPass render_pass,
+                                     VkGraphicsPipelineLibraryFlagsEXT part);
+static registry_key pipeline_key(const pipeline_builder *builder, VkRenderPass render_pass);
+static registry_key layout_key(const pipeline_builder *builder);
+static void key_append_layout(registry_key *key, const pipeline_builder *builder);
+static VkPipelineRenderingCreateInfo rendering_create_info(const pipeline_builder *builder);
+static void key_append(registry_key *key, const void *data, u64 size);
+static b8 key_equals(const registry_key *a, const registry_key *b);
+static void key_destroy(registry_key *key);
+static u32 topology_class(VkPrimitiveTopology topology);
+static VkPipelineShaderStageCreateInfo create_shader_stage(VkDevice device,
+                                                           VkShaderStageFlagBits stage,
+                                                           const u32 *code,
+                                                           u64 code_size);
 static VkShaderModule create_shader_module(VkDevice device, const u32 *code, u64 code_size);
 static u32 *read_file(const char *file_name, u64 *out_size);
+static void report_creation_time(const char *name,
+                                 const char *action,
+                                 f64 elapsed_ms,
+                                 const VkPipelineCreationFeedback *feedback);
 
 /**************************************************************************************************
  * public functions                                                                               *
@@ -24,6 +144,8 @@ pipeline_builder pipeline_builder_new(const context *context) {
         .context = context,
         .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
         .cull_mode = VK_CULL_MODE_BACK_BIT,
+        .color_format = context->swapchain.image_format.format,
+        .depth_format = context->device.depth_format,
         .vertex_input_attributes = darray_create(VkVertexInputAttributeDescription),
         .vertex_input_bindings = darray_create(VkVertexInputBindingDescription),
         .push_constant_ranges = darray_create(VkPushConstantRange),
@@ -35,47 +157,15 @@ pipeline_builder pipeline_builder_new(const context *context) {
 void pipeline_builder_set_shaders(pipeline_builder *builder,
                                   const char *vertex_shader_path,
                                   const char *fragment_shader_path) {
-    u64 vertex_shader_size;
-    u32 *vertex_shader_code = read_file(vertex_shader_path, &vertex_shader_size);
-    if (builder->vertex_shader_module != VK_NULL_HANDLE) {
-        vkDestroyShaderModule(builder->context->device.logical_device,
-                              builder->vertex_shader_module,
-                              NULL);
-    }
-    builder->vertex_shader_module = create_shader_module(builder->context->device.logical_device,
-                                                         vertex_shader_code,
-                                                         vertex_shader_size);
-    free(vertex_shader_code);
-
-    VkPipelineShaderStageCreateInfo vertex_shader_stage_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage = VK_SHADER_STAGE_VERTEX_BIT,
-        .module = builder->vertex_shader_module,
-        .pName = "main",
-    };
-
-    builder->shader_stages[0] = vertex_shader_stage_info;
-
-    u64 fragment_shader_size;
-    u32 *fragment_shader_code = read_file(fragment_shader_path, &fragment_shader_size);
-    if (builder->fragment_shader_module != VK_NULL_HANDLE) {
-        vkDestroyShaderModule(builder->context->device.logical_device,
-                              builder->fragment_shader_module,
-                              NULL);
-    }
-    builder->fragment_shader_module = create_shader_module(builder->context->device.logical_device,
-                                                           fragment_shader_code,
-                                                           fragment_shader_size);
-    free(fragment_shader_code);
+    builder->name = vertex_shader_path;
 
-    VkPipelineShaderStageCreateInfo fragment_shader_stage_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-        .module = builder->fragment_shader_module,
-        .pName = "main",
-    };
+    // NOTE: Shader modules are created in pipeline_builder_build, so that batched builds create
+    // them on the worker threads as well.
+    free(builder->vertex_shader_code);
+    builder->vertex_shader_code = read_file(vertex_shader_path, &builder->vertex_shader_size);
 
-    builder->shader_stages[1] = fragment_shader_stage_info;
+    free(builder->fragment_shader_code);
+    builder->fragment_shader_code = read_file(fragment_shader_path, &builder->fragment_shader_size);
 }
 
 void pipeline_builder_add_input_binding(pipeline_builder *builder,
@@ -110,6 +200,14 @@ void pipeline_builder_set_ubo_size(pipeline_builder *builder, u64 ubo_size) {
     builder->ubo_size = ubo_size;
 }
 
+/**
+ * Puts the bindless set at set 0 and the UBO, if any, at set 1. Push constants are replaced by
+ * the shared BINDLESS_PUSH_CONSTANT_SIZE range so all bindless pipelines stay layout compatible.
+ */
+void pipeline_builder_use_bindless(pipeline_builder *builder) {
+    builder->bindless = true;
+}
+
 void pipeline_builder_set_topology(pipeline_builder *builder, VkPrimitiveTopology topology) {
     builder->topology = topology;
 }
@@ -122,6 +220,13 @@ void pipeline_builder_set_alpha_blending(pipeline_builder *builder, b8 value) {
     builder->enable_alpha_blending = value;
 }
 
+void pipeline_builder_set_attachment_formats(pipeline_builder *builder,
+                                             VkFormat color_format,
+                                             VkFormat depth_format) {
+    builder->color_format = color_format;
+    builder->depth_format = depth_format;
+}
+
 void pipeline_builder_add_push_constant(pipeline_builder *builder,
                                         VkShaderStageFlagBits shader_stage,
                                         u32 size) {
@@ -135,154 +240,57 @@ void pipeline_builder_add_push_constant(pipeline_builder *builder,
 }
 
 pipeline pipeline_builder_build(pipeline_builder *builder, VkRenderPass render_pass) {
-    pipeline pipeline = {0};
-
-    if (builder->ubo_size) {
-        VkDescriptorSetLayoutBinding layout_bindings[] = {
-            {
-                .binding = 0,
-                .descriptorCount = 1,
-                .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                .pImmutableSamplers = NULL,
-                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-            },
-        };
-
-        VkDescriptorSetLayoutCreateInfo layout_info = {
-            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-            .bindingCount = sizeof(VkDescriptorSetLayoutBinding) / sizeof(layout_bindings),
-            .pBindings = layout_bindings,
-        };
+    PROFILE_FUNCTION();
 
-        VK_CHECK(vkCreateDescriptorSetLayout(builder->context->device.logical_device,
-                                             &layout_info,
-                                             NULL,
-                                             &pipeline.global_descriptor_set_layout));
-    }
+    struct pipeline_registry *registry = builder->context->pipeline_registry;
 
-    VkPipelineVertexInputStateCreateInfo vertex_input_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount = darray_length(builder->vertex_input_bindings),
-        .pVertexBindingDescriptions = builder->vertex_input_bindings,
-        .vertexAttributeDescriptionCount = darray_length(builder->vertex_input_attributes),
-        .pVertexAttributeDescriptions = builder->vertex_input_attributes,
-    };
-
-    VkPipelineInputAssemblyStateCreateInfo input_assembly_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+    pipeline pipeline = {
+        .registry = registry,
+        .global_descriptor_set_index = builder->bindless ? 1 : 0,
+        .dynamic_state = builder->context->device.supports_extended_dynamic_state,
+        .unrestricted_topology = builder->context->device.supports_unrestricted_topology,
+        .cull_mode = builder->cull_mode,
         .topology = builder->topology,
-        .primitiveRestartEnable = VK_FALSE,
-    };
-
-    VkDynamicState dynamic_states[] = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR,
-    };
-    uint32_t dynamic_state_count = sizeof(dynamic_states) / sizeof(VkDynamicState);
-
-    VkPipelineDynamicStateCreateInfo dynamic_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-        .dynamicStateCount = dynamic_state_count,
-        .pDynamicStates = dynamic_states,
-    };
-
-    VkPipelineViewportStateCreateInfo viewport_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .viewportCount = 1,
-        .scissorCount = 1,
-    };
-
-    VkPipelineRasterizationStateCreateInfo rasterization_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .depthClampEnable = VK_FALSE,
-        .rasterizerDiscardEnable = VK_FALSE,
-        .polygonMode = VK_POLYGON_MODE_FILL,
-        .lineWidth = 1.0f,
-        .cullMode = builder->cull_mode,
-        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
-        .depthBiasEnable = VK_FALSE,
-    };
-
-    VkPipelineMultisampleStateCreateInfo multisample_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .sampleShadingEnable = VK_FALSE,
-        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-        .minSampleShading = 1.0f,
+        .enable_alpha_blending = builder->enable_alpha_blending,
     };
+    if (builder->context->device.supports_dynamic_blend_enable) {
+        pipeline.cmd_set_color_blend_enable = builder->context->device.cmd_set_color_blend_enable;
+    }
 
-    VkPipelineColorBlendAttachmentState color_blend_attachment = {
-        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-        .blendEnable = builder->enable_alpha_blending ? VK_TRUE : VK_FALSE,
-        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
-        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
-        .colorBlendOp = VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .alphaBlendOp = VK_BLEND_OP_ADD,
-    };
+    registry_key key = pipeline_key(builder, render_pass);
 
-    VkPipelineColorBlendStateCreateInfo color_blend_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .logicOpEnable = VK_FALSE,
-        .attachmentCount = 1,
-        .pAttachments = &color_blend_attachment,
-    };
+    if (acquire_shared_pipeline(registry, &key, &pipeline)) {
+        printf("Pipeline '%s' shared with an identical request.\n",
+               builder->name ? builder->name : "unnamed");
+    } else {
+        acquire_shared_layout(builder, &pipeline);
 
-    VkPipelineDepthStencilStateCreateInfo depth_stencil_state = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-        .depthTestEnable = VK_TRUE,
-        .depthWriteEnable = VK_TRUE,
-        .depthCompareOp = VK_COMPARE_OP_LESS,
-        .depthBoundsTestEnable = VK_FALSE,
-        .stencilTestEnable = VK_FALSE,
-    };
+        fixed_function_state state;
+        fixed_function_state_init(builder, &state);
 
-    VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .pushConstantRangeCount = darray_length(builder->push_constant_ranges),
-        .pPushConstantRanges = builder->push_constant_ranges,
-    };
+        if (builder->context->device.supports_graphics_pipeline_library) {
+            pipeline.handle = link_pipeline(builder, &state, pipeline.layout, render_pass);
+        } else {
+            pipeline.handle =
+                create_monolithic_pipeline(builder, &state, pipeline.layout, render_pass);
+        }
 
-    if (builder->ubo_size) {
-        pipeline_layout_create_info.setLayoutCount = 1;
-        pipeline_layout_create_info.pSetLayouts = &pipeline.global_descriptor_set_layout;
+        publish_shared_pipeline(registry, &key, &pipeline, &builder->context->device);
     }
 
-    VK_CHECK(vkCreatePipelineLayout(builder->context->device.logical_device,
-                                    &pipeline_layout_create_info,
-                                    NULL,
-                                    &pipeline.layout));
+    key_destroy(&key);
 
-    VkGraphicsPipelineCreateInfo create_info = {
-        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .stageCount = 2,
-        .pStages = builder->shader_stages,
-        .pVertexInputState = &vertex_input_state,
-        .pInputAssemblyState = &input_assembly_state,
-        .pDynamicState = &dynamic_state,
-        .pViewportState = &viewport_state,
-        .pRasterizationState = &rasterization_state,
-        .pMultisampleState = &multisample_state,
-        .pColorBlendState = &color_blend_state,
-        .pDepthStencilState = &depth_stencil_state,
-        .layout = pipeline.layout,
-        .renderPass = render_pass,
-        .subpass = 0,
-        .basePipelineHandle = VK_NULL_HANDLE,
-        .basePipelineIndex = -1,
-    };
+    if (builder->ubo_size != 0) {
+        u32 frame_count = builder->context->max_frames_in_flight;
 
-    VK_CHECK(vkCreateGraphicsPipelines(builder->context->device.logical_device,
-                                       VK_NULL_HANDLE,
-                                       1,
-                                       &create_info,
-                                       NULL,
-                                       &pipeline.handle));
+        // NOTE: One slot per frame in flight, so a frame's uniforms can be written while the GPU
+        // still reads the previous frame's.
+        VkDeviceSize alignment =
+            builder->context->device.properties.limits.minUniformBufferOffsetAlignment;
+        pipeline.uniform_buffer_stride = (builder->ubo_size + alignment - 1) & ~(alignment - 1);
 
-    if (builder->ubo_size != 0) {
         context_create_buffer(builder->context,
-                              builder->ubo_size,
+                              pipeline.uniform_buffer_stride * frame_count,
                               VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
@@ -291,14 +299,14 @@ pipeline pipeline_builder_build(pipeline_builder *builder, VkRenderPass render_p
         vkMapMemory(builder->context->device.logical_device,
                     pipeline.uniform_buffer_memory,
                     0,
-                    builder->ubo_size,
+                    VK_WHOLE_SIZE,
                     0,
                     &pipeline.uniform_buffer_mapped);
 
         VkDescriptorPoolSize pool_sizes[] = {
             {
                 .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                .descriptorCount = MAX_FRAMES_IN_FLIGHT,
+                .descriptorCount = frame_count,
             },
         };
 
@@ -306,7 +314,7 @@ pipeline pipeline_builder_build(pipeline_builder *builder, VkRenderPass render_p
             .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
             .poolSizeCount = sizeof(pool_sizes) / sizeof(VkDescriptorPoolSize),
             .pPoolSizes = pool_sizes,
-            .maxSets = MAX_FRAMES_IN_FLIGHT,
+            .maxSets = frame_count,
         };
 
         VK_CHECK(vkCreateDescriptorPool(builder->context->device.logical_device,
@@ -315,14 +323,14 @@ pipeline pipeline_builder_build(pipeline_builder *builder, VkRenderPass render_p
                                         &pipeline.descriptor_pool));
 
         VkDescriptorSetLayout layouts[MAX_FRAMES_IN_FLIGHT];
-        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (u32 i = 0; i < frame_count; i++) {
             layouts[i] = pipeline.global_descriptor_set_layout;
         }
 
         VkDescriptorSetAllocateInfo alloc_info = {
             .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
             .descriptorPool = pipeline.descriptor_pool,
-            .descriptorSetCount = MAX_FRAMES_IN_FLIGHT,
+            .descriptorSetCount = frame_count,
             .pSetLayouts = layouts,
         };
 
@@ -330,10 +338,10 @@ pipeline pipeline_builder_build(pipeline_builder *builder, VkRenderPass render_p
                                           &alloc_info,
                                           pipeline.global_descriptor_sets));
 
-        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (u32 i = 0; i < frame_count; i++) {
             VkDescriptorBufferInfo buffer_info = {
                 .buffer = pipeline.uniform_buffer,
-                .offset = 0,
+                .offset = pipeline.uniform_buffer_stride * i,
                 .range = builder->ubo_size,
             };
 
@@ -357,12 +365,10 @@ pipeline pipeline_builder_build(pipeline_builder *builder, VkRenderPass render_p
         }
     }
 
-    vkDestroyShaderModule(builder->context->device.logical_device,
-                          builder->vertex_shader_module,
-                          NULL);
-    vkDestroyShaderModule(builder->context->device.logical_device,
-                          builder->fragment_shader_module,
-                          NULL);
+    free(builder->vertex_shader_code);
+    builder->vertex_shader_code = NULL;
+    free(builder->fragment_shader_code);
+    builder->fragment_shader_code = NULL;
 
     darray_destroy(builder->vertex_input_attributes);
     darray_destroy(builder->vertex_input_bindings);
@@ -370,12 +376,44 @@ pipeline pipeline_builder_build(pipeline_builder *builder, VkRenderPass render_p
     return pipeline;
 }
 
+/**
+ * Builds every builder on the job system and returns once all pipelines are ready.
+ * The context's VkPipelineCache is created without
+ * VK_PIPELINE_CACHE_CREATE_EXTERNALLY_SYNCHRONIZED_BIT, so the driver synchronizes access to it.
+ */
+void pipeline_builder_build_all(pipeline_builder *builders,
+                                u32 count,
+                                VkRenderPass render_pass,
+                                pipeline *out_pipelines) {
+    PROFILE_FUNCTION();
+
+    if (count == 0) {
+        return;
+    }
+
+    u64 start = timer_now_ns();
+
+    build_all_work work = {
+        .builders = builders,
+        .pipelines = out_pipelines,
+        .render_pass = render_pass,
+    };
+
+    // NOTE: One pipeline per job, since a single compile can take milliseconds.
+    job_parallel_for(count, 1, build_all_batch, &work);
+
+    printf("Built %u pipelines on %u threads in %.2f ms.\n",
+           count,
+           job_system_thread_count(),
+           timer_elapsed_ms(start));
+}
+
 void pipeline_bind(const pipeline *pipeline, VkCommandBuffer command_buffer, u32 frame_index) {
     if (pipeline->uniform_buffer != VK_NULL_HANDLE) {
         vkCmdBindDescriptorSets(command_buffer,
                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 pipeline->layout,
-                                0,
+                                pipeline->global_descriptor_set_index,
                                 1,
                                 &pipeline->global_descriptor_sets[frame_index],
                                 0,
@@ -383,6 +421,80 @@ void pipeline_bind(const pipeline *pipeline, VkCommandBuffer command_buffer, u32
     } else {
     }
     vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->handle);
+
+    // NOTE: Dynamic state is not part of the pipeline, so the builder's values are reapplied to
+    // leave no state behind from the previously bound pipeline.
+    pipeline_set_cull_mode(pipeline, command_buffer, pipeline->cull_mode);
+    pipeline_set_front_face(pipeline, command_buffer, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+    pipeline_set_topology(pipeline, command_buffer, pipeline->topology);
+    pipeline_set_depth_test(pipeline, command_buffer, true, true);
+    pipeline_set_blend_enable(pipeline, command_buffer, pipeline->enable_alpha_blending);
+}
+
+void *pipeline_uniform_slot(const pipeline *pipeline, u32 frame_index) {
+    return (u8 *)pipeline->uniform_buffer_mapped + pipeline->uniform_buffer_stride * frame_index;
+}
+
+b8 pipeline_set_cull_mode(const pipeline *pipeline,
+                          VkCommandBuffer command_buffer,
+                          VkCullModeFlags cull_mode) {
+    if (!pipeline->dynamic_state) {
+        return false;
+    }
+
+    vkCmdSetCullMode(command_buffer, cull_mode);
+    return true;
+}
+
+b8 pipeline_set_front_face(const pipeline *pipeline,
+                           VkCommandBuffer command_buffer,
+                           VkFrontFace front_face) {
+    if (!pipeline->dynamic_state) {
+        return false;
+    }
+
+    vkCmdSetFrontFace(command_buffer, front_face);
+    return true;
+}
+
+/**
+ * Without dynamicPrimitiveTopologyUnrestricted the topology has to stay within the class (points,
+ * lines, triangles or patches) the pipeline was built with.
+ */
+b8 pipeline_set_topology(const pipeline *pipeline,
+                         VkCommandBuffer command_buffer,
+                         VkPrimitiveTopology topology) {
+    if (!pipeline->dynamic_state ||
+        (!pipeline->unrestricted_topology &&
+         topology_class(topology) != topology_class(pipeline->topology))) {
+        return false;
+    }
+
+    vkCmdSetPrimitiveTopology(command_buffer, topology);
+    return true;
+}
+
+b8 pipeline_set_depth_test(const pipeline *pipeline,
+                           VkCommandBuffer command_buffer,
+                           b8 depth_test,
+                           b8 depth_write) {
+    if (!pipeline->dynamic_state) {
+        return false;
+    }
+
+    vkCmdSetDepthTestEnable(command_buffer, depth_test ? VK_TRUE : VK_FALSE);
+    vkCmdSetDepthWriteEnable(command_buffer, depth_write ? VK_TRUE : VK_FALSE);
+    return true;
+}
+
+b8 pipeline_set_blend_enable(const pipeline *pipeline, VkCommandBuffer command_buffer, b8 value) {
+    if (pipeline->cmd_set_color_blend_enable == NULL) {
+        return false;
+    }
+
+    VkBool32 blend_enable = value ? VK_TRUE : VK_FALSE;
+    pipeline->cmd_set_color_blend_enable(command_buffer, 0, 1, &blend_enable);
+    return true;
 }
 
 void pipeline_destroy(pipeline *pipeline, device *device) {
@@ -391,19 +503,838 @@ void pipeline_destroy(pipeline *pipeline, device *device) {
         vkFreeMemory(device->logical_device, pipeline->uniform_buffer_memory, NULL);
 
         vkDestroyDescriptorPool(device->logical_device, pipeline->descriptor_pool, NULL);
+    }
+
+    release_shared_pipeline(pipeline->registry, pipeline->handle, device);
+
+    *pipeline = (struct pipeline){0};
+}
+
+struct pipeline_registry *pipeline_registry_create(void) {
+    struct pipeline_registry *registry = calloc(1, sizeof(struct pipeline_registry));
+    pthread_mutex_init(&registry->mutex, NULL);
+    registry->libraries = darray_create(pipeline_library);
+    registry->layouts = darray_create(shared_layout);
+    registry->pipelines = darray_create(shared_pipeline);
+
+    return registry;
+}
+
+void pipeline_registry_destroy(struct pipeline_registry *registry, device *device) {
+    if (darray_length(registry->pipelines) != 0) {
+        fprintf(stderr,
+                "%u pipelines were not destroyed before the registry\n",
+                (u32)darray_length(registry->pipelines));
+    }
+
+    for (u32 i = 0; i < darray_length(registry->pipelines); i++) {
+        vkDestroyPipeline(device->logical_device, registry->pipelines[i].handle, NULL);
+        key_destroy(&registry->pipelines[i].key);
+    }
+
+    for (u32 i = 0; i < darray_length(registry->layouts); i++) {
+        vkDestroyPipelineLayout(device->logical_device, registry->layouts[i].layout, NULL);
         vkDestroyDescriptorSetLayout(device->logical_device,
-                                     pipeline->global_descriptor_set_layout,
+                                     registry->layouts[i].descriptor_set_layout,
                                      NULL);
+        key_destroy(&registry->layouts[i].key);
+    }
+
+    for (u32 i = 0; i < darray_length(registry->libraries); i++) {
+        vkDestroyPipeline(device->logical_device, registry->libraries[i].handle, NULL);
+        key_destroy(&registry->libraries[i].key);
     }
 
-    vkDestroyPipeline(device->logical_device, pipeline->handle, NULL);
-    vkDestroyPipelineLayout(device->logical_device, pipeline->layout, NULL);
+    darray_destroy(registry->pipelines);
+    darray_destroy(registry->layouts);
+    darray_destroy(registry->libraries);
+    pthread_mutex_destroy(&registry->mutex);
+    free(registry);
 }
 
 /**************************************************************************************************
  * private functions                                                                              *
  **************************************************************************************************/
 
+static void build_all_batch(u32 start, u32 end, void *work) {
+    build_all_work *build_work = work;
+
+    for (u32 i = start; i < end; i++) {
+        build_work->pipelines[i] = pipeline_builder_build(&build_work->builders[i],
+                                                          build_work->render_pass);
+    }
+}
+
+static b8 acquire_shared_pipeline(struct pipeline_registry *registry,
+                                  const registry_key *key,
+                                  pipeline *out_pipeline) {
+    b8 found = false;
+
+    pthread_mutex_lock(&registry->mutex);
+    for (u32 i = 0; i < darray_length(registry->pipelines); i++) {
+        shared_pipeline *shared = &registry->pipelines[i];
+        if (key_equals(&shared->key, key)) {
+            shared->reference_count++;
+            out_pipeline->handle = shared->handle;
+            out_pipeline->layout = shared->layout;
+            out_pipeline->global_descriptor_set_layout = shared->descriptor_set_layout;
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry->mutex);
+
+    return found;
+}
+
+/**
+ * Registers a freshly created pipeline, taking over the key's bytes. When another thread
+ * published the same key while this one was compiling, the new objects are released and the
+ * published ones are used instead.
+ */
+static void publish_shared_pipeline(struct pipeline_registry *registry,
+                                    registry_key *key,
+                                    pipeline *pipeline,
+                                    device *device) {
+    VkPipeline created = pipeline->handle;
+    VkPipelineLayout created_layout = pipeline->layout;
+    b8 found = false;
+
+    pthread_mutex_lock(&registry->mutex);
+    for (u32 i = 0; i < darray_length(registry->pipelines); i++) {
+        shared_pipeline *shared = &registry->pipelines[i];
+        if (key_equals(&shared->key, key)) {
+            shared->reference_count++;
+            pipeline->handle = shared->handle;
+            pipeline->layout = shared->layout;
+            pipeline->global_descriptor_set_layout = shared->descriptor_set_layout;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        shared_pipeline shared = {
+            .key = *key,
+            .reference_count = 1,
+            .handle = pipeline->handle,
+            .layout = pipeline->layout,
+            .descriptor_set_layout = pipeline->global_descriptor_set_layout,
+        };
+        darray_push(registry->pipelines, shared);
+        *key = (registry_key){0};
+    }
+    pthread_mutex_unlock(&registry->mutex);
+
+    if (found) {
+        vkDestroyPipeline(device->logical_device, created, NULL);
+        release_shared_layout(registry, created_layout, device);
+    }
+}
+
+static void release_shared_pipeline(struct pipeline_registry *registry,
+                                    VkPipeline handle,
+                                    device *device) {
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+
+    pthread_mutex_lock(&registry->mutex);
+    for (u32 i = 0; i < darray_length(registry->pipelines); i++) {
+        shared_pipeline *shared = &registry->pipelines[i];
+        if (shared->handle == handle) {
+            if (--shared->reference_count == 0) {
+                layout = shared->layout;
+                vkDestroyPipeline(device->logical_device, shared->handle, NULL);
+                key_destroy(&shared->key);
+                darray_pop_at(registry->pipelines, i, NULL);
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry->mutex);
+
+    if (layout != VK_NULL_HANDLE) {
+        release_shared_layout(registry, layout, device);
+    }
+}
+
+/**
+ * Layouts are shared on their own key, since pipelines with different shaders often use the same
+ * descriptor set and push constant layout.
+ */
+static void acquire_shared_layout(const pipeline_builder *builder, pipeline *out_pipeline) {
+    struct pipeline_registry *registry = builder->context->pipeline_registry;
+    registry_key key = layout_key(builder);
+
+    pthread_mutex_lock(&registry->mutex);
+
+    for (u32 i = 0; i < darray_length(registry->layouts); i++) {
+        shared_layout *shared = &registry->layouts[i];
+        if (key_equals(&shared->key, &key)) {
+            shared->reference_count++;
+            out_pipeline->layout = shared->layout;
+            out_pipeline->global_descriptor_set_layout = shared->descriptor_set_layout;
+            pthread_mutex_unlock(&registry->mutex);
+            key_destroy(&key);
+            return;
+        }
+    }
+
+    shared_layout shared = {
+        .key = key,
+        .reference_count = 1,
+    };
+
+    if (builder->ubo_size) {
+        VkDescriptorSetLayoutBinding layout_bindings[] = {
+            {
+                .binding = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                .pImmutableSamplers = NULL,
+                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            },
+        };
+
+        VkDescriptorSetLayoutCreateInfo layout_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .bindingCount = sizeof(layout_bindings) / sizeof(layout_bindings[0]),
+            .pBindings = layout_bindings,
+        };
+
+        VK_CHECK(vkCreateDescriptorSetLayout(builder->context->device.logical_device,
+                                             &layout_info,
+                                             NULL,
+                                             &shared.descriptor_set_layout));
+    }
+
+    VkDescriptorSetLayout set_layouts[2];
+    u32 set_layout_count = 0;
+    if (builder->bindless) {
+        set_layouts[set_layout_count++] = builder->context->bindless.layout;
+    }
+    if (builder->ubo_size) {
+        set_layouts[set_layout_count++] = shared.descriptor_set_layout;
+    }
+
+    VkPushConstantRange bindless_push_constant_range = {
+        .stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS,
+        .offset = 0,
+        .size = BINDLESS_PUSH_CONSTANT_SIZE,
+    };
+
+    VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = set_layout_count,
+        .pSetLayouts = set_layouts,
+        .pushConstantRangeCount = darray_length(builder->push_constant_ranges),
+        .pPushConstantRanges = builder->push_constant_ranges,
+    };
+
+    if (builder->bindless) {
+        pipeline_layout_create_info.pushConstantRangeCount = 1;
+        pipeline_layout_create_info.pPushConstantRanges = &bindless_push_constant_range;
+    }
+
+    VK_CHECK(vkCreatePipelineLayout(builder->context->device.logical_device,
+                                    &pipeline_layout_create_info,
+                                    NULL,
+                                    &shared.layout));
+
+    darray_push(registry->layouts, shared);
+
+    pthread_mutex_unlock(&registry->mutex);
+
+    out_pipeline->layout = shared.layout;
+    out_pipeline->global_descriptor_set_layout = shared.descriptor_set_layout;
+}
+
+static void release_shared_layout(struct pipeline_registry *registry,
+                                  VkPipelineLayout layout,
+                                  device *device) {
+    pthread_mutex_lock(&registry->mutex);
+    for (u32 i = 0; i < darray_length(registry->layouts); i++) {
+        shared_layout *shared = &registry->layouts[i];
+        if (shared->layout == layout) {
+            if (--shared->reference_count == 0) {
+                vkDestroyPipelineLayout(device->logical_device, shared->layout, NULL);
+                if (shared->descriptor_set_layout != VK_NULL_HANDLE) {
+                    vkDestroyDescriptorSetLayout(device->logical_device,
+                                                 shared->descriptor_set_layout,
+                                                 NULL);
+                }
+                key_destroy(&shared->key);
+                darray_pop_at(registry->layouts, i, NULL);
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry->mutex);
+}
+
+static void fixed_function_state_init(const pipeline_builder *builder,
+                                      fixed_function_state *state) {
+    *state = (fixed_function_state){
+        .vertex_input =
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+                .vertexBindingDescriptionCount = darray_length(builder->vertex_input_bindings),
+                .pVertexBindingDescriptions = builder->vertex_input_bindings,
+                .vertexAttributeDescriptionCount = darray_length(builder->vertex_input_attributes),
+                .pVertexAttributeDescriptions = builder->vertex_input_attributes,
+            },
+        .input_assembly =
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+                .topology = builder->topology,
+                .primitiveRestartEnable = VK_FALSE,
+            },
+        .viewport =
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+                .viewportCount = 1,
+                .scissorCount = 1,
+            },
+        .rasterization =
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+                .depthClampEnable = VK_FALSE,
+                .rasterizerDiscardEnable = VK_FALSE,
+                .polygonMode = VK_POLYGON_MODE_FILL,
+                .lineWidth = 1.0f,
+                .cullMode = builder->cull_mode,
+                .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+                .depthBiasEnable = VK_FALSE,
+            },
+        .multisample =
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+                .sampleShadingEnable = VK_FALSE,
+                .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+                .minSampleShading = 1.0f,
+            },
+        .color_blend_attachment =
+            {
+                .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                  VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+                .blendEnable = builder->enable_alpha_blending ? VK_TRUE : VK_FALSE,
+                .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+                .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+                .colorBlendOp = VK_BLEND_OP_ADD,
+                .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+                .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+                .alphaBlendOp = VK_BLEND_OP_ADD,
+            },
+        .depth_stencil =
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+                .depthTestEnable = VK_TRUE,
+                .depthWriteEnable = VK_TRUE,
+                .depthCompareOp = VK_COMPARE_OP_LESS,
+                .depthBoundsTestEnable = VK_FALSE,
+                .stencilTestEnable = VK_FALSE,
+            },
+    };
+
+    u32 dynamic_state_count = 0;
+    state->dynamic_states[dynamic_state_count++] = VK_DYNAMIC_STATE_VIEWPORT;
+    state->dynamic_states[dynamic_state_count++] = VK_DYNAMIC_STATE_SCISSOR;
+
+    // NOTE: The baked values above still matter: they are the defaults pipeline_bind applies.
+    if (builder->context->device.supports_extended_dynamic_state) {
+        state->dynamic_states[dynamic_state_count++] = VK_DYNAMIC_STATE_CULL_MODE;
+        state->dynamic_states[dynamic_state_count++] = VK_DYNAMIC_STATE_FRONT_FACE;
+        state->dynamic_states[dynamic_state_count++] = VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY;
+        state->dynamic_states[dynamic_state_count++] = VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE;
+        state->dynamic_states[dynamic_state_count++] = VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE;
+    }
+    if (builder->context->device.supports_dynamic_blend_enable) {
+        state->dynamic_states[dynamic_state_count++] = VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT;
+    }
+
+    state->dynamic = (VkPipelineDynamicStateCreateInfo){
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = dynamic_state_count,
+        .pDynamicStates = state->dynamic_states,
+    };
+
+    state->color_blend = (VkPipelineColorBlendStateCreateInfo){
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable = VK_FALSE,
+        .attachmentCount = 1,
+        .pAttachments = &state->color_blend_attachment,
+    };
+}
+
+static VkPipeline create_monolithic_pipeline(const pipeline_builder *builder,
+                                             const fixed_function_state *state,
+                                             VkPipelineLayout layout,
+                                             VkRenderPass render_pass) {
+    VkDevice device = builder->context->device.logical_device;
+
+    VkPipelineShaderStageCreateInfo shader_stages[] = {
+        create_shader_stage(device,
+                            VK_SHADER_STAGE_VERTEX_BIT,
+                            builder->vertex_shader_code,
+                            builder->vertex_shader_size),
+        create_shader_stage(device,
+                            VK_SHADER_STAGE_FRAGMENT_BIT,
+                            builder->fragment_shader_code,
+                            builder->fragment_shader_size),
+    };
+
+    VkGraphicsPipelineCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .stageCount = sizeof(shader_stages) / sizeof(VkPipelineShaderStageCreateInfo),
+        .pStages = shader_stages,
+        .pVertexInputState = &state->vertex_input,
+        .pInputAssemblyState = &state->input_assembly,
+        .pDynamicState = &state->dynamic,
+        .pViewportState = &state->viewport,
+        .pRasterizationState = &state->rasterization,
+        .pMultisampleState = &state->multisample,
+        .pColorBlendState = &state->color_blend,
+        .pDepthStencilState = &state->depth_stencil,
+        .layout = layout,
+        .renderPass = render_pass,
+        .subpass = 0,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    };
+
+    VkPipelineRenderingCreateInfo rendering_info = rendering_create_info(builder);
+    if (render_pass == VK_NULL_HANDLE) {
+        create_info.pNext = &rendering_info;
+    }
+
+    VkPipelineCreationFeedback creation_feedback = {0};
+    VkPipelineCreationFeedbackCreateInfo creation_feedback_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+        .pNext = create_info.pNext,
+        .pPipelineCreationFeedback = &creation_feedback,
+    };
+
+    if (builder->context->device.properties.apiVersion >= VK_API_VERSION_1_3) {
+        create_info.pNext = &creation_feedback_info;
+    }
+
+    u64 start = timer_now_ns();
+
+    VkPipeline handle;
+    VK_CHECK(vkCreateGraphicsPipelines(device,
+                                       builder->context->pipeline_cache,
+                                       1,
+                                       &create_info,
+                                       NULL,
+                                       &handle));
+
+    report_creation_time(builder->name, "created", timer_elapsed_ms(start), &creation_feedback);
+
+    vkDestroyShaderModule(device, shader_stages[0].module, NULL);
+    vkDestroyShaderModule(device, shader_stages[1].module, NULL);
+
+    return handle;
+}
+
+/**
+ * Links the four graphics pipeline library parts without link time optimization. Each part is
+ * compiled once per distinct state and shared through the registry, so a pipeline that only
+ * differs in, say, its blend state compiles its fragment output part and reuses the rest.
+ */
+static VkPipeline link_pipeline(const pipeline_builder *builder,
+                                const fixed_function_state *state,
+                                VkPipelineLayout layout,
+                                VkRenderPass render_pass) {
+    VkPipeline libraries[] = {
+        get_library_part(builder,
+                         state,
+                         layout,
+                         render_pass,
+                         VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT),
+        get_library_part(builder,
+                         state,
+                         layout,
+                         render_pass,
+                         VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT),
+        get_library_part(builder,
+                         state,
+                         layout,
+                         render_pass,
+                         VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT),
+        get_library_part(builder,
+                         state,
+                         layout,
+                         render_pass,
+                         VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT),
+    };
+
+    VkPipelineLibraryCreateInfoKHR library_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+        .libraryCount = sizeof(libraries) / sizeof(VkPipeline),
+        .pLibraries = libraries,
+    };
+
+    VkPipelineCreationFeedback creation_feedback = {0};
+    VkPipelineCreationFeedbackCreateInfo creation_feedback_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+        .pNext = &library_info,
+        .pPipelineCreationFeedback = &creation_feedback,
+    };
+
+    VkGraphicsPipelineCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = &library_info,
+        .layout = layout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    };
+
+    if (builder->context->device.properties.apiVersion >= VK_API_VERSION_1_3) {
+        create_info.pNext = &creation_feedback_info;
+    }
+
+    u64 start = timer_now_ns();
+
+    VkPipeline handle;
+    VK_CHECK(vkCreateGraphicsPipelines(builder->context->device.logical_device,
+                                       builder->context->pipeline_cache,
+                                       1,
+                                       &create_info,
+                                       NULL,
+                                       &handle));
+
+    report_creation_time(builder->name, "linked", timer_elapsed_ms(start), &creation_feedback);
+
+    return handle;
+}
+
+static VkPipeline get_library_part(const pipeline_builder *builder,
+                                   const fixed_function_state *state,
+                                   VkPipelineLayout layout,
+                                   VkRenderPass render_pass,
+                                   VkGraphicsPipelineLibraryFlagsEXT part) {
+    struct pipeline_registry *registry = builder->context->pipeline_registry;
+    registry_key key = library_part_key(builder, render_pass, part);
+
+    VkPipeline handle = VK_NULL_HANDLE;
+
+    pthread_mutex_lock(&registry->mutex);
+    for (u32 i = 0; i < darray_length(registry->libraries); i++) {
+        if (key_equals(&registry->libraries[i].key, &key)) {
+            handle = registry->libraries[i].handle;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry->mutex);
+
+    if (handle != VK_NULL_HANDLE) {
+        key_destroy(&key);
+        return handle;
+    }
+
+    // NOTE: The part is compiled outside the lock. When two threads race for the same part the
+    // loser destroys its copy and uses the one that was registered first.
+    VkPipeline created = create_library_part(builder, state, layout, render_pass, part);
+
+    pthread_mutex_lock(&registry->mutex);
+    for (u32 i = 0; i < darray_length(registry->libraries); i++) {
+        if (key_equals(&registry->libraries[i].key, &key)) {
+            handle = registry->libraries[i].handle;
+            break;
+        }
+    }
+    if (handle == VK_NULL_HANDLE) {
+        pipeline_library library = {
+            .key = key,
+            .handle = created,
+        };
+        darray_push(registry->libraries, library);
+    }
+    pthread_mutex_unlock(&registry->mutex);
+
+    if (handle != VK_NULL_HANDLE) {
+        vkDestroyPipeline(builder->context->device.logical_device, created, NULL);
+        key_destroy(&key);
+        return handle;
+    }
+
+    return created;
+}
+
+static VkPipeline create_library_part(const pipeline_builder *builder,
+                                      const fixed_function_state *state,
+                                      VkPipelineLayout layout,
+                                      VkRenderPass render_pass,
+                                      VkGraphicsPipelineLibraryFlagsEXT part) {
+    VkDevice device = builder->context->device.logical_device;
+
+    VkPipelineRenderingCreateInfo rendering_info = rendering_create_info(builder);
+
+    // NOTE: Every part but the vertex input interface depends on the attachments.
+    VkGraphicsPipelineLibraryCreateInfoEXT library_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+        .pNext = render_pass == VK_NULL_HANDLE &&
+                         part != VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT
+                     ? &rendering_info
+                     : NULL,
+        .flags = part,
+    };
+
+    VkGraphicsPipelineCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = &library_info,
+        .flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR,
+        .pDynamicState = &state->dynamic,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    };
+
+    VkPipelineShaderStageCreateInfo shader_stage = {0};
+
+    switch (part) {
+    case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+        create_info.pVertexInputState = &state->vertex_input;
+        create_info.pInputAssemblyState = &state->input_assembly;
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+        shader_stage = create_shader_stage(device,
+                                           VK_SHADER_STAGE_VERTEX_BIT,
+                                           builder->vertex_shader_code,
+                                           builder->vertex_shader_size);
+        create_info.stageCount = 1;
+        create_info.pStages = &shader_stage;
+        create_info.pViewportState = &state->viewport;
+        create_info.pRasterizationState = &state->rasterization;
+        create_info.layout = layout;
+        create_info.renderPass = render_pass;
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+        shader_stage = create_shader_stage(device,
+                                           VK_SHADER_STAGE_FRAGMENT_BIT,
+                                           builder->fragment_shader_code,
+                                           builder->fragment_shader_size);
+        create_info.stageCount = 1;
+        create_info.pStages = &shader_stage;
+        create_info.pMultisampleState = &state->multisample;
+        create_info.pDepthStencilState = &state->depth_stencil;
+        create_info.layout = layout;
+        create_info.renderPass = render_pass;
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT:
+        create_info.pMultisampleState = &state->multisample;
+        create_info.pColorBlendState = &state->color_blend;
+        create_info.renderPass = render_pass;
+        break;
+    }
+
+    VkPipeline handle;
+    VK_CHECK(vkCreateGraphicsPipelines(device,
+                                       builder->context->pipeline_cache,
+                                       1,
+                                       &create_info,
+                                       NULL,
+                                       &handle));
+
+    if (shader_stage.module != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(device, shader_stage.module, NULL);
+    }
+
+    return handle;
+}
+
+/**
+ * Hashes exactly the builder state that the given part consumes. Both shader parts include the
+ * pipeline layout description, since linking requires identically defined layouts. State that is
+ * set dynamically is left out, so its variants share one part.
+ */
+static registry_key library_part_key(const pipeline_builder *builder,
+                                     VkRenderPass render_pass,
+                                     VkGraphicsPipelineLibraryFlagsEXT part) {
+    registry_key key = {.hash = FNV_OFFSET_BASIS};
+    key_append(&key, &part, sizeof(part));
+
+    b8 dynamic_state = builder->context->device.supports_extended_dynamic_state;
+
+    switch (part) {
+    case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+        key_append(&key,
+                   builder->vertex_input_bindings,
+                   darray_length(builder->vertex_input_bindings) *
+                       sizeof(VkVertexInputBindingDescription));
+        key_append(&key,
+                   builder->vertex_input_attributes,
+                   darray_length(builder->vertex_input_attributes) *
+                       sizeof(VkVertexInputAttributeDescription));
+        if (dynamic_state) {
+            u32 class = topology_class(builder->topology);
+            key_append(&key, &class, sizeof(class));
+        } else {
+            key_append(&key, &builder->topology, sizeof(builder->topology));
+        }
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+        key_append(&key, builder->vertex_shader_code, builder->vertex_shader_size);
+        if (!dynamic_state) {
+            key_append(&key, &builder->cull_mode, sizeof(builder->cull_mode));
+        }
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+        key_append(&key, builder->fragment_shader_code, builder->fragment_shader_size);
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT:
+        if (!builder->context->device.supports_dynamic_blend_enable) {
+            key_append(&key,
+                       &builder->enable_alpha_blending,
+                       sizeof(builder->enable_alpha_blending));
+        }
+        break;
+    }
+
+    if (part == VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT ||
+        part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT) {
+        key_append_layout(&key, builder);
+    }
+
+    if (part != VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT) {
+        key_append(&key, &render_pass, sizeof(render_pass));
+        if (render_pass == VK_NULL_HANDLE) {
+            key_append(&key, &builder->color_format, sizeof(builder->color_format));
+            key_append(&key, &builder->depth_format, sizeof(builder->depth_format));
+        }
+    }
+
+    return key;
+}
+
+/**
+ * Hashes everything that ends up in the VkPipeline. Like the library part keys it leaves out
+ * dynamic state, whose per-pipeline defaults live in the pipeline struct instead.
+ */
+static registry_key pipeline_key(const pipeline_builder *builder, VkRenderPass render_pass) {
+    registry_key key = {.hash = FNV_OFFSET_BASIS};
+    b8 dynamic_state = builder->context->device.supports_extended_dynamic_state;
+
+    key_append(&key, builder->vertex_shader_code, builder->vertex_shader_size);
+    key_append(&key, builder->fragment_shader_code, builder->fragment_shader_size);
+    key_append(&key,
+               builder->vertex_input_bindings,
+               darray_length(builder->vertex_input_bindings) *
+                   sizeof(VkVertexInputBindingDescription));
+    key_append(&key,
+               builder->vertex_input_attributes,
+               darray_length(builder->vertex_input_attributes) *
+                   sizeof(VkVertexInputAttributeDescription));
+
+    key_append_layout(&key, builder);
+
+    if (dynamic_state) {
+        u32 class = topology_class(builder->topology);
+        key_append(&key, &class, sizeof(class));
+    } else {
+        key_append(&key, &builder->topology, sizeof(builder->topology));
+        key_append(&key, &builder->cull_mode, sizeof(builder->cull_mode));
+    }
+
+    if (!builder->context->device.supports_dynamic_blend_enable) {
+        key_append(&key, &builder->enable_alpha_blending, sizeof(builder->enable_alpha_blending));
+    }
+
+    key_append(&key, &render_pass, sizeof(render_pass));
+    if (render_pass == VK_NULL_HANDLE) {
+        key_append(&key, &builder->color_format, sizeof(builder->color_format));
+        key_append(&key, &builder->depth_format, sizeof(builder->depth_format));
+    }
+
+    return key;
+}
+
+static registry_key layout_key(const pipeline_builder *builder) {
+    registry_key key = {.hash = FNV_OFFSET_BASIS};
+    key_append_layout(&key, builder);
+
+    return key;
+}
+
+static void key_append_layout(registry_key *key, const pipeline_builder *builder) {
+    b8 has_ubo = builder->ubo_size != 0;
+
+    key_append(key, &has_ubo, sizeof(has_ubo));
+    key_append(key, &builder->bindless, sizeof(builder->bindless));
+    if (!builder->bindless) {
+        key_append(key,
+                   builder->push_constant_ranges,
+                   darray_length(builder->push_constant_ranges) * sizeof(VkPushConstantRange));
+    }
+}
+
+// NOTE: Points into the builder, which has to outlive the create call it is chained into.
+static VkPipelineRenderingCreateInfo rendering_create_info(const pipeline_builder *builder) {
+    return (VkPipelineRenderingCreateInfo){
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &builder->color_format,
+        .depthAttachmentFormat = builder->depth_format,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+    };
+}
+
+static void key_append(registry_key *key, const void *data, u64 size) {
+    const u8 *bytes = data;
+    for (u64 i = 0; i < size; i++) {
+        key->hash ^= bytes[i];
+        key->hash *= FNV_PRIME;
+    }
+
+    if (size == 0) {
+        return;
+    }
+
+    if (key->size + size > key->capacity) {
+        key->capacity = key->capacity * 2 > key->size + size ? key->capacity * 2 : key->size + size;
+        key->bytes = realloc(key->bytes, key->capacity);
+    }
+    memcpy(key->bytes + key->size, data, size);
+    key->size += size;
+}
+
+static b8 key_equals(const registry_key *a, const registry_key *b) {
+    return a->hash == b->hash && a->size == b->size &&
+           (a->size == 0 || memcmp(a->bytes, b->bytes, a->size) == 0);
+}
+
+static void key_destroy(registry_key *key) {
+    free(key->bytes);
+    *key = (registry_key){0};
+}
+
+static u32 topology_class(VkPrimitiveTopology topology) {
+    switch (topology) {
+    case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+        return 0;
+    case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+        return 1;
+    case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+        return 3;
+    default:
+        return 2;
+    }
+}
+
+static VkPipelineShaderStageCreateInfo create_shader_stage(VkDevice device,
+                                                           VkShaderStageFlagBits stage,
+                                                           const u32 *code,
+                                                           u64 code_size) {
+    VkPipelineShaderStageCreateInfo shader_stage = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage = stage,
+        .module = create_shader_module(device, code, code_size),
+        .pName = "main",
+    };
+
+    return shader_stage;
+}
+
 static VkShaderModule create_shader_module(VkDevice device, const u32 *code, u64 code_size) {
     VkShaderModuleCreateInfo create_info = {
         .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
@@ -438,3 +1369,22 @@ static u32 *read_file(const char *file_name, u64 *out_size) {
     fclose(fp);
     return buffer;
 }
+
+static void report_creation_time(const char *name,
+                                 const char *action,
+                                 f64 elapsed_ms,
+                                 const VkPipelineCreationFeedback *feedback) {
+    const char *cache_result = "unknown";
+    if (feedback->flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) {
+        cache_result =
+            feedback->flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT
+                ? "hit"
+                : "miss";
+    }
+
+    printf("Pipeline '%s' %s in %.2f ms (cache %s).\n",
+           name ? name : "unnamed",
+           action,
+           elapsed_ms,
+           cache_result);
+}
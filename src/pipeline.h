@@ -21,17 +21,61 @@ void pipeline_builder_add_input_attribute(pipeline_builder *builder,
                                           VkFormat format,
                                           u32 offset);
 void pipeline_builder_set_ubo_size(pipeline_builder *builder, u64 ubo_size);
+void pipeline_builder_use_bindless(pipeline_builder *builder);
 void pipeline_builder_set_topology(pipeline_builder *builder, VkPrimitiveTopology topology);
 void pipeline_builder_set_cull_mode(pipeline_builder *builder, VkCullModeFlags cull_mode);
 void pipeline_builder_set_alpha_blending(pipeline_builder *builder, b8 value);
+// NOTE: Defaults to the swapchain's color format and the device's depth format.
+void pipeline_builder_set_attachment_formats(pipeline_builder *builder,
+                                             VkFormat color_format,
+                                             VkFormat depth_format);
 void pipeline_builder_add_push_constant(pipeline_builder *builder,
                                         VkShaderStageFlagBits shader_stage,
                                         u32 size);
 
+/**
+ * A render_pass of VK_NULL_HANDLE builds the pipeline for dynamic rendering with the builder's
+ * attachment formats, which is what context->render_pass holds when the device supports it.
+ */
 pipeline pipeline_builder_build(pipeline_builder *builder, VkRenderPass render_pass);
+void pipeline_builder_build_all(pipeline_builder *builders,
+                                u32 count,
+                                VkRenderPass render_pass,
+                                pipeline *out_pipelines);
 
 void pipeline_bind(const pipeline *pipeline, VkCommandBuffer command_buffer, u32 frame_index);
+/**
+ * The persistently mapped uniforms of the frame, which the descriptor set pipeline_bind binds for
+ * frame_index reads. Host coherent, so writes only need to happen before the frame is submitted.
+ */
+void *pipeline_uniform_slot(const pipeline *pipeline, u32 frame_index);
+
+/**
+ * Override state of the bound pipeline while recording. Each returns false when the device could
+ * not make the state dynamic, in which case the value baked into the pipeline stays in effect.
+ */
+b8 pipeline_set_cull_mode(const pipeline *pipeline,
+                          VkCommandBuffer command_buffer,
+                          VkCullModeFlags cull_mode);
+b8 pipeline_set_front_face(const pipeline *pipeline,
+                           VkCommandBuffer command_buffer,
+                           VkFrontFace front_face);
+b8 pipeline_set_topology(const pipeline *pipeline,
+                         VkCommandBuffer command_buffer,
+                         VkPrimitiveTopology topology);
+b8 pipeline_set_depth_test(const pipeline *pipeline,
+                           VkCommandBuffer command_buffer,
+                           b8 depth_test,
+                           b8 depth_write);
+b8 pipeline_set_blend_enable(const pipeline *pipeline, VkCommandBuffer command_buffer, b8 value);
 
 void pipeline_destroy(pipeline *pipeline, device *device);
 
+/**
+ * Owns the pipeline objects shared between pipelines, such as the graphics pipeline library parts
+ * that are linked into complete pipelines. Safe to use from several build threads at once.
+ */
+struct pipeline_registry *pipeline_registry_create(void);
+void pipeline_registry_destroy(struct pipeline_registry *registry, device *device);
+
 #endif // PIPELINE_H
@@ -0,0 +1,144 @@
+#include "pipeline_cache.h"
+
+#include "profiler.h"
+#include "timer.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void *read_cache_file(const char *file_name, u64 *out_size);
+static b8 cache_header_matches(const device *device, const void *data, u64 size);
+static b8 write_cache_file(const char *file_name, const void *data, u64 size);
+
+void pipeline_cache_create(context *context, const char *file_name) {
+    PROFILE_FUNCTION();
+
+    u64 start = timer_now_ns();
+
+    u64 initial_data_size = 0;
+    void *initial_data = read_cache_file(file_name, &initial_data_size);
+
+    if (initial_data && !cache_header_matches(&context->device, initial_data, initial_data_size)) {
+        printf("Pipeline cache '%s' was created by a different device or driver, ignoring it.\n",
+               file_name);
+        free(initial_data);
+        initial_data = NULL;
+        initial_data_size = 0;
+    }
+
+    VkPipelineCacheCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = initial_data_size,
+        .pInitialData = initial_data,
+    };
+
+    VK_CHECK(vkCreatePipelineCache(context->device.logical_device,
+                                   &create_info,
+                                   NULL,
+                                   &context->pipeline_cache));
+
+    free(initial_data);
+
+    if (initial_data_size) {
+        printf("Pipeline cache loaded %llu bytes from '%s' in %.2f ms.\n",
+               initial_data_size,
+               file_name,
+               timer_elapsed_ms(start));
+    } else {
+        printf("Pipeline cache is empty, pipelines will be compiled from scratch.\n");
+    }
+}
+
+void pipeline_cache_destroy(context *context, const char *file_name) {
+    size_t size = 0;
+    VK_CHECK(vkGetPipelineCacheData(context->device.logical_device,
+                                    context->pipeline_cache,
+                                    &size,
+                                    NULL));
+
+    void *data = malloc(size);
+    VK_CHECK(vkGetPipelineCacheData(context->device.logical_device,
+                                    context->pipeline_cache,
+                                    &size,
+                                    data));
+
+    if (write_cache_file(file_name, data, size)) {
+        printf("Pipeline cache saved %zu bytes to '%s'.\n", size, file_name);
+    }
+
+    free(data);
+
+    vkDestroyPipelineCache(context->device.logical_device, context->pipeline_cache, NULL);
+    context->pipeline_cache = VK_NULL_HANDLE;
+}
+
+static void *read_cache_file(const char *file_name, u64 *out_size) {
+    *out_size = 0;
+
+    FILE *fp = fopen(file_name, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    u64 size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    void *buffer = malloc(size);
+    if (fread(buffer, sizeof(char), size, fp) != size) {
+        fprintf(stderr, "Failed to read whole file: %s\n", file_name);
+        free(buffer);
+        fclose(fp);
+        return NULL;
+    }
+
+    fclose(fp);
+    *out_size = size;
+    return buffer;
+}
+
+static b8 cache_header_matches(const device *device, const void *data, u64 size) {
+    VkPipelineCacheHeaderVersionOne header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    return header.headerSize >= sizeof(header) && header.headerSize <= size &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == device->properties.vendorID &&
+           header.deviceID == device->properties.deviceID &&
+           memcmp(header.pipelineCacheUUID, device->properties.pipelineCacheUUID, VK_UUID_SIZE) ==
+               0;
+}
+
+/**
+ * Writes to a temporary file first and renames it over the old cache, so a crash mid-write never
+ * leaves a truncated cache behind.
+ */
+static b8 write_cache_file(const char *file_name, const void *data, u64 size) {
+    u64 temp_name_length = strlen(file_name) + sizeof(".tmp");
+    char temp_name[temp_name_length];
+    snprintf(temp_name, temp_name_length, "%s.tmp", file_name);
+
+    FILE *fp = fopen(temp_name, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "Failed to open file: %s\n", temp_name);
+        return false;
+    }
+
+    b8 written = fwrite(data, sizeof(char), size, fp) == size;
+    written = written && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    fclose(fp);
+
+    if (!written || rename(temp_name, file_name) != 0) {
+        fprintf(stderr, "Failed to write pipeline cache: %s\n", file_name);
+        remove(temp_name);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,9 @@
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#include "types.h"
+
+void pipeline_cache_create(context *context, const char *file_name);
+void pipeline_cache_destroy(context *context, const char *file_name);
+
+#endif // PIPELINE_CACHE_H
@@ -0,0 +1,219 @@
+#include "profiler.h"
+
+#include "timer.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PROFILE_MAX_THREADS 256
+
+typedef struct {
+    const char *name;
+    u64 begin_ns;
+    u64 end_ns;
+    u32 thread_id;
+} profile_event;
+
+/**
+ * Written only by the thread it is handed to; readers copy the events below head and drop any
+ * that were overwritten while they copied. Rings of exited threads are handed to new threads.
+ */
+typedef struct profile_ring {
+    struct profile_ring *next;
+    atomic_bool in_use;
+    u32 thread_id;
+
+    atomic_ullong head;
+    profile_event events[PROFILE_RING_CAPACITY];
+} profile_ring;
+
+static _Atomic(profile_ring *) rings = NULL;
+static atomic_uint next_thread_id = 0;
+static _Atomic(const char *) thread_names[PROFILE_MAX_THREADS];
+
+static _Thread_local profile_ring *thread_ring = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+static profile_ring *this_ring(void);
+static profile_ring *acquire_ring(void);
+static void create_ring_key(void);
+static void release_ring(void *ring);
+static u64 copy_events(profile_ring *ring, profile_event *events);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+profile_zone profile_zone_begin(const char *name) {
+    return (profile_zone){
+        .name = name,
+        .begin_ns = timer_now_ns(),
+    };
+}
+
+void profile_zone_end(profile_zone *zone) {
+    u64 end_ns = timer_now_ns();
+
+    // NOTE: A zone inside a job may begin and end on different threads when its fiber yields.
+    // It is recorded by the thread that ends it.
+    profile_ring *ring = this_ring();
+    u64 head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    ring->events[head % PROFILE_RING_CAPACITY] = (profile_event){
+        .name = zone->name,
+        .begin_ns = zone->begin_ns,
+        .end_ns = end_ns,
+        .thread_id = ring->thread_id,
+    };
+
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void profile_set_thread_name(const char *name) {
+    u32 thread_id = this_ring()->thread_id;
+    if (thread_id < PROFILE_MAX_THREADS) {
+        atomic_store_explicit(&thread_names[thread_id], name, memory_order_release);
+    }
+}
+
+b8 profile_write_trace(const char *file_name) {
+    FILE *fp = fopen(file_name, "w");
+    if (!fp) {
+        fprintf(stderr, "Unable to open %s\n", file_name);
+        return false;
+    }
+
+    profile_event *events = malloc(sizeof(profile_event) * PROFILE_RING_CAPACITY);
+
+    fprintf(fp, "{\"traceEvents\":[\n");
+    b8 first_event = true;
+
+    u32 thread_count = atomic_load_explicit(&next_thread_id, memory_order_acquire);
+    for (u32 i = 0; i < thread_count && i < PROFILE_MAX_THREADS; i++) {
+        const char *name = atomic_load_explicit(&thread_names[i], memory_order_acquire);
+        if (name == NULL) {
+            continue;
+        }
+
+        fprintf(fp,
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,"
+                "\"args\":{\"name\":\"%s\"}}",
+                first_event ? "" : ",\n",
+                i,
+                name);
+        first_event = false;
+    }
+
+    u64 event_count = 0;
+    for (profile_ring *ring = atomic_load_explicit(&rings, memory_order_acquire); ring != NULL;
+         ring = ring->next) {
+        u64 count = copy_events(ring, events);
+
+        for (u64 i = 0; i < count; i++) {
+            fprintf(fp,
+                    "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,"
+                    "\"dur\":%.3f}",
+                    first_event ? "" : ",\n",
+                    events[i].name,
+                    events[i].thread_id,
+                    (f64)events[i].begin_ns / 1000.0,
+                    (f64)(events[i].end_ns - events[i].begin_ns) / 1000.0);
+            first_event = false;
+        }
+
+        event_count += count;
+    }
+
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    free(events);
+
+    printf("Wrote %llu CPU zones to %s\n", event_count, file_name);
+    return true;
+}
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+// NOTE: Never inlined, so a fiber that resumed on another thread reads that thread's ring instead
+// of a thread-local address the compiler cached from before the switch.
+__attribute__((noinline)) static profile_ring *this_ring(void) {
+    if (thread_ring == NULL) {
+        thread_ring = acquire_ring();
+    }
+
+    return thread_ring;
+}
+
+static profile_ring *acquire_ring(void) {
+    pthread_once(&ring_key_once, create_ring_key);
+
+    profile_ring *ring = atomic_load_explicit(&rings, memory_order_acquire);
+    for (; ring != NULL; ring = ring->next) {
+        b8 expected = false;
+        if (atomic_compare_exchange_strong(&ring->in_use, &expected, true)) {
+            break;
+        }
+    }
+
+    if (ring == NULL) {
+        ring = calloc(1, sizeof(profile_ring));
+        atomic_init(&ring->in_use, true);
+        atomic_init(&ring->head, 0);
+
+        ring->next = atomic_load_explicit(&rings, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&rings,
+                                                      &ring->next,
+                                                      ring,
+                                                      memory_order_release,
+                                                      memory_order_relaxed)) {
+        }
+    }
+
+    // NOTE: A reused ring keeps the previous thread's events, which keep their own thread id.
+    ring->thread_id = atomic_fetch_add_explicit(&next_thread_id, 1, memory_order_relaxed);
+    pthread_setspecific(ring_key, ring);
+
+    return ring;
+}
+
+static void create_ring_key(void) { pthread_key_create(&ring_key, release_ring); }
+
+static void release_ring(void *ring) {
+    atomic_store_explicit(&((profile_ring *)ring)->in_use, false, memory_order_release);
+}
+
+/**
+ * @returns the number of events copied, oldest first.
+ */
+static u64 copy_events(profile_ring *ring, profile_event *events) {
+    u64 head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    u64 first = head > PROFILE_RING_CAPACITY ? head - PROFILE_RING_CAPACITY : 0;
+
+    for (u64 i = first; i < head; i++) {
+        events[i - first] = ring->events[i % PROFILE_RING_CAPACITY];
+    }
+
+    // NOTE: Events the owner wrote over while they were being copied are dropped. The owner
+    // writes the slot of new_head before publishing new_head + 1, so that slot may be torn too.
+    u64 new_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    u64 valid_first =
+        new_head + 1 > PROFILE_RING_CAPACITY ? new_head + 1 - PROFILE_RING_CAPACITY : 0;
+    if (valid_first <= first) {
+        return head - first;
+    }
+    if (valid_first >= head) {
+        return 0;
+    }
+
+    u64 dropped = valid_first - first;
+    for (u64 i = 0; i < head - valid_first; i++) {
+        events[i] = events[i + dropped];
+    }
+
+    return head - valid_first;
+}
@@ -0,0 +1,64 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "defines.h"
+
+// NOTE: Zones are recorded in debug builds, and in release builds configured with
+// ENABLE_PROFILING. Otherwise every PROFILE_ macro compiles to nothing.
+#if !defined(NDEBUG) || defined(PROFILE_ENABLE)
+#define PROFILE_ENABLED 1
+#else
+#define PROFILE_ENABLED 0
+#endif
+
+// NOTE: Zones each thread keeps before the oldest are overwritten.
+#define PROFILE_RING_CAPACITY (1 << 16)
+
+typedef struct {
+    const char *name;
+    u64 begin_ns;
+} profile_zone;
+
+/**
+ * Every thread records its zones into its own ring buffer, registered on first use, so recording
+ * never takes a lock or touches another thread's memory. Zone names must be string literals or
+ * otherwise outlive the profiler.
+ */
+profile_zone profile_zone_begin(const char *name);
+void profile_zone_end(profile_zone *zone);
+
+void profile_set_thread_name(const char *name);
+
+/**
+ * Writes every zone still held by the rings in the Chrome trace event format, loadable in
+ * chrome://tracing or Perfetto. Safe to call while other threads keep recording.
+ */
+b8 profile_write_trace(const char *file_name);
+
+#if PROFILE_ENABLED
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// NOTE: The zone ends when the enclosing block is left, however it is left.
+#define PROFILE_SCOPE(name)                                                                        \
+    profile_zone PROFILE_CONCAT(profile_zone_, __LINE__)                                           \
+        __attribute__((cleanup(profile_zone_end))) = profile_zone_begin(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+
+#define PROFILE_BEGIN(zone, name) profile_zone zone = profile_zone_begin(name)
+#define PROFILE_END(zone) profile_zone_end(&zone)
+
+#define PROFILE_THREAD_NAME(name) profile_set_thread_name(name)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_BEGIN(zone, name)
+#define PROFILE_END(zone)
+#define PROFILE_THREAD_NAME(name)
+
+#endif
+
+#endif // PROFILER_H
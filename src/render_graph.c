@@ -0,0 +1,1401 @@
+#include "render_graph.h"
+
+#include "darray.h"
+#include "deletion_queue.h"
+#include "gpu_profiler.h"
+#include "profiler.h"
+
+#include <string.h>
+
+// NOTE: Color attachments plus depth.
+#define MAX_ATTACHMENTS (RENDER_GRAPH_MAX_COLOR_ATTACHMENTS + 1)
+
+#define WRITE_ACCESS                                                                               \
+    (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |                           \
+     VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |                 \
+     VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT)
+
+typedef enum {
+    RESOURCE_KIND_IMAGE,
+    RESOURCE_KIND_BUFFER,
+} resource_kind;
+
+typedef enum {
+    USE_COLOR_ATTACHMENT,
+    USE_DEPTH_ATTACHMENT,
+    USE_ACCESS,
+} use_kind;
+
+typedef struct {
+    u32 pass;
+    u32 resource;
+    use_kind kind;
+    render_graph_access access;
+    b8 clear;
+    VkClearValue clear_value;
+} resource_use;
+
+// NOTE: How a use touches its resource, derived from the use and the type of its pass.
+typedef struct {
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageLayout layout;
+    VkImageUsageFlags usage;
+    b8 write;
+    // NOTE: Whether the previous contents matter, only cleared attachments discard them.
+    b8 read;
+} use_info;
+
+typedef struct {
+    const char *name;
+    resource_kind kind;
+    b8 transient;
+    b8 output;
+
+    VkImage image;
+    VkImageView view;
+    render_graph_image_desc desc;
+    VkImageLayout final_layout;
+    VkImageUsageFlags usage;
+
+    VkBuffer buffer;
+
+    // NOTE: Synchronization state while executing. Stages and writes of the last writer, which
+    // later uses wait for, and the stages that read it since, which later writes wait for.
+    VkImageLayout layout;
+    VkPipelineStageFlags write_stages;
+    VkAccessFlags write_access;
+    VkPipelineStageFlags read_stages;
+    VkAccessFlags read_access;
+
+    b8 needed;
+    // NOTE: First and last live pass using it, RENDER_GRAPH_NONE when no live pass does.
+    u32 first_pass;
+    u32 last_pass;
+    u32 block;
+} graph_resource;
+
+typedef struct {
+    const char *name;
+    render_graph_pass_type type;
+    render_graph_pass_fn fn;
+    void *user_data;
+    b8 live;
+} graph_pass;
+
+/**
+ * Device memory shared by transient images whose lifetimes do not overlap, one at a time at
+ * offset 0. Kept across frames together with the stages its last occupant used, which the next
+ * occupant's first barrier waits for.
+ */
+typedef struct {
+    // NOTE: VK_NULL_HANDLE once released, the slot is reused by the next block.
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    u32 memory_type;
+
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+
+    // NOTE: Last pass of the block's current occupant this frame, RENDER_GRAPH_NONE while free.
+    u32 busy_until;
+    u64 last_used_frame;
+} memory_block;
+
+typedef struct {
+    render_graph_image_desc desc;
+    VkImageUsageFlags usage;
+    u32 block;
+
+    VkImage image;
+    VkImageView view;
+    u64 last_used_frame;
+} transient_image;
+
+typedef struct {
+    render_graph_image_desc desc;
+    VkImageUsageFlags usage;
+    VkMemoryRequirements requirements;
+} image_requirements;
+
+// NOTE: Zeroed before being filled in, so keys compare with memcmp.
+typedef struct {
+    u32 attachment_count;
+    b8 has_depth;
+    VkFormat formats[MAX_ATTACHMENTS];
+    VkAttachmentLoadOp load_ops[MAX_ATTACHMENTS];
+    VkAttachmentStoreOp store_ops[MAX_ATTACHMENTS];
+} render_pass_key;
+
+typedef struct {
+    render_pass_key key;
+    VkRenderPass handle;
+} cached_render_pass;
+
+typedef struct {
+    VkRenderPass render_pass;
+    u32 attachment_count;
+    VkImageView views[MAX_ATTACHMENTS];
+    VkExtent2D extent;
+} framebuffer_key;
+
+typedef struct {
+    framebuffer_key key;
+    VkFramebuffer handle;
+    u64 last_used_frame;
+} cached_framebuffer;
+
+typedef struct {
+    VkPipelineStageFlags src_stages;
+    VkPipelineStageFlags dst_stages;
+    VkMemoryBarrier memory;
+    VkImageMemoryBarrier *images; // darray
+} barrier_batch;
+
+struct render_graph {
+    graph_resource *resources; // darray
+    graph_pass *passes;        // darray
+    resource_use *uses;        // darray
+
+    memory_block *blocks;                 // darray
+    transient_image *images;              // darray
+    image_requirements *requirements;     // darray
+    cached_render_pass *render_passes;    // darray
+    cached_framebuffer *framebuffers;     // darray
+    VkImageMemoryBarrier *image_barriers; // darray
+
+    u64 frame;
+    render_graph_stats stats;
+
+    // NOTE: The graphics pass being executed, for render_graph_pass_inheritance.
+    b8 dynamic_rendering;
+    u32 color_count;
+    VkFormat color_formats[RENDER_GRAPH_MAX_COLOR_ATTACHMENTS];
+    VkFormat depth_format;
+    VkExtent2D extent;
+    VkRenderPass render_pass;
+    VkFramebuffer framebuffer;
+};
+
+static graph_resource *get_resource(struct render_graph *graph, u32 resource);
+static graph_pass *get_pass(struct render_graph *graph, u32 pass);
+static void add_use(struct render_graph *graph, resource_use use);
+static use_info get_use_info(const resource_use *use, render_graph_pass_type type);
+static VkPipelineStageFlags shader_stages(render_graph_pass_type type);
+static b8 is_graphics(render_graph_pass_type type);
+static void cull_passes(struct render_graph *graph);
+static void compute_lifetimes(struct render_graph *graph);
+static void allocate_transients(struct render_graph *graph, const context *context);
+static VkMemoryRequirements get_image_requirements(struct render_graph *graph,
+                                                   const context *context,
+                                                   const render_graph_image_desc *desc,
+                                                   VkImageUsageFlags usage);
+static u32 allocate_block(struct render_graph *graph,
+                          const context *context,
+                          const VkMemoryRequirements *requirements);
+static transient_image *acquire_image(struct render_graph *graph,
+                                      const context *context,
+                                      const graph_resource *resource,
+                                      u32 block);
+static VkImage create_image(VkDevice device,
+                            const render_graph_image_desc *desc,
+                            VkImageUsageFlags usage);
+static void execute_pass(struct render_graph *graph,
+                         const context *context,
+                         VkCommandBuffer command_buffer,
+                         u32 pass);
+static void add_barrier(graph_resource *resource, const use_info *info, barrier_batch *batch);
+static void flush_barriers(struct render_graph *graph,
+                           VkCommandBuffer command_buffer,
+                           barrier_batch *batch);
+static void transition_to_final_layouts(struct render_graph *graph,
+                                        VkCommandBuffer command_buffer);
+static void begin_rendering(struct render_graph *graph,
+                            const context *context,
+                            VkCommandBuffer command_buffer,
+                            u32 pass);
+static VkAttachmentStoreOp store_op(const graph_resource *resource, u32 pass);
+static VkRenderPass get_render_pass(struct render_graph *graph,
+                                    const context *context,
+                                    const render_pass_key *key);
+static VkFramebuffer get_framebuffer(struct render_graph *graph,
+                                     const context *context,
+                                     const framebuffer_key *key);
+static void retire_unused(struct render_graph *graph, const context *context);
+static void retire_framebuffers(struct render_graph *graph, const context *context);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+struct render_graph *render_graph_create(void) {
+    struct render_graph *graph = calloc(1, sizeof(struct render_graph));
+    graph->resources = darray_create(graph_resource);
+    graph->passes = darray_create(graph_pass);
+    graph->uses = darray_create(resource_use);
+    graph->blocks = darray_create(memory_block);
+    graph->images = darray_create(transient_image);
+    graph->requirements = darray_create(image_requirements);
+    graph->render_passes = darray_create(cached_render_pass);
+    graph->framebuffers = darray_create(cached_framebuffer);
+    graph->image_barriers = darray_create(VkImageMemoryBarrier);
+
+    return graph;
+}
+
+void render_graph_destroy(struct render_graph *graph, context *context) {
+    VkDevice device = context->device.logical_device;
+
+    for (u64 i = 0; i < darray_length(graph->framebuffers); i++) {
+        vkDestroyFramebuffer(device, graph->framebuffers[i].handle, NULL);
+    }
+    for (u64 i = 0; i < darray_length(graph->render_passes); i++) {
+        vkDestroyRenderPass(device, graph->render_passes[i].handle, NULL);
+    }
+    for (u64 i = 0; i < darray_length(graph->images); i++) {
+        vkDestroyImageView(device, graph->images[i].view, NULL);
+        vkDestroyImage(device, graph->images[i].image, NULL);
+    }
+    for (u64 i = 0; i < darray_length(graph->blocks); i++) {
+        vkFreeMemory(device, graph->blocks[i].memory, NULL);
+    }
+
+    darray_destroy(graph->resources);
+    darray_destroy(graph->passes);
+    darray_destroy(graph->uses);
+    darray_destroy(graph->blocks);
+    darray_destroy(graph->images);
+    darray_destroy(graph->requirements);
+    darray_destroy(graph->render_passes);
+    darray_destroy(graph->framebuffers);
+    darray_destroy(graph->image_barriers);
+
+    free(graph);
+}
+
+void render_graph_begin(struct render_graph *graph) {
+    darray_clear(graph->resources);
+    darray_clear(graph->passes);
+    darray_clear(graph->uses);
+}
+
+u32 render_graph_import_image(struct render_graph *graph,
+                              const char *name,
+                              const render_graph_image_import *import) {
+    graph_resource resource = {
+        .name = name,
+        .kind = RESOURCE_KIND_IMAGE,
+        .output = import->output,
+        .image = import->image,
+        .view = import->view,
+        .desc =
+            {
+                .format = import->format,
+                .extent = import->extent,
+                .aspect = import->aspect,
+            },
+        .final_layout = import->final_layout,
+        .layout = import->initial_layout,
+        .write_stages = import->initial_stages,
+        .write_access = import->initial_access,
+        .block = RENDER_GRAPH_NONE,
+    };
+
+    darray_push(graph->resources, resource);
+    return darray_length(graph->resources) - 1;
+}
+
+u32 render_graph_create_image(struct render_graph *graph,
+                              const char *name,
+                              const render_graph_image_desc *desc) {
+    graph_resource resource = {
+        .name = name,
+        .kind = RESOURCE_KIND_IMAGE,
+        .transient = true,
+        .desc = *desc,
+        .final_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .layout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .block = RENDER_GRAPH_NONE,
+    };
+
+    darray_push(graph->resources, resource);
+    return darray_length(graph->resources) - 1;
+}
+
+u32 render_graph_import_buffer(struct render_graph *graph,
+                               const char *name,
+                               VkBuffer buffer,
+                               b8 output) {
+    graph_resource resource = {
+        .name = name,
+        .kind = RESOURCE_KIND_BUFFER,
+        .output = output,
+        .buffer = buffer,
+        .block = RENDER_GRAPH_NONE,
+    };
+
+    darray_push(graph->resources, resource);
+    return darray_length(graph->resources) - 1;
+}
+
+u32 render_graph_add_pass(struct render_graph *graph,
+                          const char *name,
+                          render_graph_pass_type type,
+                          render_graph_pass_fn fn,
+                          void *user_data) {
+    graph_pass pass = {
+        .name = name,
+        .type = type,
+        .fn = fn,
+        .user_data = user_data,
+    };
+
+    darray_push(graph->passes, pass);
+    return darray_length(graph->passes) - 1;
+}
+
+void render_graph_color_attachment(struct render_graph *graph,
+                                   u32 pass,
+                                   u32 image,
+                                   const VkClearValue *clear) {
+    resource_use use = {
+        .pass = pass,
+        .resource = image,
+        .kind = USE_COLOR_ATTACHMENT,
+        .clear = clear != NULL,
+        .clear_value = clear ? *clear : (VkClearValue){0},
+    };
+    add_use(graph, use);
+}
+
+void render_graph_depth_attachment(struct render_graph *graph,
+                                   u32 pass,
+                                   u32 image,
+                                   const VkClearValue *clear) {
+    resource_use use = {
+        .pass = pass,
+        .resource = image,
+        .kind = USE_DEPTH_ATTACHMENT,
+        .clear = clear != NULL,
+        .clear_value = clear ? *clear : (VkClearValue){0},
+    };
+    add_use(graph, use);
+}
+
+void render_graph_use(struct render_graph *graph,
+                      u32 pass,
+                      u32 resource,
+                      render_graph_access access) {
+    resource_use use = {
+        .pass = pass,
+        .resource = resource,
+        .kind = USE_ACCESS,
+        .access = access,
+    };
+    add_use(graph, use);
+}
+
+void render_graph_execute(struct render_graph *graph,
+                          const context *context,
+                          VkCommandBuffer command_buffer) {
+    PROFILE_FUNCTION();
+
+    graph->frame++;
+    graph->dynamic_rendering = context->device.supports_dynamic_rendering;
+    graph->stats = (render_graph_stats){.pass_count = darray_length(graph->passes)};
+
+    cull_passes(graph);
+    compute_lifetimes(graph);
+    allocate_transients(graph, context);
+
+    for (u32 i = 0; i < darray_length(graph->passes); i++) {
+        if (graph->passes[i].live) {
+            execute_pass(graph, context, command_buffer, i);
+        } else {
+            graph->stats.culled_pass_count++;
+        }
+    }
+
+    transition_to_final_layouts(graph, command_buffer);
+    retire_unused(graph, context);
+}
+
+void render_graph_pass_inheritance(const struct render_graph *graph,
+                                   render_graph_inheritance *out_inheritance) {
+    memset(out_inheritance, 0, sizeof(render_graph_inheritance));
+    memcpy(out_inheritance->color_formats,
+           graph->color_formats,
+           graph->color_count * sizeof(VkFormat));
+    out_inheritance->extent = graph->extent;
+
+    out_inheritance->rendering = (VkCommandBufferInheritanceRenderingInfo){
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+        .colorAttachmentCount = graph->color_count,
+        .pColorAttachmentFormats = out_inheritance->color_formats,
+        .depthAttachmentFormat = graph->depth_format,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+    };
+
+    out_inheritance->info = (VkCommandBufferInheritanceInfo){
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext = graph->dynamic_rendering ? &out_inheritance->rendering : NULL,
+        .renderPass = graph->render_pass,
+        .subpass = 0,
+        .framebuffer = graph->framebuffer,
+    };
+}
+
+VkImage render_graph_image(const struct render_graph *graph, u32 image) {
+    return graph->resources[image].image;
+}
+
+VkBuffer render_graph_buffer(const struct render_graph *graph, u32 buffer) {
+    return graph->resources[buffer].buffer;
+}
+
+void render_graph_stats_get(const struct render_graph *graph, render_graph_stats *out_stats) {
+    *out_stats = graph->stats;
+}
+
+void render_graph_forget_views(struct render_graph *graph, const context *context) {
+    retire_framebuffers(graph, context);
+}
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+static graph_resource *get_resource(struct render_graph *graph, u32 resource) {
+    if (resource >= darray_length(graph->resources)) {
+        fprintf(stderr, "Render graph resource %u does not exist!\n", resource);
+        exit(EXIT_FAILURE);
+    }
+
+    return &graph->resources[resource];
+}
+
+static graph_pass *get_pass(struct render_graph *graph, u32 pass) {
+    if (pass >= darray_length(graph->passes)) {
+        fprintf(stderr, "Render graph pass %u does not exist!\n", pass);
+        exit(EXIT_FAILURE);
+    }
+
+    return &graph->passes[pass];
+}
+
+static void add_use(struct render_graph *graph, resource_use use) {
+    graph_pass *pass = get_pass(graph, use.pass);
+    graph_resource *resource = get_resource(graph, use.resource);
+
+    b8 attachment = use.kind != USE_ACCESS;
+    if (attachment && (!is_graphics(pass->type) || resource->kind != RESOURCE_KIND_IMAGE)) {
+        fprintf(stderr,
+                "Render graph pass '%s' cannot use '%s' as an attachment!\n",
+                pass->name,
+                resource->name);
+        exit(EXIT_FAILURE);
+    }
+
+    darray_push(graph->uses, use);
+}
+
+static use_info get_use_info(const resource_use *use, render_graph_pass_type type) {
+    switch (use->kind) {
+    case USE_COLOR_ATTACHMENT:
+        return (use_info){
+            .stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            .write = true,
+            .read = !use->clear,
+        };
+    case USE_DEPTH_ATTACHMENT:
+        return (use_info){
+            .stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                      VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            .write = true,
+            .read = !use->clear,
+        };
+    case USE_ACCESS:
+        break;
+    }
+
+    // NOTE: Storage and transfer writes may only cover part of the resource, so they keep its
+    // previous contents.
+    switch (use->access) {
+    case RENDER_GRAPH_SAMPLED:
+        return (use_info){
+            .stages = shader_stages(type),
+            .access = VK_ACCESS_SHADER_READ_BIT,
+            .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+            .read = true,
+        };
+    case RENDER_GRAPH_STORAGE_READ:
+        return (use_info){
+            .stages = shader_stages(type),
+            .access = VK_ACCESS_SHADER_READ_BIT,
+            .layout = VK_IMAGE_LAYOUT_GENERAL,
+            .usage = VK_IMAGE_USAGE_STORAGE_BIT,
+            .read = true,
+        };
+    case RENDER_GRAPH_STORAGE_WRITE:
+        return (use_info){
+            .stages = shader_stages(type),
+            .access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            .layout = VK_IMAGE_LAYOUT_GENERAL,
+            .usage = VK_IMAGE_USAGE_STORAGE_BIT,
+            .write = true,
+            .read = true,
+        };
+    case RENDER_GRAPH_TRANSFER_READ:
+        return (use_info){
+            .stages = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .access = VK_ACCESS_TRANSFER_READ_BIT,
+            .layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            .read = true,
+        };
+    case RENDER_GRAPH_TRANSFER_WRITE:
+        return (use_info){
+            .stages = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .access = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            .write = true,
+            .read = true,
+        };
+    case RENDER_GRAPH_VERTEX_READ:
+        return (use_info){
+            .stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            .access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT,
+            .read = true,
+        };
+    case RENDER_GRAPH_INDIRECT_READ:
+        return (use_info){
+            .stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            .access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+            .read = true,
+        };
+    }
+
+    return (use_info){0};
+}
+
+static VkPipelineStageFlags shader_stages(render_graph_pass_type type) {
+    switch (type) {
+    case RENDER_GRAPH_PASS_GRAPHICS:
+    case RENDER_GRAPH_PASS_GRAPHICS_SECONDARY:
+        return VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    case RENDER_GRAPH_PASS_COMPUTE:
+        return VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    case RENDER_GRAPH_PASS_TRANSFER:
+        break;
+    }
+
+    return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+}
+
+static b8 is_graphics(render_graph_pass_type type) {
+    return type == RENDER_GRAPH_PASS_GRAPHICS || type == RENDER_GRAPH_PASS_GRAPHICS_SECONDARY;
+}
+
+/**
+ * Walks the passes backwards from the outputs. A pass is live when it writes something a live
+ * pass after it reads, or an output; a live pass that overwrites a resource without reading it
+ * ends the need for the passes writing it before.
+ */
+static void cull_passes(struct render_graph *graph) {
+    for (u64 i = 0; i < darray_length(graph->resources); i++) {
+        graph->resources[i].needed = graph->resources[i].output;
+    }
+
+    for (u32 pass = darray_length(graph->passes); pass-- > 0;) {
+        graph_pass *current = &graph->passes[pass];
+        current->live = false;
+
+        for (u64 i = 0; i < darray_length(graph->uses); i++) {
+            const resource_use *use = &graph->uses[i];
+            if (use->pass != pass) {
+                continue;
+            }
+
+            use_info info = get_use_info(use, current->type);
+            if (info.write && graph->resources[use->resource].needed) {
+                current->live = true;
+                break;
+            }
+        }
+
+        if (!current->live) {
+            continue;
+        }
+
+        for (u64 i = 0; i < darray_length(graph->uses); i++) {
+            const resource_use *use = &graph->uses[i];
+            if (use->pass != pass) {
+                continue;
+            }
+
+            use_info info = get_use_info(use, current->type);
+            if (info.read) {
+                graph->resources[use->resource].needed = true;
+            } else if (info.write && !graph->resources[use->resource].output) {
+                graph->resources[use->resource].needed = false;
+            }
+        }
+    }
+}
+
+static void compute_lifetimes(struct render_graph *graph) {
+    for (u64 i = 0; i < darray_length(graph->resources); i++) {
+        graph->resources[i].first_pass = RENDER_GRAPH_NONE;
+        graph->resources[i].last_pass = RENDER_GRAPH_NONE;
+        graph->resources[i].usage = 0;
+    }
+
+    for (u64 i = 0; i < darray_length(graph->uses); i++) {
+        const resource_use *use = &graph->uses[i];
+        const graph_pass *pass = &graph->passes[use->pass];
+        if (!pass->live) {
+            continue;
+        }
+
+        graph_resource *resource = &graph->resources[use->resource];
+        if (resource->first_pass == RENDER_GRAPH_NONE || use->pass < resource->first_pass) {
+            resource->first_pass = use->pass;
+        }
+        if (resource->last_pass == RENDER_GRAPH_NONE || use->pass > resource->last_pass) {
+            resource->last_pass = use->pass;
+        }
+        resource->usage |= get_use_info(use, pass->type).usage;
+    }
+}
+
+/**
+ * Places every transient image used by a live pass in the smallest memory block that is free for
+ * its whole lifetime and fits it, in the order the images are first used, and allocates a new
+ * block when none does.
+ */
+static void allocate_transients(struct render_graph *graph, const context *context) {
+    for (u64 i = 0; i < darray_length(graph->blocks); i++) {
+        graph->blocks[i].busy_until = RENDER_GRAPH_NONE;
+    }
+
+    for (u32 pass = 0; pass < darray_length(graph->passes); pass++) {
+        for (u64 i = 0; i < darray_length(graph->resources); i++) {
+            graph_resource *resource = &graph->resources[i];
+            if (!resource->transient || resource->first_pass != pass) {
+                continue;
+            }
+
+            VkMemoryRequirements requirements =
+                get_image_requirements(graph, context, &resource->desc, resource->usage);
+
+            u32 block = RENDER_GRAPH_NONE;
+            for (u32 j = 0; j < darray_length(graph->blocks); j++) {
+                const memory_block *candidate = &graph->blocks[j];
+                b8 free = candidate->busy_until == RENDER_GRAPH_NONE ||
+                          candidate->busy_until < resource->first_pass;
+                b8 fits = candidate->memory != VK_NULL_HANDLE &&
+                          (requirements.memoryTypeBits & (1 << candidate->memory_type)) &&
+                          candidate->size >= requirements.size;
+                if (free && fits &&
+                    (block == RENDER_GRAPH_NONE || candidate->size < graph->blocks[block].size)) {
+                    block = j;
+                }
+            }
+            if (block == RENDER_GRAPH_NONE) {
+                block = allocate_block(graph, context, &requirements);
+            }
+
+            if (graph->blocks[block].busy_until == RENDER_GRAPH_NONE) {
+                graph->stats.aliased_bytes += graph->blocks[block].size;
+            }
+            graph->blocks[block].busy_until = resource->last_pass;
+            graph->blocks[block].last_used_frame = graph->frame;
+
+            transient_image *image = acquire_image(graph, context, resource, block);
+            resource->image = image->image;
+            resource->view = image->view;
+            resource->block = block;
+
+            graph->stats.transient_image_count++;
+            graph->stats.transient_bytes += requirements.size;
+        }
+    }
+}
+
+static VkMemoryRequirements get_image_requirements(struct render_graph *graph,
+                                                   const context *context,
+                                                   const render_graph_image_desc *desc,
+                                                   VkImageUsageFlags usage) {
+    for (u64 i = 0; i < darray_length(graph->requirements); i++) {
+        const image_requirements *cached = &graph->requirements[i];
+        if (memcmp(&cached->desc, desc, sizeof(render_graph_image_desc)) == 0 &&
+            cached->usage == usage) {
+            return cached->requirements;
+        }
+    }
+
+    // NOTE: Queried once per description from a throwaway image.
+    image_requirements cached = {
+        .desc = *desc,
+        .usage = usage,
+    };
+
+    VkImage image = create_image(context->device.logical_device, desc, usage);
+    vkGetImageMemoryRequirements(context->device.logical_device, image, &cached.requirements);
+    vkDestroyImage(context->device.logical_device, image, NULL);
+
+    darray_push(graph->requirements, cached);
+    return cached.requirements;
+}
+
+static u32 allocate_block(struct render_graph *graph,
+                          const context *context,
+                          const VkMemoryRequirements *requirements) {
+    i32 memory_type = context->find_memory_index(context,
+                                                 requirements->memoryTypeBits,
+                                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (memory_type == -1) {
+        fprintf(stderr, "No memory type for a transient image!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memory_block block = {
+        .size = requirements->size,
+        .memory_type = memory_type,
+        .busy_until = RENDER_GRAPH_NONE,
+        .last_used_frame = graph->frame,
+    };
+
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = block.size,
+        .memoryTypeIndex = block.memory_type,
+    };
+
+    VK_CHECK(vkAllocateMemory(context->device.logical_device, &alloc_info, NULL, &block.memory));
+
+    for (u32 i = 0; i < darray_length(graph->blocks); i++) {
+        if (graph->blocks[i].memory == VK_NULL_HANDLE) {
+            graph->blocks[i] = block;
+            return i;
+        }
+    }
+
+    darray_push(graph->blocks, block);
+    return darray_length(graph->blocks) - 1;
+}
+
+// NOTE: Images are cached per description and block, so steady frames create nothing.
+static transient_image *acquire_image(struct render_graph *graph,
+                                      const context *context,
+                                      const graph_resource *resource,
+                                      u32 block) {
+    for (u64 i = 0; i < darray_length(graph->images); i++) {
+        transient_image *image = &graph->images[i];
+        if (image->block == block && image->usage == resource->usage &&
+            memcmp(&image->desc, &resource->desc, sizeof(render_graph_image_desc)) == 0) {
+            image->last_used_frame = graph->frame;
+            return image;
+        }
+    }
+
+    VkDevice device = context->device.logical_device;
+
+    transient_image image = {
+        .desc = resource->desc,
+        .usage = resource->usage,
+        .block = block,
+        .image = create_image(device, &resource->desc, resource->usage),
+        .last_used_frame = graph->frame,
+    };
+
+    VK_CHECK(vkBindImageMemory(device, image.image, graph->blocks[block].memory, 0));
+
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = image.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = resource->desc.format,
+        .subresourceRange =
+            {
+                .aspectMask = resource->desc.aspect,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+    };
+
+    VK_CHECK(vkCreateImageView(device, &view_info, NULL, &image.view));
+
+    darray_push(graph->images, image);
+    return &graph->images[darray_length(graph->images) - 1];
+}
+
+static VkImage create_image(VkDevice device,
+                            const render_graph_image_desc *desc,
+                            VkImageUsageFlags usage) {
+    VkImageCreateInfo image_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .extent =
+            {
+                .width = desc->extent.width,
+                .height = desc->extent.height,
+                .depth = 1,
+            },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .format = desc->format,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+    };
+
+    VkImage image;
+    VK_CHECK(vkCreateImage(device, &image_info, NULL, &image));
+
+    return image;
+}
+
+static void execute_pass(struct render_graph *graph,
+                         const context *context,
+                         VkCommandBuffer command_buffer,
+                         u32 pass) {
+    const graph_pass *current = &graph->passes[pass];
+
+    barrier_batch batch = {
+        .memory =
+            {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            },
+        .images = graph->image_barriers,
+    };
+
+    for (u64 i = 0; i < darray_length(graph->uses); i++) {
+        const resource_use *use = &graph->uses[i];
+        if (use->pass != pass) {
+            continue;
+        }
+
+        graph_resource *resource = &graph->resources[use->resource];
+
+        // NOTE: A transient image starts out with whatever last used its memory, possibly in an
+        // earlier frame, and without contents.
+        if (resource->transient && resource->first_pass == pass) {
+            const memory_block *block = &graph->blocks[resource->block];
+            resource->layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            resource->write_stages = block->stages;
+            resource->write_access = block->access;
+            resource->read_stages = 0;
+            resource->read_access = 0;
+        }
+
+        use_info info = get_use_info(use, current->type);
+        add_barrier(resource, &info, &batch);
+
+        if (resource->transient) {
+            memory_block *block = &graph->blocks[resource->block];
+            block->stages = resource->write_stages | resource->read_stages;
+            block->access = resource->write_access;
+        }
+    }
+
+    flush_barriers(graph, command_buffer, &batch);
+    graph->image_barriers = batch.images;
+
+    u32 scope = gpu_profiler_begin_scope(context->gpu_profiler, command_buffer, current->name);
+
+    if (is_graphics(current->type)) {
+        begin_rendering(graph, context, command_buffer, pass);
+    }
+
+    current->fn(command_buffer, current->user_data);
+
+    if (is_graphics(current->type)) {
+        if (graph->dynamic_rendering) {
+            vkCmdEndRendering(command_buffer);
+        } else {
+            vkCmdEndRenderPass(command_buffer);
+        }
+        graph->render_pass = VK_NULL_HANDLE;
+        graph->framebuffer = VK_NULL_HANDLE;
+    }
+
+    gpu_profiler_end_scope(context->gpu_profiler, command_buffer, scope);
+}
+
+/**
+ * Writes wait for the previous write and every read since, reads only for the previous write.
+ * Reads that an earlier barrier already covered need none, unless the layout changes, which
+ * counts as a write.
+ */
+static void add_barrier(graph_resource *resource, const use_info *info, barrier_batch *batch) {
+    b8 image = resource->kind == RESOURCE_KIND_IMAGE;
+    b8 layout_change = image && resource->layout != info->layout;
+
+    VkPipelineStageFlags src_stages = resource->write_stages;
+    VkAccessFlags src_access = resource->write_access;
+    if (info->write || layout_change) {
+        src_stages |= resource->read_stages;
+    }
+
+    b8 covered = (resource->read_stages & info->stages) == info->stages &&
+                 (resource->read_access & info->access) == info->access;
+    b8 needed = layout_change || (src_stages != 0 && (info->write || !covered));
+
+    if (needed) {
+        batch->src_stages |= src_stages;
+        batch->dst_stages |= info->stages;
+
+        if (image) {
+            VkImageMemoryBarrier barrier = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .oldLayout = info->read ? resource->layout : VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout = info->layout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = resource->image,
+                .subresourceRange =
+                    {
+                        .aspectMask = resource->desc.aspect,
+                        .baseMipLevel = 0,
+                        .levelCount = 1,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1,
+                    },
+                .srcAccessMask = src_access,
+                .dstAccessMask = info->access,
+            };
+            darray_push(batch->images, barrier);
+        } else {
+            batch->memory.srcAccessMask |= src_access;
+            batch->memory.dstAccessMask |= info->access;
+        }
+    }
+
+    if (info->write) {
+        resource->write_stages = info->stages;
+        resource->write_access = info->access & WRITE_ACCESS;
+        resource->read_stages = 0;
+        resource->read_access = 0;
+    } else if (layout_change) {
+        // NOTE: Later reads in other stages still have to wait for the transition.
+        resource->write_stages = info->stages;
+        resource->write_access = 0;
+        resource->read_stages = info->stages;
+        resource->read_access = info->access;
+    } else {
+        resource->read_stages |= info->stages;
+        resource->read_access |= info->access;
+    }
+
+    if (image) {
+        resource->layout = info->layout;
+    }
+}
+
+static void flush_barriers(struct render_graph *graph,
+                           VkCommandBuffer command_buffer,
+                           barrier_batch *batch) {
+    u32 image_count = darray_length(batch->images);
+    b8 memory = batch->memory.srcAccessMask != 0 || batch->memory.dstAccessMask != 0;
+
+    if (batch->dst_stages != 0) {
+        vkCmdPipelineBarrier(command_buffer,
+                             batch->src_stages ? batch->src_stages
+                                               : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             batch->dst_stages,
+                             0,
+                             memory ? 1 : 0,
+                             &batch->memory,
+                             0,
+                             NULL,
+                             image_count,
+                             batch->images);
+        graph->stats.barrier_count++;
+    }
+
+    darray_clear(batch->images);
+}
+
+static void transition_to_final_layouts(struct render_graph *graph,
+                                        VkCommandBuffer command_buffer) {
+    barrier_batch batch = {
+        .memory =
+            {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            },
+        .images = graph->image_barriers,
+    };
+
+    for (u64 i = 0; i < darray_length(graph->resources); i++) {
+        graph_resource *resource = &graph->resources[i];
+        if (resource->kind != RESOURCE_KIND_IMAGE || resource->transient ||
+            resource->final_layout == VK_IMAGE_LAYOUT_UNDEFINED ||
+            resource->final_layout == resource->layout) {
+            continue;
+        }
+
+        VkImageMemoryBarrier barrier = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .oldLayout = resource->layout,
+            .newLayout = resource->final_layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = resource->image,
+            .subresourceRange =
+                {
+                    .aspectMask = resource->desc.aspect,
+                    .baseMipLevel = 0,
+                    .levelCount = 1,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+            .srcAccessMask = resource->write_access,
+            .dstAccessMask = 0,
+        };
+        darray_push(batch.images, barrier);
+
+        batch.src_stages |= resource->write_stages | resource->read_stages;
+        batch.dst_stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        resource->layout = resource->final_layout;
+    }
+
+    flush_barriers(graph, command_buffer, &batch);
+    graph->image_barriers = batch.images;
+}
+
+/**
+ * Begins the pass' rendering scope over its attachments. Attachments are stored only when an
+ * output or a later pass needs them. Inline passes get a viewport and scissor covering the render
+ * area, secondary command buffers set their own.
+ */
+static void begin_rendering(struct render_graph *graph,
+                            const context *context,
+                            VkCommandBuffer command_buffer,
+                            u32 pass) {
+    const graph_pass *current = &graph->passes[pass];
+    b8 secondary = current->type == RENDER_GRAPH_PASS_GRAPHICS_SECONDARY;
+
+    VkRenderingAttachmentInfo color_attachments[RENDER_GRAPH_MAX_COLOR_ATTACHMENTS];
+    VkRenderingAttachmentInfo depth_attachment = {0};
+    b8 has_depth = false;
+
+    // NOTE: Both keys are compared with memcmp, padding included.
+    render_pass_key pass_key;
+    memset(&pass_key, 0, sizeof(pass_key));
+    framebuffer_key target_key;
+    memset(&target_key, 0, sizeof(target_key));
+    VkClearValue clear_values[MAX_ATTACHMENTS] = {0};
+    VkImageView depth_view = VK_NULL_HANDLE;
+    VkClearValue depth_clear = {0};
+
+    graph->color_count = 0;
+    graph->depth_format = VK_FORMAT_UNDEFINED;
+    graph->extent = (VkExtent2D){UINT32_MAX, UINT32_MAX};
+
+    for (u64 i = 0; i < darray_length(graph->uses); i++) {
+        const resource_use *use = &graph->uses[i];
+        if (use->pass != pass || use->kind == USE_ACCESS) {
+            continue;
+        }
+
+        const graph_resource *resource = &graph->resources[use->resource];
+        VkRenderingAttachmentInfo attachment = {
+            .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+            .imageView = resource->view,
+            .imageLayout = get_use_info(use, current->type).layout,
+            .resolveMode = VK_RESOLVE_MODE_NONE,
+            .loadOp = use->clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD,
+            .storeOp = store_op(resource, pass),
+            .clearValue = use->clear_value,
+        };
+
+        if (resource->desc.extent.width < graph->extent.width) {
+            graph->extent.width = resource->desc.extent.width;
+        }
+        if (resource->desc.extent.height < graph->extent.height) {
+            graph->extent.height = resource->desc.extent.height;
+        }
+
+        if (use->kind == USE_DEPTH_ATTACHMENT) {
+            depth_attachment = attachment;
+            depth_view = resource->view;
+            depth_clear = use->clear_value;
+            graph->depth_format = resource->desc.format;
+            has_depth = true;
+            continue;
+        }
+
+        if (graph->color_count == RENDER_GRAPH_MAX_COLOR_ATTACHMENTS) {
+            fprintf(stderr, "Render graph pass '%s' has too many attachments!\n", current->name);
+            exit(EXIT_FAILURE);
+        }
+
+        u32 index = graph->color_count++;
+        color_attachments[index] = attachment;
+        graph->color_formats[index] = resource->desc.format;
+
+        pass_key.formats[index] = resource->desc.format;
+        pass_key.load_ops[index] = attachment.loadOp;
+        pass_key.store_ops[index] = attachment.storeOp;
+        target_key.views[index] = resource->view;
+        clear_values[index] = use->clear_value;
+    }
+
+    if (graph->color_count == 0 && !has_depth) {
+        fprintf(stderr, "Render graph pass '%s' has no attachments!\n", current->name);
+        exit(EXIT_FAILURE);
+    }
+
+    VkRect2D render_area = {
+        .offset = {0, 0},
+        .extent = graph->extent,
+    };
+
+    if (graph->dynamic_rendering) {
+        VkRenderingInfo rendering_info = {
+            .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+            .flags = secondary ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0,
+            .renderArea = render_area,
+            .layerCount = 1,
+            .colorAttachmentCount = graph->color_count,
+            .pColorAttachments = color_attachments,
+            .pDepthAttachment = has_depth ? &depth_attachment : NULL,
+        };
+
+        vkCmdBeginRendering(command_buffer, &rendering_info);
+    } else {
+        // NOTE: Depth goes after the color attachments.
+        u32 attachment_count = graph->color_count;
+        if (has_depth) {
+            pass_key.formats[attachment_count] = graph->depth_format;
+            pass_key.load_ops[attachment_count] = depth_attachment.loadOp;
+            pass_key.store_ops[attachment_count] = depth_attachment.storeOp;
+            target_key.views[attachment_count] = depth_view;
+            clear_values[attachment_count] = depth_clear;
+            attachment_count++;
+        }
+        pass_key.attachment_count = attachment_count;
+        pass_key.has_depth = has_depth;
+
+        graph->render_pass = get_render_pass(graph, context, &pass_key);
+
+        target_key.render_pass = graph->render_pass;
+        target_key.attachment_count = attachment_count;
+        target_key.extent = graph->extent;
+        graph->framebuffer = get_framebuffer(graph, context, &target_key);
+
+        VkRenderPassBeginInfo render_pass_info = {
+            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            .renderPass = graph->render_pass,
+            .framebuffer = graph->framebuffer,
+            .renderArea = render_area,
+            .clearValueCount = attachment_count,
+            .pClearValues = clear_values,
+        };
+
+        vkCmdBeginRenderPass(command_buffer,
+                             &render_pass_info,
+                             secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+                                       : VK_SUBPASS_CONTENTS_INLINE);
+    }
+
+    if (!secondary) {
+        VkViewport viewport = {
+            .x = 0.0f,
+            .y = 0.0f,
+            .width = (float)graph->extent.width,
+            .height = (float)graph->extent.height,
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f,
+        };
+
+        vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+        vkCmdSetScissor(command_buffer, 0, 1, &render_area);
+    }
+}
+
+static VkAttachmentStoreOp store_op(const graph_resource *resource, u32 pass) {
+    if (resource->output || resource->last_pass > pass) {
+        return VK_ATTACHMENT_STORE_OP_STORE;
+    }
+
+    return VK_ATTACHMENT_STORE_OP_DONT_CARE;
+}
+
+/**
+ * Render passes for devices without dynamic rendering. Layouts do not change inside them, the
+ * graph's barriers transition the attachments before the pass begins.
+ */
+static VkRenderPass get_render_pass(struct render_graph *graph,
+                                    const context *context,
+                                    const render_pass_key *key) {
+    for (u64 i = 0; i < darray_length(graph->render_passes); i++) {
+        if (memcmp(&graph->render_passes[i].key, key, sizeof(render_pass_key)) == 0) {
+            return graph->render_passes[i].handle;
+        }
+    }
+
+    u32 color_count = key->has_depth ? key->attachment_count - 1 : key->attachment_count;
+
+    VkAttachmentDescription attachments[MAX_ATTACHMENTS];
+    VkAttachmentReference references[MAX_ATTACHMENTS];
+    for (u32 i = 0; i < key->attachment_count; i++) {
+        VkImageLayout layout = i < color_count ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+                                               : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        attachments[i] = (VkAttachmentDescription){
+            .format = key->formats[i],
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = key->load_ops[i],
+            .storeOp = key->store_ops[i],
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = layout,
+            .finalLayout = layout,
+        };
+        references[i] = (VkAttachmentReference){
+            .attachment = i,
+            .layout = layout,
+        };
+    }
+
+    VkSubpassDescription subpass = {
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount = color_count,
+        .pColorAttachments = references,
+        .pDepthStencilAttachment = key->has_depth ? &references[color_count] : NULL,
+    };
+
+    VkRenderPassCreateInfo render_pass_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = key->attachment_count,
+        .pAttachments = attachments,
+        .subpassCount = 1,
+        .pSubpasses = &subpass,
+    };
+
+    cached_render_pass cached = {.key = *key};
+    VK_CHECK(vkCreateRenderPass(context->device.logical_device,
+                                &render_pass_info,
+                                NULL,
+                                &cached.handle));
+
+    darray_push(graph->render_passes, cached);
+    return cached.handle;
+}
+
+static VkFramebuffer get_framebuffer(struct render_graph *graph,
+                                     const context *context,
+                                     const framebuffer_key *key) {
+    for (u64 i = 0; i < darray_length(graph->framebuffers); i++) {
+        cached_framebuffer *cached = &graph->framebuffers[i];
+        if (memcmp(&cached->key, key, sizeof(framebuffer_key)) == 0) {
+            cached->last_used_frame = graph->frame;
+            return cached->handle;
+        }
+    }
+
+    VkFramebufferCreateInfo framebuffer_info = {
+        .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+        .renderPass = key->render_pass,
+        .attachmentCount = key->attachment_count,
+        .pAttachments = key->views,
+        .width = key->extent.width,
+        .height = key->extent.height,
+        .layers = 1,
+    };
+
+    cached_framebuffer cached = {
+        .key = *key,
+        .last_used_frame = graph->frame,
+    };
+    VK_CHECK(vkCreateFramebuffer(context->device.logical_device,
+                                 &framebuffer_info,
+                                 NULL,
+                                 &cached.handle));
+
+    darray_push(graph->framebuffers, cached);
+    return cached.handle;
+}
+
+/**
+ * Hands transient images, memory blocks and framebuffers that went unused for
+ * RENDER_GRAPH_RETIRE_FRAMES to the deletion queue. A block is used whenever one of its images
+ * is, so its images are always released before or with it.
+ */
+static void retire_unused(struct render_graph *graph, const context *context) {
+    b8 retired_views = false;
+
+    u64 i = 0;
+    while (i < darray_length(graph->images)) {
+        const transient_image *image = &graph->images[i];
+        if (image->last_used_frame + RENDER_GRAPH_RETIRE_FRAMES > graph->frame) {
+            i++;
+            continue;
+        }
+
+        deletion_queue_push(context->deletion_queue,
+                            (deletion){.type = DELETION_IMAGE_VIEW, .image_view = image->view});
+        deletion_queue_push(context->deletion_queue,
+                            (deletion){.type = DELETION_IMAGE, .image = image->image});
+        darray_pop_at(graph->images, i, NULL);
+        retired_views = true;
+    }
+
+    for (u64 j = 0; j < darray_length(graph->blocks); j++) {
+        memory_block *block = &graph->blocks[j];
+        if (block->memory == VK_NULL_HANDLE ||
+            block->last_used_frame + RENDER_GRAPH_RETIRE_FRAMES > graph->frame) {
+            continue;
+        }
+
+        deletion_queue_push(context->deletion_queue,
+                            (deletion){.type = DELETION_DEVICE_MEMORY, .memory = block->memory});
+        block->memory = VK_NULL_HANDLE;
+        block->size = 0;
+    }
+
+    // NOTE: A framebuffer refers to its views by handle, which a new view could reuse.
+    if (retired_views) {
+        retire_framebuffers(graph, context);
+        return;
+    }
+
+    i = 0;
+    while (i < darray_length(graph->framebuffers)) {
+        const cached_framebuffer *cached = &graph->framebuffers[i];
+        if (cached->last_used_frame + RENDER_GRAPH_RETIRE_FRAMES > graph->frame) {
+            i++;
+            continue;
+        }
+
+        deletion_queue_push(context->deletion_queue,
+                            (deletion){.type = DELETION_FRAMEBUFFER,
+                                       .framebuffer = cached->handle});
+        darray_pop_at(graph->framebuffers, i, NULL);
+    }
+}
+
+static void retire_framebuffers(struct render_graph *graph, const context *context) {
+    for (u64 i = 0; i < darray_length(graph->framebuffers); i++) {
+        deletion_queue_push(context->deletion_queue,
+                            (deletion){.type = DELETION_FRAMEBUFFER,
+                                       .framebuffer = graph->framebuffers[i].handle});
+    }
+    darray_clear(graph->framebuffers);
+}
@@ -0,0 +1,158 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include "types.h"
+
+#include <stdint.h>
+
+#define RENDER_GRAPH_MAX_COLOR_ATTACHMENTS 4
+// NOTE: Frames a transient image or memory block may go unused before it is released.
+#define RENDER_GRAPH_RETIRE_FRAMES 8
+
+// NOTE: Stands for no pass, resource or memory block.
+#define RENDER_GRAPH_NONE UINT32_MAX
+
+typedef enum {
+    // NOTE: Recorded inline inside the pass' rendering scope.
+    RENDER_GRAPH_PASS_GRAPHICS,
+    // NOTE: Like graphics, but the pass only executes secondary command buffers, which begin with
+    // render_graph_pass_inheritance.
+    RENDER_GRAPH_PASS_GRAPHICS_SECONDARY,
+    RENDER_GRAPH_PASS_COMPUTE,
+    RENDER_GRAPH_PASS_TRANSFER,
+} render_graph_pass_type;
+
+// NOTE: Attachments are declared with render_graph_color_attachment and depth_attachment instead.
+typedef enum {
+    RENDER_GRAPH_SAMPLED,
+    RENDER_GRAPH_STORAGE_READ,
+    RENDER_GRAPH_STORAGE_WRITE,
+    RENDER_GRAPH_TRANSFER_READ,
+    RENDER_GRAPH_TRANSFER_WRITE,
+    RENDER_GRAPH_VERTEX_READ,
+    RENDER_GRAPH_INDIRECT_READ,
+} render_graph_access;
+
+typedef void (*render_graph_pass_fn)(VkCommandBuffer command_buffer, void *user_data);
+
+typedef struct {
+    VkImage image;
+    VkImageView view;
+    VkFormat format;
+    VkExtent2D extent;
+    VkImageAspectFlags aspect;
+
+    // NOTE: What the image was last used as before the graph runs, so the first barrier can wait
+    // for it. An UNDEFINED initial layout discards the contents.
+    VkImageLayout initial_layout;
+    VkPipelineStageFlags initial_stages;
+    VkAccessFlags initial_access;
+
+    // NOTE: Layout the image is left in after the last pass, UNDEFINED leaves it as it is.
+    VkImageLayout final_layout;
+    // NOTE: Outputs keep every pass writing them alive, see render_graph_execute.
+    b8 output;
+} render_graph_image_import;
+
+typedef struct {
+    VkFormat format;
+    VkExtent2D extent;
+    VkImageAspectFlags aspect;
+} render_graph_image_desc;
+
+/**
+ * Begin info for the secondary command buffers of a RENDER_GRAPH_PASS_GRAPHICS_SECONDARY pass.
+ * The inheritance info points into the struct itself, so it must not be copied once filled in.
+ */
+typedef struct {
+    VkCommandBufferInheritanceInfo info;
+    VkCommandBufferInheritanceRenderingInfo rendering;
+    VkFormat color_formats[RENDER_GRAPH_MAX_COLOR_ATTACHMENTS];
+    VkExtent2D extent;
+} render_graph_inheritance;
+
+typedef struct {
+    u32 pass_count;
+    u32 culled_pass_count;
+    u32 barrier_count;
+    u32 transient_image_count;
+    // NOTE: What the transient images would take without aliasing, and the memory they share.
+    VkDeviceSize transient_bytes;
+    VkDeviceSize aliased_bytes;
+} render_graph_stats;
+
+/**
+ * A graph of the frame's passes, declared again every frame between render_graph_begin and
+ * render_graph_execute. Each pass declares the images and buffers it reads and writes, from which
+ * the graph derives the pipeline barriers and layout transitions between passes, culls passes
+ * whose results nothing uses and places transient images whose lifetimes do not overlap in the
+ * same device memory. Passes execute in the order they are declared.
+ *
+ * Graphics passes render with vkCmdBeginRendering when the device supports dynamic rendering, and
+ * with render passes and framebuffers the graph caches otherwise. Belongs to the thread making the
+ * context's Vulkan calls.
+ */
+struct render_graph *render_graph_create(void);
+// NOTE: For shutdown, once the device is idle.
+void render_graph_destroy(struct render_graph *graph, context *context);
+
+void render_graph_begin(struct render_graph *graph);
+
+u32 render_graph_import_image(struct render_graph *graph,
+                              const char *name,
+                              const render_graph_image_import *import);
+// NOTE: Usage flags follow from the passes using it, its contents do not survive the frame.
+u32 render_graph_create_image(struct render_graph *graph,
+                              const char *name,
+                              const render_graph_image_desc *desc);
+u32 render_graph_import_buffer(struct render_graph *graph,
+                               const char *name,
+                               VkBuffer buffer,
+                               b8 output);
+
+// NOTE: name must outlive the graph, it also names the pass' GPU profiler scope.
+u32 render_graph_add_pass(struct render_graph *graph,
+                          const char *name,
+                          render_graph_pass_type type,
+                          render_graph_pass_fn fn,
+                          void *user_data);
+// NOTE: A NULL clear value loads the attachment's previous contents instead.
+void render_graph_color_attachment(struct render_graph *graph,
+                                   u32 pass,
+                                   u32 image,
+                                   const VkClearValue *clear);
+void render_graph_depth_attachment(struct render_graph *graph,
+                                   u32 pass,
+                                   u32 image,
+                                   const VkClearValue *clear);
+// NOTE: Each resource is used at most once per pass.
+void render_graph_use(struct render_graph *graph,
+                      u32 pass,
+                      u32 resource,
+                      render_graph_access access);
+
+/**
+ * Records every pass that is not culled into command_buffer, with a profiler scope each, and
+ * leaves imported images in their final layout.
+ */
+void render_graph_execute(struct render_graph *graph,
+                          const context *context,
+                          VkCommandBuffer command_buffer);
+
+/**
+ * Releases the cached framebuffers, which refer to image views by handle. Must be called before
+ * an imported image view is destroyed, since a new view could be created with the same handle.
+ */
+void render_graph_forget_views(struct render_graph *graph, const context *context);
+
+// NOTE: Only valid while a graphics pass is executing, from its pass function.
+void render_graph_pass_inheritance(const struct render_graph *graph,
+                                   render_graph_inheritance *out_inheritance);
+// NOTE: Transient images only exist while the graph executes.
+VkImage render_graph_image(const struct render_graph *graph, u32 image);
+VkBuffer render_graph_buffer(const struct render_graph *graph, u32 buffer);
+
+// NOTE: Of the last executed frame.
+void render_graph_stats_get(const struct render_graph *graph, render_graph_stats *out_stats);
+
+#endif // RENDER_GRAPH_H
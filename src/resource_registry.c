@@ -0,0 +1,511 @@
+#include "resource_registry.h"
+
+#include "context.h"
+#include "darray.h"
+#include "deletion_queue.h"
+#include "pipeline.h"
+
+#define RESOURCE_INDEX_MASK ((1u << RESOURCE_INDEX_BITS) - 1)
+#define RESOURCE_GENERATION_MASK ((1u << RESOURCE_GENERATION_BITS) - 1)
+
+STATIC_ASSERT(RESOURCE_INDEX_BITS + RESOURCE_GENERATION_BITS == 32,
+              "Expected handles to be 32 bits.");
+STATIC_ASSERT(RESOURCE_MAX_BUFFERS <= (1u << RESOURCE_INDEX_BITS) &&
+                  RESOURCE_MAX_IMAGES <= (1u << RESOURCE_INDEX_BITS) &&
+                  RESOURCE_MAX_SAMPLERS <= (1u << RESOURCE_INDEX_BITS) &&
+                  RESOURCE_MAX_PIPELINES <= (1u << RESOURCE_INDEX_BITS),
+              "Expected every pool to be indexable by a handle.");
+
+/**
+ * Bookkeeping shared by every pool. Slots are handed out from the free list first, then from the
+ * never used ones past count. A slot's generation starts at 1, so no handle is ever 0.
+ */
+typedef struct {
+    u32 capacity;
+    u32 count;
+
+    u16 *generations;
+    b8 *live;
+    u32 *free_indices; // darray
+} slot_pool;
+
+typedef struct {
+    slot_pool slots;
+
+    VkBuffer *handles;
+    VkDeviceMemory *memories;
+    VkDeviceSize *sizes;
+    VkDeviceSize *allocation_sizes;
+    void **mapped;
+} buffer_pool;
+
+typedef struct {
+    slot_pool slots;
+
+    VkImage *handles;
+    VkDeviceMemory *memories;
+    VkImageView *views;
+    VkExtent2D *extents;
+    VkFormat *formats;
+    VkDeviceSize *allocation_sizes;
+} image_pool;
+
+typedef struct {
+    slot_pool slots;
+
+    VkSampler *handles;
+} sampler_pool;
+
+typedef struct {
+    slot_pool slots;
+
+    pipeline *pipelines;
+} pipeline_pool;
+
+struct resource_registry {
+    buffer_pool buffers;
+    image_pool images;
+    sampler_pool samplers;
+    pipeline_pool pipelines;
+};
+
+static void slot_pool_create(slot_pool *slots, u32 capacity);
+static void slot_pool_destroy(slot_pool *slots);
+static u32 allocate_slot(slot_pool *slots, const char *type_name);
+static void release_slot(slot_pool *slots, u32 index, b8 reuse);
+static u32 make_handle(const slot_pool *slots, u32 index);
+static u32 resolve(const slot_pool *slots, u32 handle, const char *type_name);
+static void release_pipeline(context *context, void *index);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+struct resource_registry *resource_registry_create(void) {
+    struct resource_registry *registry = calloc(1, sizeof(struct resource_registry));
+
+    buffer_pool *buffers = &registry->buffers;
+    slot_pool_create(&buffers->slots, RESOURCE_MAX_BUFFERS);
+    buffers->handles = calloc(RESOURCE_MAX_BUFFERS, sizeof(VkBuffer));
+    buffers->memories = calloc(RESOURCE_MAX_BUFFERS, sizeof(VkDeviceMemory));
+    buffers->sizes = calloc(RESOURCE_MAX_BUFFERS, sizeof(VkDeviceSize));
+    buffers->allocation_sizes = calloc(RESOURCE_MAX_BUFFERS, sizeof(VkDeviceSize));
+    buffers->mapped = calloc(RESOURCE_MAX_BUFFERS, sizeof(void *));
+
+    image_pool *images = &registry->images;
+    slot_pool_create(&images->slots, RESOURCE_MAX_IMAGES);
+    images->handles = calloc(RESOURCE_MAX_IMAGES, sizeof(VkImage));
+    images->memories = calloc(RESOURCE_MAX_IMAGES, sizeof(VkDeviceMemory));
+    images->views = calloc(RESOURCE_MAX_IMAGES, sizeof(VkImageView));
+    images->extents = calloc(RESOURCE_MAX_IMAGES, sizeof(VkExtent2D));
+    images->formats = calloc(RESOURCE_MAX_IMAGES, sizeof(VkFormat));
+    images->allocation_sizes = calloc(RESOURCE_MAX_IMAGES, sizeof(VkDeviceSize));
+
+    sampler_pool *samplers = &registry->samplers;
+    slot_pool_create(&samplers->slots, RESOURCE_MAX_SAMPLERS);
+    samplers->handles = calloc(RESOURCE_MAX_SAMPLERS, sizeof(VkSampler));
+
+    pipeline_pool *pipelines = &registry->pipelines;
+    slot_pool_create(&pipelines->slots, RESOURCE_MAX_PIPELINES);
+    pipelines->pipelines = calloc(RESOURCE_MAX_PIPELINES, sizeof(pipeline));
+
+    return registry;
+}
+
+void resource_registry_destroy(struct resource_registry *registry, context *context) {
+    VkDevice device = context->device.logical_device;
+
+    buffer_pool *buffers = &registry->buffers;
+    for (u32 i = 0; i < buffers->slots.count; i++) {
+        if (buffers->slots.live[i]) {
+            vkDestroyBuffer(device, buffers->handles[i], NULL);
+            vkFreeMemory(device, buffers->memories[i], NULL);
+        }
+    }
+    slot_pool_destroy(&buffers->slots);
+    free(buffers->handles);
+    free(buffers->memories);
+    free(buffers->sizes);
+    free(buffers->allocation_sizes);
+    free(buffers->mapped);
+
+    image_pool *images = &registry->images;
+    for (u32 i = 0; i < images->slots.count; i++) {
+        if (images->slots.live[i]) {
+            vkDestroyImageView(device, images->views[i], NULL);
+            vkDestroyImage(device, images->handles[i], NULL);
+            vkFreeMemory(device, images->memories[i], NULL);
+        }
+    }
+    slot_pool_destroy(&images->slots);
+    free(images->handles);
+    free(images->memories);
+    free(images->views);
+    free(images->extents);
+    free(images->formats);
+    free(images->allocation_sizes);
+
+    sampler_pool *samplers = &registry->samplers;
+    for (u32 i = 0; i < samplers->slots.count; i++) {
+        if (samplers->slots.live[i]) {
+            vkDestroySampler(device, samplers->handles[i], NULL);
+        }
+    }
+    slot_pool_destroy(&samplers->slots);
+    free(samplers->handles);
+
+    pipeline_pool *pipelines = &registry->pipelines;
+    for (u32 i = 0; i < pipelines->slots.count; i++) {
+        if (pipelines->slots.live[i]) {
+            pipeline_destroy(&pipelines->pipelines[i], &context->device);
+        }
+    }
+    slot_pool_destroy(&pipelines->slots);
+    free(pipelines->pipelines);
+
+    free(registry);
+}
+
+buffer_handle resource_create_buffer(const context *context,
+                                     VkDeviceSize size,
+                                     VkBufferUsageFlags usage,
+                                     VkMemoryPropertyFlags properties) {
+    buffer_pool *pool = &context->resources->buffers;
+    u32 index = allocate_slot(&pool->slots, "buffer");
+
+    pool->allocation_sizes[index] = context_create_buffer(context,
+                                                          size,
+                                                          usage,
+                                                          properties,
+                                                          &pool->handles[index],
+                                                          &pool->memories[index]);
+    pool->sizes[index] = size;
+    pool->mapped[index] = NULL;
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        VK_CHECK(vkMapMemory(context->device.logical_device,
+                             pool->memories[index],
+                             0,
+                             size,
+                             0,
+                             &pool->mapped[index]));
+    }
+
+    return (buffer_handle){make_handle(&pool->slots, index)};
+}
+
+image_handle resource_create_image(const context *context,
+                                   VkExtent2D extent,
+                                   VkFormat format,
+                                   VkImageUsageFlags usage,
+                                   VkImageAspectFlags aspect) {
+    image_pool *pool = &context->resources->images;
+    u32 index = allocate_slot(&pool->slots, "image");
+
+    VkImageCreateInfo image_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .extent =
+            {
+                .width = extent.width,
+                .height = extent.height,
+                .depth = 1,
+            },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .format = format,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+    };
+
+    VK_CHECK(vkCreateImage(context->device.logical_device,
+                           &image_info,
+                           NULL,
+                           &pool->handles[index]));
+
+    VkMemoryRequirements memory_requirements;
+    vkGetImageMemoryRequirements(context->device.logical_device,
+                                 pool->handles[index],
+                                 &memory_requirements);
+
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = memory_requirements.size,
+        .memoryTypeIndex = context->find_memory_index(context,
+                                                      memory_requirements.memoryTypeBits,
+                                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+    };
+
+    VK_CHECK(vkAllocateMemory(context->device.logical_device,
+                              &alloc_info,
+                              NULL,
+                              &pool->memories[index]));
+
+    VK_CHECK(vkBindImageMemory(context->device.logical_device,
+                               pool->handles[index],
+                               pool->memories[index],
+                               0));
+
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = pool->handles[index],
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .subresourceRange =
+            {
+                .aspectMask = aspect,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+    };
+
+    VK_CHECK(vkCreateImageView(context->device.logical_device,
+                               &view_info,
+                               NULL,
+                               &pool->views[index]));
+
+    pool->extents[index] = extent;
+    pool->formats[index] = format;
+    pool->allocation_sizes[index] = memory_requirements.size;
+
+    return (image_handle){make_handle(&pool->slots, index)};
+}
+
+sampler_handle resource_create_sampler(const context *context,
+                                       const VkSamplerCreateInfo *sampler_info) {
+    sampler_pool *pool = &context->resources->samplers;
+    u32 index = allocate_slot(&pool->slots, "sampler");
+
+    VK_CHECK(vkCreateSampler(context->device.logical_device,
+                             sampler_info,
+                             NULL,
+                             &pool->handles[index]));
+
+    return (sampler_handle){make_handle(&pool->slots, index)};
+}
+
+pipeline_handle resource_add_pipeline(const context *context, pipeline pipeline) {
+    pipeline_pool *pool = &context->resources->pipelines;
+    u32 index = allocate_slot(&pool->slots, "pipeline");
+
+    pool->pipelines[index] = pipeline;
+
+    return (pipeline_handle){make_handle(&pool->slots, index)};
+}
+
+void resource_destroy_buffer(const context *context, buffer_handle handle) {
+    if (handle.value == 0) {
+        return;
+    }
+
+    buffer_pool *pool = &context->resources->buffers;
+    u32 index = resolve(&pool->slots, handle.value, "buffer");
+
+    context_destroy_buffer(context, pool->handles[index], pool->memories[index]);
+
+    release_slot(&pool->slots, index, true);
+}
+
+void resource_destroy_image(const context *context, image_handle handle) {
+    if (handle.value == 0) {
+        return;
+    }
+
+    image_pool *pool = &context->resources->images;
+    u32 index = resolve(&pool->slots, handle.value, "image");
+
+    deletion objects[] = {
+        {.type = DELETION_IMAGE_VIEW, .image_view = pool->views[index]},
+        {.type = DELETION_IMAGE, .image = pool->handles[index]},
+        {.type = DELETION_DEVICE_MEMORY, .memory = pool->memories[index]},
+    };
+    for (u32 i = 0; i < sizeof(objects) / sizeof(deletion); i++) {
+        deletion_queue_push(context->deletion_queue, objects[i]);
+    }
+
+    release_slot(&pool->slots, index, true);
+}
+
+void resource_destroy_sampler(const context *context, sampler_handle handle) {
+    if (handle.value == 0) {
+        return;
+    }
+
+    sampler_pool *pool = &context->resources->samplers;
+    u32 index = resolve(&pool->slots, handle.value, "sampler");
+
+    deletion_queue_push(context->deletion_queue,
+                        (deletion){.type = DELETION_SAMPLER, .sampler = pool->handles[index]});
+
+    release_slot(&pool->slots, index, true);
+}
+
+/**
+ * A pipeline is more than a few handles, so it stays in its slot until release_pipeline runs and
+ * the slot is only reused after that. The handle is stale from here on either way.
+ */
+void resource_destroy_pipeline(const context *context, pipeline_handle handle) {
+    if (handle.value == 0) {
+        return;
+    }
+
+    pipeline_pool *pool = &context->resources->pipelines;
+    u32 index = resolve(&pool->slots, handle.value, "pipeline");
+
+    release_slot(&pool->slots, index, false);
+    deletion_queue_push_fn(context->deletion_queue, release_pipeline, &index, sizeof(index));
+}
+
+VkBuffer resource_buffer(const struct resource_registry *registry, buffer_handle handle) {
+    return registry->buffers.handles[resolve(&registry->buffers.slots, handle.value, "buffer")];
+}
+
+VkDeviceSize resource_buffer_size(const struct resource_registry *registry, buffer_handle handle) {
+    return registry->buffers.sizes[resolve(&registry->buffers.slots, handle.value, "buffer")];
+}
+
+// NOTE: NULL unless the buffer is host-visible.
+void *resource_buffer_mapped(const struct resource_registry *registry, buffer_handle handle) {
+    return registry->buffers.mapped[resolve(&registry->buffers.slots, handle.value, "buffer")];
+}
+
+VkImage resource_image(const struct resource_registry *registry, image_handle handle) {
+    return registry->images.handles[resolve(&registry->images.slots, handle.value, "image")];
+}
+
+VkImageView resource_image_view(const struct resource_registry *registry, image_handle handle) {
+    return registry->images.views[resolve(&registry->images.slots, handle.value, "image")];
+}
+
+VkExtent2D resource_image_extent(const struct resource_registry *registry, image_handle handle) {
+    return registry->images.extents[resolve(&registry->images.slots, handle.value, "image")];
+}
+
+VkFormat resource_image_format(const struct resource_registry *registry, image_handle handle) {
+    return registry->images.formats[resolve(&registry->images.slots, handle.value, "image")];
+}
+
+VkSampler resource_sampler(const struct resource_registry *registry, sampler_handle handle) {
+    return registry->samplers.handles[resolve(&registry->samplers.slots, handle.value, "sampler")];
+}
+
+const pipeline *resource_pipeline(const struct resource_registry *registry,
+                                  pipeline_handle handle) {
+    u32 index = resolve(&registry->pipelines.slots, handle.value, "pipeline");
+    return &registry->pipelines.pipelines[index];
+}
+
+void resource_registry_usage(const struct resource_registry *registry, resource_usage *out_usage) {
+    *out_usage = (resource_usage){0};
+
+    const buffer_pool *buffers = &registry->buffers;
+    for (u32 i = 0; i < buffers->slots.count; i++) {
+        if (buffers->slots.live[i]) {
+            out_usage->counts[RESOURCE_BUFFER]++;
+            out_usage->bytes[RESOURCE_BUFFER] += buffers->allocation_sizes[i];
+        }
+    }
+
+    const image_pool *images = &registry->images;
+    for (u32 i = 0; i < images->slots.count; i++) {
+        if (images->slots.live[i]) {
+            out_usage->counts[RESOURCE_IMAGE]++;
+            out_usage->bytes[RESOURCE_IMAGE] += images->allocation_sizes[i];
+        }
+    }
+
+    const sampler_pool *samplers = &registry->samplers;
+    for (u32 i = 0; i < samplers->slots.count; i++) {
+        out_usage->counts[RESOURCE_SAMPLER] += samplers->slots.live[i] ? 1 : 0;
+    }
+
+    const pipeline_pool *pipelines = &registry->pipelines;
+    for (u32 i = 0; i < pipelines->slots.count; i++) {
+        out_usage->counts[RESOURCE_PIPELINE] += pipelines->slots.live[i] ? 1 : 0;
+    }
+}
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+static void slot_pool_create(slot_pool *slots, u32 capacity) {
+    *slots = (slot_pool){
+        .capacity = capacity,
+        .generations = calloc(capacity, sizeof(u16)),
+        .live = calloc(capacity, sizeof(b8)),
+        .free_indices = darray_create(u32),
+    };
+}
+
+static void slot_pool_destroy(slot_pool *slots) {
+    free(slots->generations);
+    free(slots->live);
+    darray_destroy(slots->free_indices);
+
+    *slots = (slot_pool){0};
+}
+
+static u32 allocate_slot(slot_pool *slots, const char *type_name) {
+    u32 index;
+    if (darray_length(slots->free_indices) > 0) {
+        darray_pop(slots->free_indices, &index);
+    } else if (slots->count < slots->capacity) {
+        index = slots->count++;
+        slots->generations[index] = 1;
+    } else {
+        fprintf(stderr, "Out of %s slots, all %u are in use!\n", type_name, slots->capacity);
+        exit(EXIT_FAILURE);
+    }
+
+    slots->live[index] = true;
+
+    return index;
+}
+
+// NOTE: Reuse is false when the slot still holds something to release before it can be reused.
+static void release_slot(slot_pool *slots, u32 index, b8 reuse) {
+    slots->live[index] = false;
+
+    // NOTE: Generation 0 is skipped when it wraps, it would make a zeroed handle valid.
+    u16 generation = (slots->generations[index] + 1) & RESOURCE_GENERATION_MASK;
+    slots->generations[index] = generation == 0 ? 1 : generation;
+
+    if (reuse) {
+        darray_push(slots->free_indices, index);
+    }
+}
+
+static u32 make_handle(const slot_pool *slots, u32 index) {
+    return (u32)slots->generations[index] << RESOURCE_INDEX_BITS | index;
+}
+
+static u32 resolve(const slot_pool *slots, u32 handle, const char *type_name) {
+    u32 index = handle & RESOURCE_INDEX_MASK;
+
+#if RESOURCE_CHECK_HANDLES
+    u32 generation = handle >> RESOURCE_INDEX_BITS;
+    if (index >= slots->count || !slots->live[index] || slots->generations[index] != generation) {
+        fprintf(stderr, "Stale or invalid %s handle 0x%08x!\n", type_name, handle);
+        exit(EXIT_FAILURE);
+    }
+#else
+    (void)slots;
+    (void)type_name;
+#endif
+
+    return index;
+}
+
+static void release_pipeline(context *context, void *index) {
+    pipeline_pool *pool = &context->resources->pipelines;
+    u32 slot = *(u32 *)index;
+
+    pipeline_destroy(&pool->pipelines[slot], &context->device);
+    darray_push(pool->slots.free_indices, slot);
+}
@@ -0,0 +1,90 @@
+#ifndef RESOURCE_REGISTRY_H
+#define RESOURCE_REGISTRY_H
+
+#include "types.h"
+
+// NOTE: A handle's low bits index its pool, the high bits hold the generation of the slot it was
+// handed out from, which changes every time the slot is released.
+#define RESOURCE_INDEX_BITS 20
+#define RESOURCE_GENERATION_BITS 12
+
+#define RESOURCE_MAX_BUFFERS 4096
+#define RESOURCE_MAX_IMAGES 4096
+#define RESOURCE_MAX_SAMPLERS 256
+#define RESOURCE_MAX_PIPELINES 256
+
+// NOTE: Lookups compare the handle's generation with the slot's and exit on a stale handle. On by
+// default in debug builds, define it as 0 or 1 to override.
+#ifndef RESOURCE_CHECK_HANDLES
+#ifdef NDEBUG
+#define RESOURCE_CHECK_HANDLES 0
+#else
+#define RESOURCE_CHECK_HANDLES 1
+#endif
+#endif
+
+typedef enum {
+    RESOURCE_BUFFER,
+    RESOURCE_IMAGE,
+    RESOURCE_SAMPLER,
+    RESOURCE_PIPELINE,
+    RESOURCE_TYPE_COUNT,
+} resource_type;
+
+typedef struct {
+    u32 counts[RESOURCE_TYPE_COUNT];
+    // NOTE: Device memory allocated for buffers and images, as reported by their requirements.
+    VkDeviceSize bytes[RESOURCE_TYPE_COUNT];
+} resource_usage;
+
+/**
+ * Owns buffers, images, samplers and pipelines and hands out 32-bit generational handles to them.
+ * Each type lives in a fixed-size pool stored as one array per field, so accounting and teardown
+ * walk tightly packed arrays. Destroying a handle invalidates it at once and releases the Vulkan
+ * objects through the deletion queue, after the GPU is done with them. Belongs to the thread
+ * making the context's Vulkan calls, lookups may run on any thread while nothing is created or
+ * destroyed.
+ */
+struct resource_registry *resource_registry_create(void);
+// NOTE: Destroys every resource still alive. For shutdown, once the device is idle.
+void resource_registry_destroy(struct resource_registry *registry, context *context);
+
+// NOTE: Host-visible buffers stay mapped for as long as they exist.
+buffer_handle resource_create_buffer(const context *context,
+                                     VkDeviceSize size,
+                                     VkBufferUsageFlags usage,
+                                     VkMemoryPropertyFlags properties);
+// NOTE: A device-local 2D image with a single mip level and a view covering it.
+image_handle resource_create_image(const context *context,
+                                   VkExtent2D extent,
+                                   VkFormat format,
+                                   VkImageUsageFlags usage,
+                                   VkImageAspectFlags aspect);
+sampler_handle resource_create_sampler(const context *context,
+                                       const VkSamplerCreateInfo *sampler_info);
+// NOTE: Takes ownership of a built pipeline, which is released with pipeline_destroy.
+pipeline_handle resource_add_pipeline(const context *context, pipeline pipeline);
+
+// NOTE: Zeroed handles are ignored.
+void resource_destroy_buffer(const context *context, buffer_handle handle);
+void resource_destroy_image(const context *context, image_handle handle);
+void resource_destroy_sampler(const context *context, sampler_handle handle);
+void resource_destroy_pipeline(const context *context, pipeline_handle handle);
+
+VkBuffer resource_buffer(const struct resource_registry *registry, buffer_handle handle);
+VkDeviceSize resource_buffer_size(const struct resource_registry *registry, buffer_handle handle);
+void *resource_buffer_mapped(const struct resource_registry *registry, buffer_handle handle);
+
+VkImage resource_image(const struct resource_registry *registry, image_handle handle);
+VkImageView resource_image_view(const struct resource_registry *registry, image_handle handle);
+VkExtent2D resource_image_extent(const struct resource_registry *registry, image_handle handle);
+VkFormat resource_image_format(const struct resource_registry *registry, image_handle handle);
+
+VkSampler resource_sampler(const struct resource_registry *registry, sampler_handle handle);
+
+const pipeline *resource_pipeline(const struct resource_registry *registry,
+                                  pipeline_handle handle);
+
+void resource_registry_usage(const struct resource_registry *registry, resource_usage *out_usage);
+
+#endif // RESOURCE_REGISTRY_H
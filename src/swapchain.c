@@ -1,64 +1,151 @@
 #include "swapchain.h"
 
-#include "command_buffer.h"
+#include "context.h"
 #include "defines.h"
 #include "device.h"
+#include "profiler.h"
+#include "resource_registry.h"
+#include "timeline.h"
 
 #include "vulkan/vulkan_core.h"
 
 #include <stdint.h>
 #include <stdlib.h>
 
-static void create(context *context, u32 width, u32 height, swapchain *swapchain);
+/**
+ * What a recreation replaced, kept alive until every frame that could still be using it has
+ * finished. The handle was passed as oldSwapchain to its successor.
+ */
+typedef struct {
+    VkSwapchainKHR handle;
+    u32 image_count;
+    VkImageView *image_views;
+} retired_swapchain;
+
+STATIC_ASSERT(sizeof(retired_swapchain) <= TIMELINE_DEFERRED_DATA_SIZE,
+              "Expected a retired swapchain to fit a deferred action.");
+
+static void create(context *context,
+                   u32 width,
+                   u32 height,
+                   VkSwapchainKHR old_swapchain,
+                   swapchain *swapchain);
+static void create_offscreen_images(context *context,
+                                    VkExtent2D extent,
+                                    b8 readback,
+                                    swapchain *swapchain);
+static void create_image_views(context *context, swapchain *swapchain);
 static void destroy(context *context, swapchain *swapchain);
+static void destroy_retired(context *context, void *data);
+static VkPresentModeKHR choose_present_mode(const swapchain_support_info *support,
+                                            const presentation_settings *presentation);
+static b8 supports_present_mode(const swapchain_support_info *support, VkPresentModeKHR mode);
 
 void swapchain_create(context *context, u32 width, u32 height, swapchain *swapchain) {
-    create(context, width, height, swapchain);
+    create(context, width, height, VK_NULL_HANDLE, swapchain);
+    create_image_views(context, swapchain);
 }
 
+/**
+ * Creates one color image per frame in flight in the resource registry in place of a
+ * VkSwapchainKHR, for headless contexts. With readback every image also gets a host visible
+ * buffer it is copied into at the end of its frame.
+ */
+void swapchain_create_offscreen(context *context,
+                                u32 width,
+                                u32 height,
+                                b8 readback,
+                                swapchain *swapchain) {
+    swapchain->extent = (VkExtent2D){width, height};
+    swapchain->image_format = swapchain_choose_format(context);
+    swapchain->max_frames_in_flight = context->max_frames_in_flight;
+
+    create_offscreen_images(context, swapchain->extent, readback, swapchain);
+}
+
+/**
+ * Builds the new swapchain from the current one, passed as oldSwapchain, without waiting for
+ * the device to idle. The old handle and image views are destroyed once the graphics
+ * timeline reaches the last value submitted before the recreation. Must be called before the
+ * current frame acquires an image.
+ */
 void swapchain_recreate(context *context, u32 width, u32 height, swapchain *swapchain) {
-    destroy(context, swapchain);
-    create(context, width, height, swapchain);
+    PROFILE_FUNCTION();
+
+    retired_swapchain retired = {
+        .handle = swapchain->handle,
+        .image_count = swapchain->image_count,
+        .image_views = swapchain->image_views,
+    };
+
+    // NOTE: The images belong to the old handle, only the array holding them is ours.
+    free(swapchain->images);
+    swapchain->images = NULL;
+    swapchain->image_views = NULL;
+
+    create(context, width, height, retired.handle, swapchain);
+
+    timeline_defer(context->timeline,
+                   TIMELINE_QUEUE_GRAPHICS,
+                   timeline_last_value(context->timeline, TIMELINE_QUEUE_GRAPHICS),
+                   destroy_retired,
+                   &retired,
+                   sizeof(retired));
+
+    create_image_views(context, swapchain);
 }
 
 void swapchain_destroy(context *context, swapchain *swapchain) { destroy(context, swapchain); }
 
-static void create(context *context, u32 width, u32 height, swapchain *swapchain) {
-    VkExtent2D swapchain_extent = {width, height};
+VkSurfaceFormatKHR swapchain_choose_format(const context *context) {
+    if (context->headless) {
+        // NOTE: Offscreen images are only ever rendered to and copied from, so any format with
+        // those features is as good as the surface format would have been.
+        VkFormat candidates[] = {VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB};
+        u32 flags = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT;
+
+        for (u32 i = 0; i < sizeof(candidates) / sizeof(VkFormat); i++) {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(context->device.physical_device,
+                                                candidates[i],
+                                                &properties);
+            if ((properties.optimalTilingFeatures & flags) == flags) {
+                return (VkSurfaceFormatKHR){candidates[i], VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+            }
+        }
+
+        fprintf(stderr, "No supported offscreen color format!\n");
+        exit(EXIT_FAILURE);
+    }
 
-    b8 found = false;
     for (u32 i = 0; i < context->device.swapchain_support.format_count; i++) {
         VkSurfaceFormatKHR format = context->device.swapchain_support.formats[i];
         if (format.format == VK_FORMAT_B8G8R8A8_SRGB &&
             format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
-            swapchain->image_format = format;
-            found = true;
-            break;
+            return format;
         }
     }
 
-    if (!found) {
-        swapchain->image_format = context->device.swapchain_support.formats[0];
-    }
+    return context->device.swapchain_support.formats[0];
+}
 
-    VkPresentModeKHR present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
-    // TODO: Add toggle for vsync
-    if (false /* check for vsync toggle */) {
-        present_mode = VK_PRESENT_MODE_FIFO_KHR;
-        // prefer mailbox over fifo
-        for (u32 i = 0; i < context->device.swapchain_support.present_mode_count; i++) {
-            VkPresentModeKHR mode = context->device.swapchain_support.present_modes[i];
-            if (mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                present_mode = mode;
-            }
-        }
-    }
+static void create(context *context,
+                   u32 width,
+                   u32 height,
+                   VkSwapchainKHR old_swapchain,
+                   swapchain *swapchain) {
+    VkExtent2D swapchain_extent = {width, height};
+
+    swapchain->image_format = swapchain_choose_format(context);
 
     // requery swapchain support
     device_query_swapchain_support(context->device.physical_device,
                                    context->surface,
                                    &context->device.swapchain_support);
 
+    VkPresentModeKHR present_mode =
+        choose_present_mode(&context->device.swapchain_support, &context->presentation);
+
     if (context->device.swapchain_support.capabilities.currentExtent.width != UINT32_MAX) {
         swapchain_extent = context->device.swapchain_support.capabilities.currentExtent;
     }
@@ -68,7 +155,12 @@ static void create(context *context, u32 width, u32 height, swapchain *swapchain
     swapchain_extent.width = CLAMP(swapchain_extent.width, min.width, max.width);
     swapchain_extent.height = CLAMP(swapchain_extent.height, min.height, max.height);
 
+    // NOTE: One image more than the frames that can be in flight, so acquiring never waits on a
+    // frame the CPU could still be recording.
     u32 image_count = context->device.swapchain_support.capabilities.minImageCount + 1;
+    if (image_count < context->max_frames_in_flight + 1) {
+        image_count = context->max_frames_in_flight + 1;
+    }
     if (context->device.swapchain_support.capabilities.maxImageCount > 0 &&
         image_count > context->device.swapchain_support.capabilities.maxImageCount) {
         image_count = context->device.swapchain_support.capabilities.maxImageCount;
@@ -90,7 +182,7 @@ static void create(context *context, u32 width, u32 height, swapchain *swapchain
         .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
         .presentMode = present_mode,
         .clipped = VK_TRUE,
-        .oldSwapchain = VK_NULL_HANDLE,
+        .oldSwapchain = old_swapchain,
     };
 
     if (context->device.graphics_queue_index != context->device.present_queue_index) {
@@ -108,7 +200,7 @@ static void create(context *context, u32 width, u32 height, swapchain *swapchain
                                   NULL,
                                   &swapchain->handle));
 
-    context->current_frame = 0;
+    swapchain->extent = swapchain_extent;
 
     swapchain->image_count = 0;
     VK_CHECK(vkGetSwapchainImagesKHR(context->device.logical_device,
@@ -120,93 +212,67 @@ static void create(context *context, u32 width, u32 height, swapchain *swapchain
                                      swapchain->handle,
                                      &swapchain->image_count,
                                      swapchain->images));
+}
 
-    if (!swapchain->image_views) {
-        swapchain->image_views = calloc(swapchain->image_count, sizeof(VkImageView));
+static void create_offscreen_images(context *context,
+                                    VkExtent2D extent,
+                                    b8 readback,
+                                    swapchain *swapchain) {
+    swapchain->image_count = context->max_frames_in_flight;
+    swapchain->images = calloc(swapchain->image_count, sizeof(VkImage));
+    swapchain->image_views = calloc(swapchain->image_count, sizeof(VkImageView));
+    swapchain->image_handles = calloc(swapchain->image_count, sizeof(image_handle));
 
-        for (u32 i = 0; i < swapchain->image_count; i++) {
-            VkImageViewCreateInfo view_info = {
-                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-                .image = swapchain->images[i],
-                .viewType = VK_IMAGE_VIEW_TYPE_2D,
-                .format = swapchain->image_format.format,
-                .subresourceRange =
-                    {
-                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                        .baseMipLevel = 0,
-                        .levelCount = 1,
-                        .baseArrayLayer = 0,
-                        .layerCount = 1,
-                    },
-            };
-
-            VK_CHECK(vkCreateImageView(context->device.logical_device,
-                                       &view_info,
-                                       NULL,
-                                       &swapchain->image_views[i]));
-        }
+    if (readback) {
+        swapchain->readback_buffers = calloc(swapchain->image_count, sizeof(VkBuffer));
+        swapchain->readback_memories = calloc(swapchain->image_count, sizeof(VkDeviceMemory));
+        swapchain->readback_mapped = calloc(swapchain->image_count, sizeof(void *));
     }
 
-    if (!swapchain->depth_image) {
-        VkImageCreateInfo depth_image_info = {
-            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-            .imageType = VK_IMAGE_TYPE_2D,
-            .extent =
-                {
-                    .width = swapchain_extent.width,
-                    .height = swapchain_extent.height,
-                    .depth = 1,
-                },
-            .mipLevels = 1,
-            .arrayLayers = 1,
-            .format = context->device.depth_format,
-            .tiling = VK_IMAGE_TILING_OPTIMAL,
-            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-            .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-            .samples = VK_SAMPLE_COUNT_1_BIT,
-        };
-
-        VK_CHECK(vkCreateImage(context->device.logical_device,
-                               &depth_image_info,
-                               NULL,
-                               &swapchain->depth_image));
-
-        VkMemoryRequirements depth_memory_requirements = {};
-        vkGetImageMemoryRequirements(context->device.logical_device,
-                                     swapchain->depth_image,
-                                     &depth_memory_requirements);
-        i32 memory_type = context->find_memory_index(context,
-                                                     depth_memory_requirements.memoryTypeBits,
-                                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        if (memory_type == -1) {
-            fprintf(stderr, "Required memory type not found. Image not valid.\n");
+    for (u32 i = 0; i < swapchain->image_count; i++) {
+        swapchain->image_handles[i] =
+            resource_create_image(context,
+                                  extent,
+                                  swapchain->image_format.format,
+                                  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                      VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                  VK_IMAGE_ASPECT_COLOR_BIT);
+        swapchain->images[i] = resource_image(context->resources, swapchain->image_handles[i]);
+        swapchain->image_views[i] =
+            resource_image_view(context->resources, swapchain->image_handles[i]);
+
+        if (readback) {
+            VkDeviceSize size = (VkDeviceSize)extent.width * extent.height * 4;
+            context_create_buffer(context,
+                                  size,
+                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                  &swapchain->readback_buffers[i],
+                                  &swapchain->readback_memories[i]);
+            vkMapMemory(context->device.logical_device,
+                        swapchain->readback_memories[i],
+                        0,
+                        size,
+                        0,
+                        &swapchain->readback_mapped[i]);
         }
+    }
+}
 
-        VkMemoryAllocateInfo depth_alloc_info = {
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .allocationSize = depth_memory_requirements.size,
-            .memoryTypeIndex = memory_type,
-        };
-
-        VK_CHECK(vkAllocateMemory(context->device.logical_device,
-                                  &depth_alloc_info,
-                                  NULL,
-                                  &swapchain->depth_image_memory))
-
-        VK_CHECK(vkBindImageMemory(context->device.logical_device,
-                                   swapchain->depth_image,
-                                   swapchain->depth_image_memory,
-                                   0));
+// NOTE: Views for images that come from a VkSwapchainKHR, offscreen images come with theirs.
+static void create_image_views(context *context, swapchain *swapchain) {
+    swapchain->image_views = calloc(swapchain->image_count, sizeof(VkImageView));
 
-        VkImageViewCreateInfo depth_view_info = {
+    for (u32 i = 0; i < swapchain->image_count; i++) {
+        VkImageViewCreateInfo view_info = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-            .image = swapchain->depth_image,
+            .image = swapchain->images[i],
             .viewType = VK_IMAGE_VIEW_TYPE_2D,
-            .format = context->device.depth_format,
+            .format = swapchain->image_format.format,
             .subresourceRange =
                 {
-                    .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
                     .baseMipLevel = 0,
                     .levelCount = 1,
                     .baseArrayLayer = 0,
@@ -215,102 +281,98 @@ static void create(context *context, u32 width, u32 height, swapchain *swapchain
         };
 
         VK_CHECK(vkCreateImageView(context->device.logical_device,
-                                   &depth_view_info,
+                                   &view_info,
                                    NULL,
-                                   &swapchain->depth_image_view));
-
-        VkCommandBuffer command_buffer = begin_single_time_commands(context);
+                                   &swapchain->image_views[i]));
+    }
+}
 
-        VkImageMemoryBarrier barrier = {
-            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-            .newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-            .srcQueueFamilyIndex = context->device.graphics_queue_index,
-            .dstQueueFamilyIndex = context->device.graphics_queue_index,
-            .image = swapchain->depth_image,
-            .subresourceRange =
-                {
-                    .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT |
-                                  ((context->device.depth_format == VK_FORMAT_D32_SFLOAT_S8_UINT ||
-                                    context->device.depth_format == VK_FORMAT_D24_UNORM_S8_UINT)
-                                       ? VK_IMAGE_ASPECT_STENCIL_BIT
-                                       : 0),
-                    .baseMipLevel = 0,
-                    .levelCount = 1,
-                    .baseArrayLayer = 0,
-                    .layerCount = 1,
-                },
-            .srcAccessMask = 0,
-            .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
-                             VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-        };
+static void destroy(context *context, swapchain *swapchain) {
+    vkDeviceWaitIdle(context->device.logical_device);
 
-        vkCmdPipelineBarrier(command_buffer,
-                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                             VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-                             0,
-                             0,
-                             NULL,
-                             0,
-                             NULL,
-                             1,
-                             &barrier);
-
-        end_single_time_commands(context, command_buffer);
+    // NOTE: Swapchain images belong to the swapchain, offscreen images and their views to the
+    // resource registry.
+    if (swapchain->image_handles) {
+        for (u32 i = 0; i < swapchain->image_count; i++) {
+            resource_destroy_image(context, swapchain->image_handles[i]);
+        }
+    } else {
+        for (u32 i = 0; i < swapchain->image_count; i++) {
+            vkDestroyImageView(context->device.logical_device, swapchain->image_views[i], NULL);
+        }
     }
 
-    if (!swapchain->framebuffers) {
-        swapchain->framebuffers = calloc(swapchain->image_count, sizeof(VkFramebuffer));
-
+    if (swapchain->readback_buffers) {
         for (u32 i = 0; i < swapchain->image_count; i++) {
-            VkImageView attachments[] = {
-                swapchain->image_views[i],
-                swapchain->depth_image_view,
-            };
-
-            VkFramebufferCreateInfo framebuffer_info = {
-                .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-                .renderPass = context->render_pass,
-                .attachmentCount = sizeof(attachments) / sizeof(VkImageView),
-                .pAttachments = attachments,
-                .width = swapchain_extent.width,
-                .height = swapchain_extent.height,
-                .layers = 1,
-            };
-
-            VK_CHECK(vkCreateFramebuffer(context->device.logical_device,
-                                         &framebuffer_info,
-                                         NULL,
-                                         &swapchain->framebuffers[i]));
+            vkDestroyBuffer(context->device.logical_device, swapchain->readback_buffers[i], NULL);
+            vkFreeMemory(context->device.logical_device, swapchain->readback_memories[i], NULL);
         }
     }
+
+    free(swapchain->images);
+    swapchain->images = NULL;
+    free(swapchain->image_handles);
+    swapchain->image_handles = NULL;
+    free(swapchain->readback_buffers);
+    swapchain->readback_buffers = NULL;
+    free(swapchain->readback_memories);
+    swapchain->readback_memories = NULL;
+    free(swapchain->readback_mapped);
+    swapchain->readback_mapped = NULL;
+    free(swapchain->image_views);
+    swapchain->image_views = NULL;
+
+    if (swapchain->handle != VK_NULL_HANDLE) {
+        vkDestroySwapchainKHR(context->device.logical_device, swapchain->handle, NULL);
+        swapchain->handle = VK_NULL_HANDLE;
+    }
 }
 
-static void destroy(context *context, swapchain *swapchain) {
-    vkDeviceWaitIdle(context->device.logical_device);
+static void destroy_retired(context *context, void *data) {
+    retired_swapchain *retired = data;
 
-    vkDestroyImageView(context->device.logical_device, swapchain->depth_image_view, NULL);
-    vkDestroyImage(context->device.logical_device, swapchain->depth_image, NULL);
-    vkFreeMemory(context->device.logical_device, swapchain->depth_image_memory, NULL);
+    for (u32 i = 0; i < retired->image_count; i++) {
+        vkDestroyImageView(context->device.logical_device, retired->image_views[i], NULL);
+    }
+    free(retired->image_views);
 
-    swapchain->depth_image_view = VK_NULL_HANDLE;
-    swapchain->depth_image = VK_NULL_HANDLE;
-    swapchain->depth_image_memory = VK_NULL_HANDLE;
+    vkDestroySwapchainKHR(context->device.logical_device, retired->handle, NULL);
+}
 
-    for (u32 i = 0; i < swapchain->image_count; i++) {
-        vkDestroyFramebuffer(context->device.logical_device, swapchain->framebuffers[i], NULL);
+/**
+ * FIFO is the only mode every implementation supports, so it is the fallback for every policy.
+ */
+static VkPresentModeKHR choose_present_mode(const swapchain_support_info *support,
+                                            const presentation_settings *presentation) {
+    switch (presentation->policy) {
+    case PRESENT_POLICY_LOW_LATENCY:
+        if (supports_present_mode(support, VK_PRESENT_MODE_MAILBOX_KHR)) {
+            return VK_PRESENT_MODE_MAILBOX_KHR;
+        }
+        break;
+    case PRESENT_POLICY_THROUGHPUT:
+        break;
+    case PRESENT_POLICY_ADAPTIVE:
+        if (presentation->vsync &&
+            supports_present_mode(support, VK_PRESENT_MODE_FIFO_RELAXED_KHR)) {
+            return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+        }
+        break;
     }
 
-    for (u32 i = 0; i < swapchain->image_count; i++) {
-        vkDestroyImageView(context->device.logical_device, swapchain->image_views[i], NULL);
+    if (!presentation->vsync && supports_present_mode(support, VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+        return VK_PRESENT_MODE_IMMEDIATE_KHR;
     }
 
-    free(swapchain->images);
-    swapchain->images = NULL;
-    free(swapchain->image_views);
-    swapchain->image_views = NULL;
-    free(swapchain->framebuffers);
-    swapchain->framebuffers = NULL;
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+static b8 supports_present_mode(const swapchain_support_info *support, VkPresentModeKHR mode) {
+    for (u32 i = 0; i < support->present_mode_count; i++) {
+        if (support->present_modes[i] == mode) {
+            return true;
+        }
+    }
 
-    vkDestroySwapchainKHR(context->device.logical_device, swapchain->handle, NULL);
+    return false;
 }
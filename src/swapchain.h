@@ -4,7 +4,14 @@
 #include "types.h"
 
 void swapchain_create(context *context, u32 width, u32 height, swapchain *swapchain);
+void swapchain_create_offscreen(context *context,
+                                u32 width,
+                                u32 height,
+                                b8 readback,
+                                swapchain *swapchain);
 void swapchain_recreate(context *context, u32 width, u32 height, swapchain *swapchain);
 void swapchain_destroy(context *context, swapchain *swapchain);
 
+VkSurfaceFormatKHR swapchain_choose_format(const context *context);
+
 #endif // SWAPCHAIN_H
@@ -0,0 +1,207 @@
+#include "timeline.h"
+
+#include "darray.h"
+
+#include <string.h>
+
+typedef struct {
+    timeline_queue queue;
+    u64 value;
+    timeline_deferred_fn fn;
+    u8 data[TIMELINE_DEFERRED_DATA_SIZE];
+} deferred_action;
+
+struct timeline {
+    VkDevice device;
+
+    VkQueue queues[TIMELINE_QUEUE_COUNT];
+    VkSemaphore semaphores[TIMELINE_QUEUE_COUNT];
+    u64 last_values[TIMELINE_QUEUE_COUNT];
+    // NOTE: The highest value read back from each semaphore, so most checks skip the query.
+    u64 completed_values[TIMELINE_QUEUE_COUNT];
+
+    deferred_action *deferred; // darray
+};
+
+static u64 query_completed_value(struct timeline *timeline, timeline_queue queue);
+
+/**************************************************************************************************
+ * public functions                                                                               *
+ **************************************************************************************************/
+
+struct timeline *timeline_create(const device *device) {
+    struct timeline *timeline = calloc(1, sizeof(struct timeline));
+    timeline->device = device->logical_device;
+
+    timeline->queues[TIMELINE_QUEUE_GRAPHICS] = device->graphics_queue;
+
+    VkSemaphoreTypeCreateInfo type_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+
+    VkSemaphoreCreateInfo semaphore_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &type_info,
+    };
+
+    for (u32 i = 0; i < TIMELINE_QUEUE_COUNT; i++) {
+        VK_CHECK(vkCreateSemaphore(timeline->device,
+                                   &semaphore_info,
+                                   NULL,
+                                   &timeline->semaphores[i]));
+    }
+
+    timeline->deferred = darray_create(deferred_action);
+
+    return timeline;
+}
+
+void timeline_destroy(struct timeline *timeline) {
+    if (darray_length(timeline->deferred) > 0) {
+        fprintf(stderr,
+                "Destroying a timeline with %llu deferred actions left, flush it first.\n",
+                (u64)darray_length(timeline->deferred));
+    }
+    darray_destroy(timeline->deferred);
+
+    for (u32 i = 0; i < TIMELINE_QUEUE_COUNT; i++) {
+        vkDestroySemaphore(timeline->device, timeline->semaphores[i], NULL);
+    }
+
+    free(timeline);
+}
+
+u64 timeline_submit(struct timeline *timeline,
+                    timeline_queue queue,
+                    const VkSubmitInfo *submit_info) {
+    u32 signal_count = submit_info->signalSemaphoreCount + 1;
+    if (signal_count > TIMELINE_MAX_SUBMIT_SEMAPHORES) {
+        fprintf(stderr, "Too many semaphores for one submission!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    u64 value = ++timeline->last_values[queue];
+
+    // NOTE: Binary semaphores keep the values array aligned, their values are ignored. Every wait
+    // is on a binary semaphore, so no wait values are given.
+    VkSemaphore signal_semaphores[TIMELINE_MAX_SUBMIT_SEMAPHORES];
+    u64 signal_values[TIMELINE_MAX_SUBMIT_SEMAPHORES] = {0};
+    for (u32 i = 0; i < submit_info->signalSemaphoreCount; i++) {
+        signal_semaphores[i] = submit_info->pSignalSemaphores[i];
+    }
+    signal_semaphores[signal_count - 1] = timeline->semaphores[queue];
+    signal_values[signal_count - 1] = value;
+
+    VkTimelineSemaphoreSubmitInfo timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .signalSemaphoreValueCount = signal_count,
+        .pSignalSemaphoreValues = signal_values,
+    };
+
+    VkSubmitInfo timeline_submit_info = *submit_info;
+    timeline_submit_info.pNext = &timeline_info;
+    timeline_submit_info.signalSemaphoreCount = signal_count;
+    timeline_submit_info.pSignalSemaphores = signal_semaphores;
+
+    VK_CHECK(vkQueueSubmit(timeline->queues[queue], 1, &timeline_submit_info, VK_NULL_HANDLE));
+
+    return value;
+}
+
+u64 timeline_last_value(const struct timeline *timeline, timeline_queue queue) {
+    return timeline->last_values[queue];
+}
+
+b8 timeline_reached(struct timeline *timeline, timeline_queue queue, u64 value) {
+    if (value <= timeline->completed_values[queue]) {
+        return true;
+    }
+
+    return value <= query_completed_value(timeline, queue);
+}
+
+void timeline_wait(struct timeline *timeline, timeline_queue queue, u64 value) {
+    if (value <= timeline->completed_values[queue]) {
+        return;
+    }
+
+    VkSemaphoreWaitInfo wait_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &timeline->semaphores[queue],
+        .pValues = &value,
+    };
+    VK_CHECK(vkWaitSemaphores(timeline->device, &wait_info, UINT64_MAX));
+
+    timeline->completed_values[queue] = value;
+}
+
+void timeline_defer(struct timeline *timeline,
+                    timeline_queue queue,
+                    u64 value,
+                    timeline_deferred_fn fn,
+                    const void *data,
+                    u64 size) {
+    if (size > TIMELINE_DEFERRED_DATA_SIZE) {
+        fprintf(stderr, "Deferred action data of %llu bytes does not fit!\n", size);
+        exit(EXIT_FAILURE);
+    }
+
+    deferred_action action = {
+        .queue = queue,
+        .value = value,
+        .fn = fn,
+    };
+    memcpy(action.data, data, size);
+
+    darray_push(timeline->deferred, action);
+}
+
+void timeline_run_deferred(struct timeline *timeline, context *context) {
+    if (darray_length(timeline->deferred) == 0) {
+        return;
+    }
+
+    for (u32 i = 0; i < TIMELINE_QUEUE_COUNT; i++) {
+        query_completed_value(timeline, i);
+    }
+
+    // NOTE: Actions may defer new ones, which can move the array, so each one is copied out and
+    // removed before it runs.
+    u64 i = 0;
+    while (i < darray_length(timeline->deferred)) {
+        deferred_action action = timeline->deferred[i];
+        if (action.value > timeline->completed_values[action.queue]) {
+            i++;
+            continue;
+        }
+
+        darray_pop_at(timeline->deferred, i, NULL);
+        action.fn(context, action.data);
+    }
+}
+
+void timeline_flush(struct timeline *timeline, context *context) {
+    for (u32 i = 0; i < TIMELINE_QUEUE_COUNT; i++) {
+        timeline_wait(timeline, i, timeline->last_values[i]);
+    }
+
+    timeline_run_deferred(timeline, context);
+}
+
+/**************************************************************************************************
+ * private functions                                                                              *
+ **************************************************************************************************/
+
+static u64 query_completed_value(struct timeline *timeline, timeline_queue queue) {
+    u64 value;
+    VK_CHECK(vkGetSemaphoreCounterValue(timeline->device, timeline->semaphores[queue], &value));
+
+    if (value > timeline->completed_values[queue]) {
+        timeline->completed_values[queue] = value;
+    }
+
+    return timeline->completed_values[queue];
+}
@@ -0,0 +1,63 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "types.h"
+
+// NOTE: Bytes of payload a deferred action copies, enough for a handful of handles.
+#define TIMELINE_DEFERRED_DATA_SIZE 64
+// NOTE: Semaphores a single timeline_submit may signal, binary ones included.
+#define TIMELINE_MAX_SUBMIT_SEMAPHORES 8
+
+// NOTE: Every submission goes to the graphics queue today, uploads included.
+typedef enum {
+    TIMELINE_QUEUE_GRAPHICS,
+    TIMELINE_QUEUE_COUNT,
+} timeline_queue;
+
+typedef void (*timeline_deferred_fn)(context *context, void *data);
+
+/**
+ * One timeline semaphore per queue, signaled with a value one higher by every submission made
+ * through timeline_submit. A submission is complete once its queue's counter reaches the value it
+ * returned, which the CPU can poll or wait for exactly.
+ *
+ * Deferred actions run once a queue reaches a value, so resources are released, uploads are
+ * finished and readbacks are read without waiting for a whole queue or device to idle. Belongs to
+ * the thread making the context's Vulkan calls.
+ */
+struct timeline *timeline_create(const device *device);
+void timeline_destroy(struct timeline *timeline);
+
+/**
+ * Submits to queue, signaling its next value in addition to the semaphores in submit_info, which
+ * may only wait on binary semaphores.
+ * @returns the value the submission signals.
+ */
+u64 timeline_submit(struct timeline *timeline,
+                    timeline_queue queue,
+                    const VkSubmitInfo *submit_info);
+
+// NOTE: The value of the most recent submission to queue, 0 before the first.
+u64 timeline_last_value(const struct timeline *timeline, timeline_queue queue);
+
+b8 timeline_reached(struct timeline *timeline, timeline_queue queue, u64 value);
+void timeline_wait(struct timeline *timeline, timeline_queue queue, u64 value);
+
+/**
+ * Calls fn with a copy of size bytes of data, at most TIMELINE_DEFERRED_DATA_SIZE, from
+ * timeline_run_deferred once queue has reached value.
+ */
+void timeline_defer(struct timeline *timeline,
+                    timeline_queue queue,
+                    u64 value,
+                    timeline_deferred_fn fn,
+                    const void *data,
+                    u64 size);
+
+// NOTE: Runs every deferred action whose value has been reached, oldest first.
+void timeline_run_deferred(struct timeline *timeline, context *context);
+
+// NOTE: Waits for the last submission to every queue and runs all deferred actions.
+void timeline_flush(struct timeline *timeline, context *context);
+
+#endif // TIMELINE_H
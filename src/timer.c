@@ -0,0 +1,11 @@
+#include "timer.h"
+
+#include <time.h>
+
+u64 timer_now_ns(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (u64)time.tv_sec * 1000000000ull + (u64)time.tv_nsec;
+}
+
+f64 timer_elapsed_ms(u64 start_ns) { return (f64)(timer_now_ns() - start_ns) / 1000000.0; }
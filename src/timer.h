@@ -0,0 +1,9 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "defines.h"
+
+u64 timer_now_ns(void);
+f64 timer_elapsed_ms(u64 start_ns);
+
+#endif // TIMER_H
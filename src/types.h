@@ -7,6 +7,7 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -16,10 +17,30 @@
         exit(EXIT_FAILURE);                                                                        \
     }
 
+// NOTE: Capacity of the per-frame arrays. The number actually created comes from the
+// presentation policy at run time.
 #define MAX_FRAMES_IN_FLIGHT 3
 
 struct context;
 
+/**
+ * Low latency keeps few frames queued and prefers mailbox, throughput keeps the queue full with
+ * FIFO (or immediate without vsync), adaptive switches between the two frame counts depending on
+ * whether the GPU is the bottleneck.
+ */
+typedef enum {
+    PRESENT_POLICY_LOW_LATENCY,
+    PRESENT_POLICY_THROUGHPUT,
+    PRESENT_POLICY_ADAPTIVE,
+} present_policy;
+
+typedef struct {
+    present_policy policy;
+    // NOTE: 0 picks the policy's default.
+    u32 frames_in_flight;
+    b8 vsync;
+} presentation_settings;
+
 typedef struct {
     VkSurfaceCapabilitiesKHR capabilities;
     u32 format_count;
@@ -46,11 +67,40 @@ typedef struct {
 
     VkPhysicalDeviceProperties properties;
     VkPhysicalDeviceFeatures features;
+    VkPhysicalDeviceVulkan12Features features_12;
     VkPhysicalDeviceMemoryProperties memory;
 
+    b8 supports_graphics_pipeline_library;
+    b8 supports_extended_dynamic_state;
+    b8 supports_dynamic_blend_enable;
+    // NOTE: Dynamic topology may leave the class the pipeline was built with.
+    b8 supports_unrestricted_topology;
+    PFN_vkCmdSetColorBlendEnableEXT cmd_set_color_blend_enable;
+    // NOTE: Passes begin with vkCmdBeginRendering instead of render pass objects, see
+    // render_graph.h.
+    b8 supports_dynamic_rendering;
+
     VkFormat depth_format;
 } device;
 
+// NOTE: Handles into the resource registry, see resource_registry.h. A zeroed handle is never
+// handed out and stands for no resource.
+typedef struct {
+    u32 value;
+} buffer_handle;
+
+typedef struct {
+    u32 value;
+} image_handle;
+
+typedef struct {
+    u32 value;
+} sampler_handle;
+
+typedef struct {
+    u32 value;
+} pipeline_handle;
+
 typedef struct {
     VkSurfaceFormatKHR image_format;
 
@@ -63,55 +113,116 @@ typedef struct {
     VkImage *images;
     VkImageView *image_views;
 
-    VkFramebuffer *framebuffers;
+    VkExtent2D extent;
 
-    VkImage depth_image;
-    VkDeviceMemory depth_image_memory;
-    VkImageView depth_image_view;
+    // NOTE: Offscreen targets only. The images live in the resource registry instead of coming
+    // from a VkSwapchainKHR, one per frame in flight, and are copied into the readback buffers
+    // when readback is enabled. images and image_views hold copies of the registry's handles.
+    image_handle *image_handles;
+    VkBuffer *readback_buffers;
+    VkDeviceMemory *readback_memories;
+    void **readback_mapped;
 } swapchain;
 
 typedef struct {
     const struct context *context;
 
-    VkShaderModule vertex_shader_module;
-    VkShaderModule fragment_shader_module;
-    VkPipelineShaderStageCreateInfo shader_stages[2];
+    const char *name;
+
+    u32 *vertex_shader_code;
+    u64 vertex_shader_size;
+    u32 *fragment_shader_code;
+    u64 fragment_shader_size;
 
     VkVertexInputBindingDescription *vertex_input_bindings;     // darray
     VkVertexInputAttributeDescription *vertex_input_attributes; // darray
 
     u64 ubo_size;
+    b8 bindless;
     VkCullModeFlags cull_mode;
     VkPrimitiveTopology topology;
     b8 enable_alpha_blending;
+    // NOTE: Only used without a render pass, when the pipeline is drawn with dynamic rendering.
+    VkFormat color_format;
+    VkFormat depth_format;
 
     VkPushConstantRange *push_constant_ranges; // darray
 } pipeline_builder;
 
-typedef struct {
+typedef struct pipeline {
+    // NOTE: handle, layout and global_descriptor_set_layout are shared through the registry with
+    // every pipeline built from an identical description, and released in pipeline_destroy.
+    struct pipeline_registry *registry;
+
     VkPipeline handle;
 
     VkPipelineLayout layout;
 
+    // NOTE: Values applied on bind when the matching state is dynamic.
+    b8 dynamic_state;
+    b8 unrestricted_topology;
+    VkCullModeFlags cull_mode;
+    VkPrimitiveTopology topology;
+    b8 enable_alpha_blending;
+    PFN_vkCmdSetColorBlendEnableEXT cmd_set_color_blend_enable;
+
     VkDescriptorSetLayout global_descriptor_set_layout;
+    u32 global_descriptor_set_index;
     VkDescriptorPool descriptor_pool;
     VkDescriptorSet global_descriptor_sets[MAX_FRAMES_IN_FLIGHT];
 
     VkBuffer uniform_buffer;
     VkDeviceMemory uniform_buffer_memory;
     void *uniform_buffer_mapped;
+    // NOTE: Distance between the frames' slots of the uniform buffer, see pipeline_uniform_slot.
+    VkDeviceSize uniform_buffer_stride;
 } pipeline;
 
+// NOTE: Each resource type is its own binding of the bindless set, numbered in this order.
+typedef enum {
+    BINDLESS_SAMPLED_IMAGE,
+    BINDLESS_STORAGE_BUFFER,
+    BINDLESS_SAMPLER,
+    BINDLESS_RESOURCE_TYPE_COUNT,
+} bindless_resource_type;
+
+/**
+ * One update-after-bind descriptor set holding every sampled image, storage buffer and sampler,
+ * bound once per frame at set 0. Shaders index it with slots passed in push constants.
+ */
+typedef struct {
+    VkDescriptorSetLayout layout;
+    VkDescriptorPool pool;
+    VkDescriptorSet set;
+    VkPipelineLayout pipeline_layout;
+
+    u32 next_slot[BINDLESS_RESOURCE_TYPE_COUNT];
+    u32 *free_slots[BINDLESS_RESOURCE_TYPE_COUNT]; // darray
+} bindless_set;
+
 typedef struct context {
+    // NOTE: Extent of the current swapchain, which every frame renders at.
     u32 framebuffer_width;
     u32 framebuffer_height;
-    u64 framebuffer_size_generation;
+
+    // NOTE: Written by the thread that polls the window through context_on_resized, read by the
+    // render thread. The requested size is packed as width << 32 | height.
+    _Atomic u64 requested_framebuffer_size;
+    _Atomic u64 framebuffer_size_generation;
+    // NOTE: Render thread only. The generation the swapchain was built for, the newest one seen
+    // and when it was first seen, to recreate once a burst of resizes has settled.
     u64 framebuffer_size_last_generation;
+    u64 framebuffer_size_seen_generation;
+    u64 framebuffer_size_changed_ns;
 
     VkInstance instance;
+    // NOTE: VK_NULL_HANDLE for headless contexts, which render into offscreen images instead.
     VkSurfaceKHR surface;
+    b8 headless;
 
-    b8 framebuffer_resized;
+    // NOTE: Set when acquire or present reports VK_SUBOPTIMAL_KHR, the swapchain still works but
+    // is recreated at the start of the next frame.
+    b8 swapchain_suboptimal;
 
 #ifndef NDEBUG
     VkDebugUtilsMessengerEXT debug_messenger;
@@ -121,17 +232,70 @@ typedef struct context {
 
     swapchain swapchain;
 
+    presentation_settings presentation;
+    // NOTE: Per-frame resources exist for max_frames_in_flight frames; frames_in_flight of them
+    // are cycled through, which the adaptive policy changes at run time.
+    u32 max_frames_in_flight;
+    u32 frames_in_flight;
+
+    struct gpu_profiler *gpu_profiler;
+    u32 gpu_frame_scope;
+    f64 gpu_frame_time_ms;
+    f64 average_gpu_frame_time_ms;
+    f64 average_frame_interval_ms;
+    u64 last_frame_start_ns;
+
+    // NOTE: Timings of the last ended frame, see context_frame_timing.
+    u64 frame_begin_ns;
+    f64 frame_interval_ms;
+    f64 acquire_time_ms;
+    f64 present_time_ms;
+    f64 cpu_time_ms;
+    // NOTE: From the input sample the late latch reported to the frame's submission, negative
+    // without a late latch.
+    f64 input_latency_ms;
+    u32 adaptive_switch_frames;
+
+    // NOTE: One pool per frame, reset wholesale once the frame's timeline value is reached.
+    VkCommandPool frame_command_pools[MAX_FRAMES_IN_FLIGHT];
     VkCommandBuffer graphics_command_buffers[MAX_FRAMES_IN_FLIGHT];
+    struct command_recorder *command_recorder;
 
     VkSemaphore image_available_semaphores[MAX_FRAMES_IN_FLIGHT];
     VkSemaphore render_finished_semaphores[MAX_FRAMES_IN_FLIGHT];
-    VkFence in_flight_fences[MAX_FRAMES_IN_FLIGHT];
+    // NOTE: Graphics timeline value each frame slot's last submission signals, see timeline.h.
+    u64 frame_timeline_values[MAX_FRAMES_IN_FLIGHT];
+    struct timeline *timeline;
+    // NOTE: Objects waiting for the GPU to finish with them, see deletion_queue.h.
+    struct deletion_queue *deletion_queue;
+    // NOTE: Buffers, images, samplers and pipelines behind handles, see resource_registry.h.
+    struct resource_registry *resources;
+
+    // NOTE: Declared again every frame, see render_graph.h. The frame's color and depth targets
+    // and its main pass are ids in the graph.
+    struct render_graph *render_graph;
+    u32 frame_color_target;
+    u32 frame_depth_target;
+    u32 main_pass;
+    // NOTE: Queued by context_record until the main pass executes in context_end_frame.
+    struct command_recording *frame_recordings; // darray
+    // NOTE: Called right before each frame is submitted, see context_set_late_latch.
+    u64 (*late_latch)(struct context *context, void *user_data);
+    void *late_latch_user_data;
 
     u32 image_index;
     u32 current_frame;
+    u32 last_submitted_frame;
+    b8 frame_submitted;
 
+    // NOTE: What pipelines are built against, VK_NULL_HANDLE with dynamic rendering. The render
+    // graph begins its own compatible render passes.
     VkRenderPass render_pass;
 
+    VkPipelineCache pipeline_cache;
+    struct pipeline_registry *pipeline_registry;
+    bindless_set bindless;
+
     i32 (*find_memory_index)(const struct context *context, u32 type_filter, u32 property_flags);
 } context;
 